@@ -144,7 +144,7 @@ struct asn1_oid {
 		if (offset) {                                                           \
 			ASN1_CALL((pos), asn1_dec_indef_end_fixup((ctrl), (pos), (end)));   \
 		} else if ((pos) != (component_end)) {                                  \
-			if ((ctrl)->debug & PRI_DEBUG_APDU) {                               \
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {                            \
 				pri_message((ctrl),                                             \
 					"  Skipping unused constructed component octets!\n");       \
 			}                                                                   \
@@ -154,7 +154,7 @@ struct asn1_oid {
 
 #define ASN1_DID_NOT_EXPECT_TAG(ctrl, tag)                                      \
 	do {                                                                        \
-		if ((ctrl)->debug & PRI_DEBUG_APDU) {                                   \
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {                                \
 			pri_message((ctrl), "  Did not expect: %s\n", asn1_tag2str(tag));   \
 		}                                                                       \
 	} while (0)
@@ -349,7 +349,7 @@ static const unsigned char *asn1_dec_indef_end_fixup_helper(const unsigned char
 const unsigned char *asn1_dec_indef_end_fixup(struct pri *ctrl, const unsigned char *pos,
 	const unsigned char *end)
 {
-	if (pos < end && *pos != ASN1_INDEF_TERM && (ctrl->debug & PRI_DEBUG_APDU)) {
+	if (pos < end && *pos != ASN1_INDEF_TERM && (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU))) {
 		pri_message(ctrl,
 			"  Skipping unused indefinite length constructed component octets!\n");
 	}
@@ -385,7 +385,7 @@ const unsigned char *asn1_dec_boolean(struct pri *ctrl, const char *name, unsign
 
 	*value = *pos++ ? 1 : 0;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s %s = %d\n", name, asn1_tag2str(tag), *value);
 	}
 
@@ -436,7 +436,7 @@ const unsigned char *asn1_dec_int(struct pri *ctrl, const char *name, unsigned t
 		pos++;
 	}
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s %s = %d 0x%04X\n", name, asn1_tag2str(tag), *value,
 			*value);
 	}
@@ -470,7 +470,7 @@ const unsigned char *asn1_dec_null(struct pri *ctrl, const char *name, unsigned
 		return NULL;
 	}
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s %s\n", name, asn1_tag2str(tag));
 	}
 
@@ -506,7 +506,7 @@ const unsigned char *asn1_dec_oid(struct pri *ctrl, const char *name, unsigned t
 		return NULL;
 	}
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s %s =", name, asn1_tag2str(tag));
 	}
 	delimiter = ' ';
@@ -520,14 +520,14 @@ const unsigned char *asn1_dec_oid(struct pri *ctrl, const char *name, unsigned t
 				/* Last octet in the OID subidentifier value */
 				if (num_values < ARRAY_LEN(oid->value)) {
 					oid->value[num_values] = value;
-					if (ctrl->debug & PRI_DEBUG_APDU) {
+					if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 						pri_message(ctrl, "%c%u", delimiter, value);
 					}
 					delimiter = '.';
 				} else {
 					/* Too many OID subidentifier values */
 					delimiter = '~';
-					if (ctrl->debug & PRI_DEBUG_APDU) {
+					if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 						pri_message(ctrl, "%c%u", delimiter, value);
 					}
 				}
@@ -536,7 +536,7 @@ const unsigned char *asn1_dec_oid(struct pri *ctrl, const char *name, unsigned t
 			}
 			if (!length) {
 				oid->num_values = 0;
-				if (ctrl->debug & PRI_DEBUG_APDU) {
+				if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 					pri_message(ctrl, "\n"
 						"    Last OID subidentifier value not terminated!\n");
 				}
@@ -544,7 +544,7 @@ const unsigned char *asn1_dec_oid(struct pri *ctrl, const char *name, unsigned t
 			}
 		}
 	}
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "\n");
 	}
 
@@ -554,7 +554,7 @@ const unsigned char *asn1_dec_oid(struct pri *ctrl, const char *name, unsigned t
 	} else {
 		/* Need to increase the size of the OID subidentifier list. */
 		oid->num_values = 0;
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "    Too many OID values!\n");
 		}
 		return NULL;
@@ -593,7 +593,7 @@ const unsigned char *asn1_dec_string_bin(struct pri *ctrl, const char *name,
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
 	if (length < 0) {
 		/* This is an indefinite length string */
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  %s %s = Indefinite length string\n", name,
 				asn1_tag2str(tag));
 		}
@@ -643,7 +643,7 @@ const unsigned char *asn1_dec_string_bin(struct pri *ctrl, const char *name,
 
 			if (buf_size - 1 < length) {
 				/* The destination buffer is not large enough for the data */
-				if (ctrl->debug & PRI_DEBUG_APDU) {
+				if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 					pri_message(ctrl, "    String buffer not large enough!\n");
 				}
 				return NULL;
@@ -664,7 +664,7 @@ const unsigned char *asn1_dec_string_bin(struct pri *ctrl, const char *name,
 			/* We actually did not find the End-of-contents octets. */
 			return NULL;
 		}
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			/* Dump the collected string buffer contents. */
 			pri_message(ctrl, "    Completed string =\n");
 			asn1_dump_mem(ctrl, 6, str, *str_len);
@@ -673,7 +673,7 @@ const unsigned char *asn1_dec_string_bin(struct pri *ctrl, const char *name,
 		/* This is a definite length string */
 		if (buf_size - 1 < length) {
 			/* The destination buffer is not large enough for the data */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  %s %s = Buffer not large enough!\n", name,
 					asn1_tag2str(tag));
 			}
@@ -687,7 +687,7 @@ const unsigned char *asn1_dec_string_bin(struct pri *ctrl, const char *name,
 
 		pos += length;
 
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			/* Dump the collected string buffer contents. */
 			pri_message(ctrl, "  %s %s =\n", name, asn1_tag2str(tag));
 			asn1_dump_mem(ctrl, 4, str, *str_len);
@@ -729,7 +729,7 @@ const unsigned char *asn1_dec_string_max(struct pri *ctrl, const char *name,
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
 	if (length < 0) {
 		/* This is an indefinite length string */
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  %s %s = Indefinite length string\n", name,
 				asn1_tag2str(tag));
 		}
@@ -787,7 +787,7 @@ const unsigned char *asn1_dec_string_max(struct pri *ctrl, const char *name,
 			/* We actually did not find the End-of-contents octets. */
 			return NULL;
 		}
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "    Completed string = \"%s\"\n", str);
 		}
 	} else {
@@ -803,7 +803,7 @@ const unsigned char *asn1_dec_string_max(struct pri *ctrl, const char *name,
 
 		pos += length;
 
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  %s %s = \"%s\"\n", name, asn1_tag2str(tag), str);
 		}
 	}
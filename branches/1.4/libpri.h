@@ -99,6 +99,7 @@
 #define PRI_EVENT_RETRIEVE_ACK	25	/* RETRIEVE_ACKNOWLEDGE received */
 #define PRI_EVENT_RETRIEVE_REJ	26	/* RETRIEVE_REJECT received */
 #define PRI_EVENT_CONNECT_ACK	27	/* CONNECT_ACKNOWLEDGE received */
+#define PRI_EVENT_CMD_DONE		28	/* Command submitted with pri_cmd_submit() executed */
 
 /* Simple states */
 #define PRI_STATE_DOWN		0
@@ -1296,6 +1297,15 @@ struct pri_event_connect_ack {
 	struct pri_subcommands *subcmds;
 };
 
+struct pri_event_cmd_done {
+	int e;
+	int channel;				/* Channel given with the command */
+	q931_call *call;			/* Call given with the command */
+	int type;					/* PRI_CMD_xxx of the command */
+	int result;					/* Return value of the call control function (0 or -1) */
+	unsigned long tag;			/* Tag given with the command */
+};
+
 typedef union {
 	int e;
 	pri_event_generic gen;		/* Generic view */
@@ -1321,6 +1331,7 @@ typedef union {
 	struct pri_event_retrieve_ack retrieve_ack;
 	struct pri_event_retrieve_rej retrieve_rej;
 	struct pri_event_connect_ack connect_ack;
+	struct pri_event_cmd_done cmd_done;
 } pri_event;
 
 struct pri;
@@ -1349,6 +1360,47 @@ void *pri_get_userdata(struct pri *pri);
 /* Set the user data associated with the D channel */
 void pri_set_userdata(struct pri *pri, void *userdata);
 
+#define PRI_IO_BATCH
+/*! \brief Frame passed to a batched write callback. */
+struct pri_io_frame {
+	/*! HDLC frame including room for the two FCS octets. */
+	void *buf;
+	/*! Number of octets to write. */
+	int len;
+};
+
+/*!
+ * \brief Type declaration for a callback to write several HDLC frames at once.
+ *
+ * \param ctrl D channel controller.
+ * \param frames Frames to write in order.
+ * \param count Number of frames to write.
+ *
+ * \retval Number of frames written.
+ * \retval -1 on error.
+ */
+typedef int (*pri_io_batch_cb)(struct pri *ctrl, const struct pri_io_frame *frames, int count);
+
+/*!
+ * \brief Set a callback to write the frames of a processing pass at once.
+ *
+ * \param ctrl D channel controller.
+ * \param io_write_batch Batched write callback.  NULL to write each frame
+ * with the normal write callback again.
+ *
+ * \details
+ * Frames generated while processing a received frame or running the
+ * scheduler (retransmissions, window openings, supervisory frames) are
+ * collected and handed to the callback in one call when the processing
+ * pass ends instead of one write callback call per frame.  Frames sent
+ * outside a processing pass, such as by pri_call(), still use the
+ * normal write callback.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_set_io_batch(struct pri *ctrl, pri_io_batch_cb io_write_batch);
+
 /* Set Network Specific Facility for PRI */
 void pri_set_nsf(struct pri *pri, int nsf);
 
@@ -1723,6 +1775,38 @@ void pri_set_chan_mapping_logical(struct pri *pri, int state);
 #define PRI_DUMP_INFO_STR
 char *pri_dump_info_str(struct pri *pri);
 
+#define PRI_CALL_POOL_SIZE
+/*!
+ * \brief Preallocate call records for the expected number of simultaneous calls.
+ *
+ * \param ctrl D channel controller.
+ * \param size Number of call records to keep available.
+ *
+ * \note
+ * Call records beyond the preallocated number are allocated as needed
+ * and freed when the call is destroyed.  The pool can only grow.
+ *
+ * \note
+ * All D channels in an NFAS group share the call records of the
+ * primary D channel.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_set_call_pool_size(struct pri *ctrl, unsigned size);
+
+/*!
+ * \brief Get the call record pool allocation counters.
+ *
+ * \param ctrl D channel controller.
+ * \param hits Where to put the number of call records taken from the pool. (NULL if not wanted)
+ * \param misses Where to put the number of call records that had to be allocated. (NULL if not wanted)
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_get_call_pool_stats(struct pri *ctrl, unsigned long *hits, unsigned long *misses);
+
 /* Get file descriptor */
 int pri_fd(struct pri *pri);
 
@@ -2200,6 +2284,718 @@ void pri_cc_cancel(struct pri *ctrl, long cc_id);
  */
 void pri_date_time_send_option(struct pri *ctrl, int option);
 
+/*! Scheduler time base options. */
+enum pri_sched_clock {
+	/*! Timers use the wall clock time from gettimeofday(). (Default) */
+	PRI_SCHED_CLOCK_REALTIME,
+	/*! Timers use CLOCK_MONOTONIC so wall clock steps do not affect them. */
+	PRI_SCHED_CLOCK_MONOTONIC,
+};
+
+/*! Type declaration for an application supplied scheduler time source. */
+typedef void (*pri_time_cb)(struct pri *ctrl, struct timeval *now);
+
+#define PRI_SCHED_CLOCK
+/*!
+ * \brief Set the time base used by the D channel scheduler.
+ *
+ * \param ctrl D channel controller.
+ * \param clock Scheduler time base to use.
+ *
+ * \note
+ * Any running timers are moved to the new time base without
+ * changing when they expire.
+ *
+ * \note
+ * The times returned by pri_schedule_next() are in this time base.
+ * Use pri_schedule_now() to get the current time to compare against.
+ *
+ * \note
+ * Each D channel in an NFAS group has its own scheduler and needs
+ * to be set.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_set_sched_clock(struct pri *ctrl, enum pri_sched_clock clock);
+
+/*!
+ * \brief Set an application supplied time source for the D channel scheduler.
+ *
+ * \param ctrl D channel controller.
+ * \param now_func Function returning the current time.  NULL to
+ * go back to the time base set by pri_set_sched_clock().
+ *
+ * \note
+ * The time source must never go backwards.  Any running timers are
+ * moved to the new time source without changing when they expire.
+ *
+ * \note
+ * An application time source makes timer behaviour deterministic
+ * for replay testing.
+ *
+ * \return Nothing
+ */
+void pri_set_sched_time_cb(struct pri *ctrl, pri_time_cb now_func);
+
+/*!
+ * \brief Get the current time in the D channel scheduler time base.
+ *
+ * \param ctrl D channel controller.
+ * \param now Where to put the current time.
+ *
+ * \return Nothing
+ */
+void pri_schedule_now(struct pri *ctrl, struct timeval *now);
+
+/*! \brief Event with its own copy of the event subcommands. */
+struct pri_event_entry {
+	/*! Event.  Any event subcmds pointer points to the subcmds member below. */
+	pri_event ev;
+	/*! Copy of the event subcommands. */
+	struct pri_subcommands subcmds;
+	/*! pri_get_call_serial() of the event call leg when the event was made.  (0 if none) */
+	unsigned call_serial;
+};
+
+/*! \brief Application supplied ring buffer of events. */
+struct pri_event_batch {
+	/*! Array of ring entries. */
+	struct pri_event_entry *entry;
+	/*! Number of entries in the array. */
+	unsigned size;
+	/*! Index of the oldest event in the ring. */
+	unsigned head;
+	/*! Number of events in the ring. */
+	unsigned count;
+};
+
+#define PRI_SCHEDULE_RUN_BATCH
+/*!
+ * \brief Run all expired timers and add the events they generate to the event ring.
+ *
+ * \param ctrl D channel controller.
+ * \param now Current time in the scheduler time base.  NULL to read the clock.
+ * \param ring Event ring to add the generated events after any events already there.
+ *
+ * \details
+ * Unlike pri_schedule_run(), which stops at the first timer that
+ * generates an event, all expired timers are run using the same
+ * current time until the ring is full.  Any expired timers left
+ * over are run by the next call.
+ *
+ * \note
+ * The application must process the events in ring order.
+ *
+ * \retval Number of events added to the ring.
+ * \retval -1 on error.
+ */
+int pri_schedule_run_batch(struct pri *ctrl, const struct timeval *now, struct pri_event_batch *ring);
+
+#define PRI_SCHEDULE_NEXT_NS
+/*!
+ * \brief Get when the D channel scheduler next needs to run.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \details
+ * The deadline is an absolute CLOCK_MONOTONIC time in nanoseconds
+ * whatever time base the scheduler uses, so it can be given directly
+ * to timerfd_settime() with TFD_TIMER_ABSTIME or compared against
+ * one clock for all D channels.  A deadline already passed means
+ * the scheduler needs to run now.
+ *
+ * \note Not supported on platforms without CLOCK_MONOTONIC.  Use
+ * pri_schedule_next() there.
+ *
+ * \retval Next deadline in nanoseconds.
+ * \retval -1 if no timers are running, on error, or if not supported.
+ */
+long long pri_schedule_next_ns(struct pri *ctrl);
+
+#define PRI_PROCESS_BATCH
+/*!
+ * \brief Process a readable D channel and all expired timers in one pass.
+ *
+ * \param ctrl D channel controller.
+ * \param readable TRUE if the D channel fd is readable.
+ * \param ring Event ring to add the generated events after any events already there.
+ *
+ * \details
+ * When readable, one frame is read with the controller read function
+ * and processed.  Then any events left queued and the events of all
+ * expired timers are added to the ring as pri_schedule_run_batch()
+ * does.  Everything uses the same current time.  A single thread
+ * can drive any number of D channels from epoll with this and
+ * pri_schedule_next_ns().
+ *
+ * \note
+ * If the ring fills, the remaining work is left for the next call
+ * and pri_schedule_next_ns() returns a deadline already passed.
+ *
+ * \retval Number of events added to the ring.
+ * \retval -1 on error.
+ */
+int pri_process_batch(struct pri *ctrl, int readable, struct pri_event_batch *ring);
+
+#define PRI_GET_EVENTS
+/*!
+ * \brief Get any further events queued for the upper layer.
+ *
+ * \param ctrl D channel controller.
+ * \param out Array to put the queued events in.
+ * \param max Number of events the array can hold.
+ *
+ * \details
+ * Processing one received message or expired timer can generate
+ * more than one event.  pri_check_event(), pri_schedule_run(), and
+ * pri_dchannel_run() return the first event and queue the rest.
+ * Call this afterwards to get the rest in the same pass.  Applications
+ * that do not call this still get the queued events from
+ * pri_schedule_run() because pri_schedule_next() returns the current
+ * time while events are queued.
+ *
+ * \note
+ * The returned events remain valid until the next call to this,
+ * pri_check_event(), pri_schedule_run(), or pri_dchannel_run() for
+ * the same D channel controller.
+ *
+ * \retval Number of events put in the array.
+ * \retval -1 on error.
+ */
+int pri_get_events(struct pri *ctrl, pri_event **out, int max);
+
+#define PRI_TRACE_RING
+/*! \brief Binary trace record types. */
+enum pri_trace_record_type {
+	/*!
+	 * \brief Controller description.  First record after enabling the ring.
+	 * arg[0] = switchtype, arg[1] = PRI_NETWORK/PRI_CPE, arg[2] = PRI_TRACE_MODE_xxx
+	 */
+	PRI_TRACE_REC_SESSION = 1,
+	/*!
+	 * \brief Q.921 frame without the FCS in data.
+	 * txrx = TRUE if transmitted, tei = frame TEI, arg[0] = frame SAPI
+	 */
+	PRI_TRACE_REC_FRAME = 2,
+	/*! \brief Q.921 link state change.  tei = link TEI, arg[0] = old state, arg[1] = new state */
+	PRI_TRACE_REC_Q921_STATE = 3,
+	/*! \brief Q.931 call state change.  arg[0] = call reference, arg[1] = old state, arg[2] = new state */
+	PRI_TRACE_REC_CALL_STATE = 4,
+	/*! \brief Records were lost because the ring was full.  arg[0] = number of records lost */
+	PRI_TRACE_REC_DROPPED = 5,
+};
+
+/*! \brief D channel modes given by the PRI_TRACE_REC_SESSION record. */
+enum pri_trace_mode {
+	PRI_TRACE_MODE_PRI = 0,
+	PRI_TRACE_MODE_BRI_PTP = 1,
+	PRI_TRACE_MODE_BRI_PTMP = 2,
+};
+
+/*!
+ * \brief Binary trace record.
+ *
+ * \note Records are a multiple of 4 octets long so a buffer of
+ * records read by pri_trace_ring_read() can be walked using len.
+ */
+struct pri_trace_record {
+	/*! Length of the record including this header and padding. */
+	unsigned short len;
+	/*! Number of octets in data. */
+	unsigned short data_len;
+	/*! enum pri_trace_record_type */
+	unsigned char type;
+	/*! TRUE if the frame was transmitted. */
+	unsigned char txrx;
+	/*! TEI the record applies to or -1. */
+	short tei;
+	/*! When the record was made in the scheduler time base. */
+	unsigned int sec;
+	unsigned int usec;
+	/*! Record type specific values. */
+	int arg[3];
+	/*! Record type specific data. */
+	unsigned char data[0];
+};
+
+/*!
+ * \brief Enable or disable recording binary trace records.
+ *
+ * \param ctrl D channel controller.
+ * \param size Octets of record storage.  (Rounded up to a power of 2)
+ * Zero disables recording and releases the storage.
+ *
+ * \details
+ * Frames sent and received, Q.921 link state changes, and Q.931 call
+ * state changes are recorded into a ring without formatting any text.
+ * The pritrace utility renders the records as the debug trace would.
+ * Records are dropped while the ring is full and a
+ * PRI_TRACE_REC_DROPPED record reports how many.
+ *
+ * \note Must not be called while another thread is using
+ * pri_trace_ring_read() on the same controller.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_trace_ring_set(struct pri *ctrl, int size);
+
+/*!
+ * \brief Get recorded binary trace records.
+ *
+ * \param ctrl D channel controller.
+ * \param buf Where to put the records.
+ * \param size Octets available in buf.
+ *
+ * \details
+ * Can be called from a thread other than the one running the
+ * controller.  Only one thread may read the records of a controller.
+ *
+ * \retval Number of octets of whole records put in buf.
+ * \retval -1 on error.
+ */
+int pri_trace_ring_read(struct pri *ctrl, void *buf, int size);
+
+#define PRI_PCAP
+/*!
+ * \brief Start capturing the D channel frames into a pcapng file.
+ *
+ * \param ctrl D channel controller.
+ * \param filename Capture file to create.
+ * \param rotate_size Octets a capture file may grow to before it is
+ * renamed with a ".1" suffix and a new one started.  Zero to not rotate.
+ *
+ * \details
+ * Every frame sent or received is written with the LINKTYPE_LINUX_LAPD
+ * encapsulation for Wireshark.  Frames are collected in memory and
+ * written when the buffer fills, when the file is rotated, or within a
+ * second from the scheduler.  The writes are synchronous, so a frame
+ * filling the buffer or rotating the file waits for the write.  Any
+ * capture already running on the controller is stopped first.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_pcap_open(struct pri *ctrl, const char *filename, int rotate_size);
+
+/*!
+ * \brief Stop capturing the D channel frames.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \note Frames not written yet are written before the file is closed.
+ *
+ * \return Nothing
+ */
+void pri_pcap_close(struct pri *ctrl);
+
+#define PRI_STATS
+/*! Number of buckets in the pri_check_event() processing time histogram. */
+#define PRI_STATS_HIST_BUCKETS	16
+
+/*! \brief Performance counters of a D channel controller. */
+struct pri_stats {
+	/*! Q.921 frames received. */
+	unsigned int q921_rx;
+	/*! Q.921 frames sent. */
+	unsigned int q921_tx;
+	/*! Q.931 messages received. */
+	unsigned int q931_rx;
+	/*! Q.931 messages sent. */
+	unsigned int q931_tx;
+	/*! Q.931 messages received indexed by message type. */
+	unsigned int q931_rx_msg[256];
+	/*! Q.931 messages sent indexed by message type. */
+	unsigned int q931_tx_msg[256];
+	/*! I frames sent again after a T200 expiry or a REJ. */
+	unsigned int iframe_retx;
+	/*! T200 expiries. */
+	unsigned int t200_expiries;
+	/*! REJ frames sent. */
+	unsigned int rej_tx;
+	/*! REJ frames received. */
+	unsigned int rej_rx;
+	/*! Times queued I frames were held because the window was closed. */
+	unsigned int window_stalls;
+	/*! Times queued I frames were held because the peer was busy. */
+	unsigned int peer_busy_stalls;
+	/*! Timers currently running. */
+	unsigned int sched_timers;
+	/*! Most timers running at the same time. */
+	unsigned int sched_timers_max;
+	/*! Call records currently allocated. */
+	unsigned int calls;
+	/*! Call completion records currently allocated. */
+	unsigned int cc_records;
+	/*!
+	 * \brief Received frame processing time histogram.
+	 * \details
+	 * Bucket 0 counts frames processed in under 1 microsecond and
+	 * bucket n frames processed in [2^(n-1), 2^n) microseconds.  The
+	 * last bucket also counts anything slower.
+	 * \note Only kept while enabled by pri_stats_timing_enable().
+	 */
+	unsigned int process_us[PRI_STATS_HIST_BUCKETS];
+};
+
+/*!
+ * \brief Get the performance counters of the D channel controller.
+ *
+ * \param ctrl D channel controller.
+ * \param stats Where to put the counters.
+ *
+ * \note The counters are cumulative since the controller was created.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_get_stats(struct pri *ctrl, struct pri_stats *stats);
+
+/*!
+ * \brief Set the received frame processing time histogram enable flag.
+ *
+ * \param ctrl D channel controller.
+ * \param enable TRUE to time each received frame.  (Default FALSE)
+ *
+ * \note Timing costs two clock reads per received frame.  The
+ * histogram is never kept on platforms without CLOCK_MONOTONIC.
+ *
+ * \return Nothing
+ */
+void pri_stats_timing_enable(struct pri *ctrl, int enable);
+
+#define PRI_CONTEXT
+/*!
+ * \brief Library context shared by a set of D channel controllers.
+ *
+ * \details
+ * A context owns the state the library would otherwise keep process
+ * wide: the message and error output callbacks and the scheduler
+ * timer id allocation.  Controllers using different contexts share
+ * no mutable library state and can be driven on different threads
+ * without locking.  Controllers sharing a context, such as the D
+ * channels of an NFAS group, must be driven by one thread at a time.
+ *
+ * Controllers created without a context use the default context,
+ * which pri_set_message() and pri_set_error() configure.
+ */
+struct pri_context;
+
+/*!
+ * \brief Create a library context.
+ *
+ * \note The output callbacks start out as those of the default context.
+ *
+ * \retval ctx on success.
+ * \retval NULL on error.
+ */
+struct pri_context *pri_context_new(void);
+
+/*!
+ * \brief Destroy a library context.
+ *
+ * \param ctx Library context to destroy.
+ *
+ * \note No controller created with the context may still be in use.
+ *
+ * \return Nothing
+ */
+void pri_context_destroy(struct pri_context *ctx);
+
+/*!
+ * \brief Set the message output callback of the library context.
+ *
+ * \param ctx Library context.  NULL for the default context.
+ * \param func Message output function.  NULL to write to stdout.
+ *
+ * \return Nothing
+ */
+void pri_context_set_message(struct pri_context *ctx, void (*func)(struct pri *pri, char *stuff));
+
+/*!
+ * \brief Set the error output callback of the library context.
+ *
+ * \param ctx Library context.  NULL for the default context.
+ * \param func Error output function.  NULL to write to stderr.
+ *
+ * \return Nothing
+ */
+void pri_context_set_error(struct pri_context *ctx, void (*func)(struct pri *pri, char *stuff));
+
+/*!
+ * \brief Create a D channel controller using the given library context.
+ *
+ * \note Same as pri_new() except for the context.  NULL is the default context.
+ */
+struct pri *pri_new_ctx(struct pri_context *ctx, int fd, int nodetype, int switchtype);
+
+/*!
+ * \brief Create a BRI D channel controller using the given library context.
+ *
+ * \note Same as pri_new_bri() except for the context.  NULL is the default context.
+ */
+struct pri *pri_new_bri_ctx(struct pri_context *ctx, int fd, int ptpmode, int nodetype, int switchtype);
+
+/*!
+ * \brief Create a D channel controller with I/O callbacks using the given library context.
+ *
+ * \note Same as pri_new_cb() except for the context.  NULL is the default context.
+ */
+struct pri *pri_new_cb_ctx(struct pri_context *ctx, int fd, int nodetype, int switchtype, pri_io_cb io_read, pri_io_cb io_write, void *userdata);
+
+/*!
+ * \brief Create a BRI D channel controller with I/O callbacks using the given library context.
+ *
+ * \note Same as pri_new_bri_cb() except for the context.  NULL is the default context.
+ */
+struct pri *pri_new_bri_cb_ctx(struct pri_context *ctx, int fd, int ptpmode, int nodetype, int switchtype, pri_io_cb io_read, pri_io_cb io_write, void *userdata);
+
+#define PRI_RUNTIME
+/*!
+ * \brief Worker thread pool driving many D channel controllers.
+ *
+ * \details
+ * Each worker thread waits on its own epoll set for the D channel
+ * fds and timer deadlines of the controllers given to it.  An NFAS
+ * group is always kept on one worker because its D channels share
+ * call records.  The events of a worker are passed to the application
+ * through a single producer single consumer queue, so each worker
+ * queue must only be read by one application thread at a time.
+ *
+ * \note
+ * Once the runtime is started the application must not call into
+ * its controllers directly.  Use pri_runtime_call() instead to have
+ * the owning worker run the call.
+ *
+ * \note
+ * Only available on Linux.  Elsewhere pri_runtime_new() fails.
+ */
+struct pri_runtime;
+
+/*! \brief Event passed up by a runtime worker. */
+struct pri_runtime_event {
+	/*! D channel controller that generated the event. */
+	struct pri *ctrl;
+	/*! Event with its own copy of the event subcommands. */
+	struct pri_event_entry entry;
+};
+
+/*!
+ * \brief Create a worker thread pool runtime.
+ *
+ * \param workers Number of worker threads.
+ * \param queue_size Events each worker queue holds.  Rounded up to a
+ * power of 2.  Zero for the default.
+ *
+ * \retval rt on success.
+ * \retval NULL on error.
+ */
+struct pri_runtime *pri_runtime_new(int workers, int queue_size);
+
+/*!
+ * \brief Give a D channel controller to the runtime.
+ *
+ * \param rt Worker thread pool runtime.
+ * \param ctrl D channel controller.  It must have a D channel fd.
+ *
+ * \details
+ * The controller goes to the worker that has its NFAS group or else
+ * to the worker with the fewest controllers.  Call pri_enslave()
+ * before adding the D channels of an NFAS group.
+ *
+ * \note Create any command ring with pri_cmd_ring_create() before
+ * adding the controller.  The runtime then wakes the owning worker
+ * for submitted commands.
+ *
+ * \note Controllers can only be added before pri_runtime_start().
+ *
+ * \retval Worker index the controller was given to on success.
+ * \retval -1 on error.
+ */
+int pri_runtime_add(struct pri_runtime *rt, struct pri *ctrl);
+
+/*!
+ * \brief Start the worker threads.
+ *
+ * \param rt Worker thread pool runtime.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_runtime_start(struct pri_runtime *rt);
+
+/*!
+ * \brief Stop the worker threads and destroy the runtime.
+ *
+ * \param rt Worker thread pool runtime.
+ *
+ * \note The controllers are left to the application.
+ *
+ * \return Nothing
+ */
+void pri_runtime_destroy(struct pri_runtime *rt);
+
+/*!
+ * \brief Get the fd that becomes readable when the worker queues events.
+ *
+ * \param rt Worker thread pool runtime.
+ * \param worker Worker index.
+ *
+ * \retval fd on success.
+ * \retval -1 on error.
+ */
+int pri_runtime_event_fd(struct pri_runtime *rt, int worker);
+
+/*!
+ * \brief Get the events queued by the worker.
+ *
+ * \param rt Worker thread pool runtime.
+ * \param worker Worker index.
+ * \param out Array to put the events in.
+ * \param max Number of events the array can hold.
+ *
+ * \note Clears the readable state of the worker event fd.
+ *
+ * \retval Number of events put in the array.
+ * \retval -1 on error.
+ */
+int pri_runtime_get_events(struct pri_runtime *rt, int worker, struct pri_runtime_event *out, int max);
+
+/*!
+ * \brief Have the worker owning the controller run the given function.
+ *
+ * \param rt Worker thread pool runtime.
+ * \param ctrl D channel controller given to the runtime.
+ * \param func Function to run on the worker.  It makes the calls
+ * such as pri_answer() or pri_hangup() on the controller.
+ * \param data Value to give the function.
+ *
+ * \details
+ * The function runs between frames on the owning worker thread so no
+ * application lock is needed.  Any events it generates are queued
+ * like those of received frames.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_runtime_call(struct pri_runtime *rt, struct pri *ctrl, void (*func)(struct pri *ctrl, void *data), void *data);
+
+#define PRI_CMD_RING
+/*! Call control commands that can be submitted from any thread. */
+enum pri_cmd_type {
+	/*! pri_answer(ctrl, call, channel, info) where info is nonisdn */
+	PRI_CMD_ANSWER = 1,
+	/*! pri_hangup(ctrl, call, cause) */
+	PRI_CMD_HANGUP,
+	/*! pri_progress_with_cause(ctrl, call, channel, info, cause) */
+	PRI_CMD_PROGRESS,
+	/*! pri_proceeding(ctrl, call, channel, info) */
+	PRI_CMD_PROCEEDING,
+	/*! pri_acknowledge(ctrl, call, channel, info) */
+	PRI_CMD_ACKNOWLEDGE,
+	/*! pri_need_more_info(ctrl, call, channel, info) where info is nonisdn */
+	PRI_CMD_NEED_MORE_INFO,
+	/*! pri_information(ctrl, call, info) where info is the digit */
+	PRI_CMD_INFORMATION,
+};
+
+/*!
+ * \brief Get the serial number of the call record.
+ *
+ * \param ctrl D channel controller.
+ * \param call Q.931 call leg.
+ *
+ * \details
+ * A call record freed and given to a new call gets a new serial
+ * number.  Keep it with the call pointer to tell the calls apart.
+ *
+ * \retval Serial number of the call record.
+ * \retval 0 if the call is not valid or is a dummy call.
+ */
+unsigned pri_get_call_serial(struct pri *ctrl, q931_call *call);
+
+/*! \brief Call control command record. */
+struct pri_cmd {
+	/*! PRI_CMD_xxx */
+	int type;
+	/*! Q.931 call leg. */
+	q931_call *call;
+	/*!
+	 * \brief pri_get_call_serial() of the call leg.
+	 * \details
+	 * Get it on the D channel thread or from the call_serial of the
+	 * saved event that gave the call.  The command fails if the call
+	 * record no longer has this serial number so a command for a call
+	 * that is gone cannot act on a new call using the same record.
+	 */
+	unsigned serial;
+	/*! Encoded channel id argument. */
+	int channel;
+	/*! Info argument.  (See enum pri_cmd_type) */
+	int info;
+	/*! Cause argument. */
+	int cause;
+	/*! Application value passed back in the PRI_EVENT_CMD_DONE event. */
+	unsigned long tag;
+};
+
+/*!
+ * \brief Create the call control command ring of the D channel controller.
+ *
+ * \param ctrl D channel controller.
+ * \param size Number of commands the ring holds.  Rounded up to a power of 2.
+ * \param wake Function called by the submitting thread after a command
+ * is queued so the D channel thread can be woken.  NULL if not needed.
+ * \param data Value to give the wake function.
+ *
+ * \details
+ * Queued commands are run by the D channel thread at the start of
+ * pri_check_event(), pri_receive_frame(), pri_schedule_run(), and the
+ * other processing calls.  pri_schedule_next() returns the current
+ * time while commands are queued.  Each command passes up a
+ * PRI_EVENT_CMD_DONE event with the result.
+ *
+ * \note Must be called before any thread submits commands.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_cmd_ring_create(struct pri *ctrl, int size, void (*wake)(struct pri *ctrl, void *data), void *data);
+
+/*!
+ * \brief Queue a call control command from any thread.
+ *
+ * \param ctrl D channel controller with a command ring.
+ * \param cmd Command to queue.  It is copied.
+ *
+ * \note Lock free.  Any number of threads can submit at once.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the ring is full or on error.
+ */
+int pri_cmd_submit(struct pri *ctrl, const struct pri_cmd *cmd);
+
+#define PRI_RECEIVE_FRAME
+/*!
+ * \brief Process a received D channel frame held by the application.
+ *
+ * \param ctrl D channel controller.
+ * \param buf Received Q.921 frame including the two FCS octets.
+ * \param len Number of octets in the frame.
+ *
+ * \details
+ * Runs the same Q.921/Q.931 processing as pri_check_event() but on
+ * the given buffer instead of one filled by the read callback.  Use
+ * this when the application already has the frame in memory.  The
+ * buffer is not modified and is not referenced after this returns.
+ *
+ * \retval event if the frame generated one.  Further events can be
+ * retrieved with pri_get_events().
+ * \retval NULL if no event generated or on error.
+ */
+pri_event *pri_receive_frame(struct pri *ctrl, const void *buf, int len);
+
 /* Get/Set PRI Timers  */
 #define PRI_GETSET_TIMERS
 int pri_set_timer(struct pri *pri, int timer, int value);
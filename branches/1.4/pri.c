@@ -35,6 +35,7 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <sys/select.h>
+#include <time.h>
 #include <stdarg.h>
 #include "compat.h"
 #include "libpri.h"
@@ -45,6 +46,9 @@
 #define PRI_ALL_SWITCHES	0xFFFFFFFF
 #define PRI_ETSI_SWITCHES	(PRI_BIT(PRI_SWITCH_EUROISDN_E1) | PRI_BIT(PRI_SWITCH_EUROISDN_T1))
 
+/*! Library context of controllers created without one. */
+static struct pri_context pri_default_ctx;
+
 struct pri_timer_table {
 	const char *name;
 	enum PRI_TIMERS_AND_COUNTERS number;
@@ -391,6 +395,48 @@ static int pri_date_time_send_default(struct pri *ctrl)
 	return date_time_send;
 }
 
+/*!
+ * \brief Enter the link in the TEI table of its controller.
+ *
+ * \param link Q.921 link with a newly assigned TEI.
+ *
+ * \note A TEI already entered for another SAPI keeps its entry.
+ *
+ * \return Nothing
+ */
+void pri_link_tei_add(struct q921_link *link)
+{
+	struct pri *ctrl = link->ctrl;
+
+	if (link->tei < 0 || Q921_TEI_GROUP < link->tei || ctrl->tei_link[link->tei]) {
+		return;
+	}
+	ctrl->tei_link[link->tei] = link;
+	if (Q921_TEI_AUTO_FIRST <= link->tei && link->tei <= Q921_TEI_AUTO_LAST) {
+		ctrl->tei_free &= ~(1ULL << (link->tei - Q921_TEI_AUTO_FIRST));
+	}
+}
+
+/*!
+ * \brief Remove the link from the TEI table of its controller.
+ *
+ * \param link Q.921 link giving up its TEI.
+ *
+ * \return Nothing
+ */
+void pri_link_tei_del(struct q921_link *link)
+{
+	struct pri *ctrl = link->ctrl;
+
+	if (link->tei < 0 || Q921_TEI_GROUP < link->tei || ctrl->tei_link[link->tei] != link) {
+		return;
+	}
+	ctrl->tei_link[link->tei] = NULL;
+	if (Q921_TEI_AUTO_FIRST <= link->tei && link->tei <= Q921_TEI_AUTO_LAST) {
+		ctrl->tei_free |= 1ULL << (link->tei - Q921_TEI_AUTO_FIRST);
+	}
+}
+
 /*!
  * \brief Destroy the given link.
  *
@@ -409,6 +455,8 @@ void pri_link_destroy(struct q921_link *link)
 			call->retranstimer = 0;
 			pri_call_apdu_queue_cleanup(call);
 		}
+		pri_link_tei_del(link);
+		q921_free_iqueue(link);
 		free(link);
 	}
 }
@@ -431,6 +479,7 @@ static void pri_link_init(struct pri *ctrl, struct q921_link *link, int sapi, in
 	link->ctrl = ctrl;
 	link->sapi = sapi;
 	link->tei = tei;
+	pri_link_tei_add(link);
 }
 
 /*!
@@ -505,7 +554,17 @@ static void pri_ctrl_destroy(struct pri *ctrl)
 			pri_call_apdu_queue_cleanup(call);
 		}
 		free(ctrl->msg_line);
-		free(ctrl->sched.timer);
+		free(ctrl->tx_batch.buf);
+		pri_trace_ring_destroy(ctrl);
+		pri_pcap_close(ctrl);
+		pri_cmd_ring_destroy(ctrl);
+		q921_free_iqueue(&ctrl->link);
+		pri_event_queue_destroy(ctrl);
+		free(ctrl->localindex.cr.slot);
+		free(ctrl->localindex.link_id.slot);
+		free(ctrl->localindex.ptr.slot);
+		q931_call_slab_destroy(&ctrl->localslab);
+		pri_schedule_destroy(ctrl);
 		free(ctrl);
 	}
 }
@@ -514,6 +573,7 @@ static void pri_ctrl_destroy(struct pri *ctrl)
  * \internal
  * \brief Create a new D channel control structure.
  *
+ * \param ctx Library context to use.  NULL for the default context.
  * \param fd D channel file descriptor if no callback functions supplied.
  * \param node Switch NET/CPE type
  * \param switchtype ISDN switch type
@@ -526,7 +586,7 @@ static void pri_ctrl_destroy(struct pri *ctrl)
  * \retval ctrl on success.
  * \retval NULL on error.
  */
-static struct pri *pri_ctrl_new(int fd, int node, int switchtype, pri_io_cb rd, pri_io_cb wr, void *userdata, int tei, int bri)
+static struct pri *pri_ctrl_new(struct pri_context *ctx, int fd, int node, int switchtype, pri_io_cb rd, pri_io_cb wr, void *userdata, int tei, int bri)
 {
 	int create_dummy_call;
 	struct d_ctrl_dummy *dummy_ctrl;
@@ -568,6 +628,7 @@ static struct pri *pri_ctrl_new(int fd, int node, int switchtype, pri_io_cb rd,
 		return NULL;
 	}
 
+	ctrl->ctx = ctx ? ctx : &pri_default_ctx;
 	ctrl->bri = bri;
 	ctrl->fd = fd;
 	ctrl->read_func = rd;
@@ -578,6 +639,9 @@ static struct pri *pri_ctrl_new(int fd, int node, int switchtype, pri_io_cb rd,
 	ctrl->cref = 1;
 	ctrl->nsf = PRI_NSF_NONE;
 	ctrl->callpool = &ctrl->localpool;
+	ctrl->callindex = &ctrl->localindex;
+	ctrl->callslab = &ctrl->localslab;
+	ctrl->tei_free = (1ULL << (Q921_TEI_AUTO_LAST - Q921_TEI_AUTO_FIRST + 1)) - 1;
 	pri_default_timers(ctrl, switchtype);
 	ctrl->q921_rxcount = 0;
 	ctrl->q921_txcount = 0;
@@ -675,27 +739,47 @@ int pri_restart(struct pri *pri)
 
 struct pri *pri_new(int fd, int nodetype, int switchtype)
 {
-	return pri_ctrl_new(fd, nodetype, switchtype, __pri_read, __pri_write, NULL, Q921_TEI_PRI, 0);
+	return pri_new_ctx(NULL, fd, nodetype, switchtype);
 }
 
 struct pri *pri_new_bri(int fd, int ptpmode, int nodetype, int switchtype)
+{
+	return pri_new_bri_ctx(NULL, fd, ptpmode, nodetype, switchtype);
+}
+
+struct pri *pri_new_cb(int fd, int nodetype, int switchtype, pri_io_cb io_read, pri_io_cb io_write, void *userdata)
+{
+	return pri_new_cb_ctx(NULL, fd, nodetype, switchtype, io_read, io_write, userdata);
+}
+
+struct pri *pri_new_bri_cb(int fd, int ptpmode, int nodetype, int switchtype, pri_io_cb io_read, pri_io_cb io_write, void *userdata)
+{
+	return pri_new_bri_cb_ctx(NULL, fd, ptpmode, nodetype, switchtype, io_read, io_write, userdata);
+}
+
+struct pri *pri_new_ctx(struct pri_context *ctx, int fd, int nodetype, int switchtype)
+{
+	return pri_ctrl_new(ctx, fd, nodetype, switchtype, __pri_read, __pri_write, NULL, Q921_TEI_PRI, 0);
+}
+
+struct pri *pri_new_bri_ctx(struct pri_context *ctx, int fd, int ptpmode, int nodetype, int switchtype)
 {
 	if (ptpmode)
-		return pri_ctrl_new(fd, nodetype, switchtype, __pri_read, __pri_write, NULL, Q921_TEI_PRI, 1);
+		return pri_ctrl_new(ctx, fd, nodetype, switchtype, __pri_read, __pri_write, NULL, Q921_TEI_PRI, 1);
 	else
-		return pri_ctrl_new(fd, nodetype, switchtype, __pri_read, __pri_write, NULL, Q921_TEI_GROUP, 1);
+		return pri_ctrl_new(ctx, fd, nodetype, switchtype, __pri_read, __pri_write, NULL, Q921_TEI_GROUP, 1);
 }
 
-struct pri *pri_new_cb(int fd, int nodetype, int switchtype, pri_io_cb io_read, pri_io_cb io_write, void *userdata)
+struct pri *pri_new_cb_ctx(struct pri_context *ctx, int fd, int nodetype, int switchtype, pri_io_cb io_read, pri_io_cb io_write, void *userdata)
 {
 	if (!io_read)
 		io_read = __pri_read;
 	if (!io_write)
 		io_write = __pri_write;
-	return pri_ctrl_new(fd, nodetype, switchtype, io_read, io_write, userdata, Q921_TEI_PRI, 0);
+	return pri_ctrl_new(ctx, fd, nodetype, switchtype, io_read, io_write, userdata, Q921_TEI_PRI, 0);
 }
 
-struct pri *pri_new_bri_cb(int fd, int ptpmode, int nodetype, int switchtype, pri_io_cb io_read, pri_io_cb io_write, void *userdata)
+struct pri *pri_new_bri_cb_ctx(struct pri_context *ctx, int fd, int ptpmode, int nodetype, int switchtype, pri_io_cb io_read, pri_io_cb io_write, void *userdata)
 {
 	if (!io_read) {
 		io_read = __pri_read;
@@ -704,12 +788,43 @@ struct pri *pri_new_bri_cb(int fd, int ptpmode, int nodetype, int switchtype, pr
 		io_write = __pri_write;
 	}
 	if (ptpmode) {
-		return pri_ctrl_new(fd, nodetype, switchtype, io_read, io_write, userdata, Q921_TEI_PRI, 1);
+		return pri_ctrl_new(ctx, fd, nodetype, switchtype, io_read, io_write, userdata, Q921_TEI_PRI, 1);
 	} else {
-		return pri_ctrl_new(fd, nodetype, switchtype, io_read, io_write, userdata, Q921_TEI_GROUP, 1);
+		return pri_ctrl_new(ctx, fd, nodetype, switchtype, io_read, io_write, userdata, Q921_TEI_GROUP, 1);
 	}
 }
 
+struct pri_context *pri_context_new(void)
+{
+	struct pri_context *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		return NULL;
+	}
+	ctx->message = pri_default_ctx.message;
+	ctx->error = pri_default_ctx.error;
+	return ctx;
+}
+
+void pri_context_destroy(struct pri_context *ctx)
+{
+	if (ctx && ctx != &pri_default_ctx) {
+		free(ctx->pool_owner);
+		free(ctx);
+	}
+}
+
+void pri_context_set_message(struct pri_context *ctx, void (*func)(struct pri *pri, char *stuff))
+{
+	(ctx ? ctx : &pri_default_ctx)->message = func;
+}
+
+void pri_context_set_error(struct pri_context *ctx, void (*func)(struct pri *pri, char *stuff))
+{
+	(ctx ? ctx : &pri_default_ctx)->error = func;
+}
+
 void *pri_get_userdata(struct pri *pri)
 {
 	return pri ? pri->userdata : NULL;
@@ -721,6 +836,27 @@ void pri_set_userdata(struct pri *pri, void *userdata)
 		pri->userdata = userdata;
 }
 
+int pri_set_io_batch(struct pri *ctrl, pri_io_batch_cb io_write_batch)
+{
+	if (!ctrl) {
+		return -1;
+	}
+	if (ctrl->tx_batch.write_func) {
+		q921_transmit_flush(ctrl);
+	}
+	if (!io_write_batch) {
+		free(ctrl->tx_batch.buf);
+		ctrl->tx_batch.buf = NULL;
+	} else if (!ctrl->tx_batch.buf) {
+		ctrl->tx_batch.buf = malloc(Q921_TX_BATCH_OCTETS);
+		if (!ctrl->tx_batch.buf) {
+			return -1;
+		}
+	}
+	ctrl->tx_batch.write_func = io_write_batch;
+	return 0;
+}
+
 void pri_set_nsf(struct pri *pri, int nsf)
 {
 	if (pri)
@@ -762,6 +898,7 @@ char *pri_event2str(int id)
 		{ PRI_EVENT_RETRIEVE_ACK,   "PRI_EVENT_RETRIEVE_ACK" },
 		{ PRI_EVENT_RETRIEVE_REJ,   "PRI_EVENT_RETRIEVE_REJ" },
 		{ PRI_EVENT_CONNECT_ACK,    "PRI_EVENT_CONNECT_ACK" },
+		{ PRI_EVENT_CMD_DONE,       "PRI_EVENT_CMD_DONE" },
 /* *INDENT-ON* */
 	};
 
@@ -773,19 +910,524 @@ char *pri_event2str(int id)
 	return "Unknown Event";
 }
 
+/*!
+ * \internal
+ * \brief Get the location of the subcmds pointer in the given event.
+ *
+ * \param ev Event to check.
+ *
+ * \return Location of the event subcmds pointer or NULL if the event does not have one.
+ */
+static struct pri_subcommands **pri_event_subcmds(pri_event *ev)
+{
+	switch (ev->e) {
+	case PRI_EVENT_RING:
+	case PRI_EVENT_INFO_RECEIVED:
+		return &ev->ring.subcmds;
+	case PRI_EVENT_HANGUP:
+	case PRI_EVENT_HANGUP_ACK:
+	case PRI_EVENT_HANGUP_REQ:
+		return &ev->hangup.subcmds;
+	case PRI_EVENT_RINGING:
+		return &ev->ringing.subcmds;
+	case PRI_EVENT_ANSWER:
+		return &ev->answer.subcmds;
+	case PRI_EVENT_FACILITY:
+		return &ev->facility.subcmds;
+	case PRI_EVENT_PROCEEDING:
+	case PRI_EVENT_PROGRESS:
+		return &ev->proceeding.subcmds;
+	case PRI_EVENT_SETUP_ACK:
+		return &ev->setup_ack.subcmds;
+	case PRI_EVENT_NOTIFY:
+		return &ev->notify.subcmds;
+	case PRI_EVENT_KEYPAD_DIGIT:
+		return &ev->digit.subcmds;
+	case PRI_EVENT_HOLD:
+		return &ev->hold.subcmds;
+	case PRI_EVENT_HOLD_ACK:
+		return &ev->hold_ack.subcmds;
+	case PRI_EVENT_HOLD_REJ:
+		return &ev->hold_rej.subcmds;
+	case PRI_EVENT_RETRIEVE:
+		return &ev->retrieve.subcmds;
+	case PRI_EVENT_RETRIEVE_ACK:
+		return &ev->retrieve_ack.subcmds;
+	case PRI_EVENT_RETRIEVE_REJ:
+		return &ev->retrieve_rej.subcmds;
+	case PRI_EVENT_CONNECT_ACK:
+		return &ev->connect_ack.subcmds;
+	default:
+		return NULL;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Get the call leg of the given event.
+ *
+ * \param ev Event to check.
+ *
+ * \retval call of the event.
+ * \retval NULL if the event has no call leg.
+ */
+static q931_call *pri_event_call(const pri_event *ev)
+{
+	switch (ev->e) {
+	case PRI_EVENT_RING:
+	case PRI_EVENT_INFO_RECEIVED:
+		return ev->ring.call;
+	case PRI_EVENT_HANGUP:
+	case PRI_EVENT_HANGUP_ACK:
+	case PRI_EVENT_HANGUP_REQ:
+		return ev->hangup.call;
+	case PRI_EVENT_RINGING:
+		return ev->ringing.call;
+	case PRI_EVENT_ANSWER:
+		return ev->answer.call;
+	case PRI_EVENT_FACILITY:
+		return ev->facility.call;
+	case PRI_EVENT_PROCEEDING:
+	case PRI_EVENT_PROGRESS:
+		return ev->proceeding.call;
+	case PRI_EVENT_SETUP_ACK:
+		return ev->setup_ack.call;
+	case PRI_EVENT_NOTIFY:
+		return ev->notify.call;
+	case PRI_EVENT_KEYPAD_DIGIT:
+		return ev->digit.call;
+	case PRI_EVENT_HOLD:
+		return ev->hold.call;
+	case PRI_EVENT_HOLD_ACK:
+		return ev->hold_ack.call;
+	case PRI_EVENT_HOLD_REJ:
+		return ev->hold_rej.call;
+	case PRI_EVENT_RETRIEVE:
+		return ev->retrieve.call;
+	case PRI_EVENT_RETRIEVE_ACK:
+		return ev->retrieve_ack.call;
+	case PRI_EVENT_RETRIEVE_REJ:
+		return ev->retrieve_rej.call;
+	case PRI_EVENT_CONNECT_ACK:
+		return ev->connect_ack.call;
+	default:
+		/* PRI_EVENT_CMD_DONE call pointers may already be stale. */
+		return NULL;
+	}
+}
+
+/*!
+ * \brief Save a copy of the given event so it survives the next event.
+ *
+ * \param ctrl D channel controller that made the event.  NULL if the
+ * event is not from the D channel thread.  (The call serial is not set)
+ * \param entry Where to put the event copy.
+ * \param ev Event to copy.
+ *
+ * \return Nothing
+ */
+void pri_event_save(struct pri *ctrl, struct pri_event_entry *entry, const pri_event *ev)
+{
+	struct pri_subcommands **subcmds;
+	q931_call *call;
+
+	entry->ev = *ev;
+	call = ctrl ? pri_event_call(ev) : NULL;
+	entry->call_serial = call && q931_is_call_valid(ctrl, call) ? call->serial : 0;
+	subcmds = pri_event_subcmds(&entry->ev);
+	if (subcmds && *subcmds) {
+		/* Only the used subcommands need copying. */
+		entry->subcmds.counter_subcmd = (*subcmds)->counter_subcmd;
+		memcpy(entry->subcmds.subcmd, (*subcmds)->subcmd,
+			(*subcmds)->counter_subcmd * sizeof(entry->subcmds.subcmd[0]));
+		*subcmds = &entry->subcmds;
+	} else {
+		entry->subcmds.counter_subcmd = 0;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Get an unused event queue node.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \retval node on success.
+ * \retval NULL on error.
+ */
+static struct pri_event_node *pri_event_node_get(struct pri *ctrl)
+{
+	struct pri_event_node *node;
+
+	node = ctrl->evq.free;
+	if (node) {
+		ctrl->evq.free = node->next;
+	} else {
+		node = malloc(sizeof(*node));
+		if (!node) {
+			pri_error(ctrl, "Unable to allocate event queue node\n");
+			return NULL;
+		}
+	}
+	node->next = NULL;
+	node->func = NULL;
+	node->data = NULL;
+	return node;
+}
+
+/*!
+ * \internal
+ * \brief Put the given event node on the event queue after the given node.
+ *
+ * \param ctrl D channel controller.
+ * \param node Event node to put on the queue.
+ * \param after Queued event node to follow.  NULL to put at the head.
+ *
+ * \return Nothing
+ */
+static void pri_event_node_insert(struct pri *ctrl, struct pri_event_node *node, struct pri_event_node *after)
+{
+	if (!ctrl->evq.head) {
+		/* The queue is starting to have events. */
+		pri_schedule_now(ctrl, &ctrl->evq.when);
+	}
+	if (after) {
+		node->next = after->next;
+		after->next = node;
+	} else {
+		node->next = ctrl->evq.head;
+		ctrl->evq.head = node;
+	}
+	if (!node->next) {
+		ctrl->evq.tail = node;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Put the event nodes delivered by the last call back into the pool.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \return Nothing
+ */
+static void pri_event_recycle(struct pri *ctrl)
+{
+	struct pri_event_node *node;
+
+	while ((node = ctrl->evq.delivered)) {
+		ctrl->evq.delivered = node->next;
+		node->next = ctrl->evq.free;
+		ctrl->evq.free = node;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Remove the next event from the event queue.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \details
+ * Any deferred actions are run as they come to the head of the
+ * queue.  The removed event node stays valid until the next event
+ * is requested.
+ *
+ * \return Removed event or NULL if the queue is empty.
+ */
+static pri_event *pri_event_dequeue(struct pri *ctrl)
+{
+	struct pri_event_node *node;
+	void (*func)(void *data);
+
+	while ((node = ctrl->evq.head)) {
+		ctrl->evq.head = node->next;
+		if (!ctrl->evq.head) {
+			ctrl->evq.tail = NULL;
+		}
+		func = node->func;
+		if (func) {
+			/* Run the deferred action now that the event before it is delivered. */
+			node->func = NULL;
+			ctrl->schedev = 0;
+			func(node->data);
+			if (ctrl->schedev) {
+				pri_event_save(ctrl, &node->entry, &ctrl->ev);
+			}
+		}
+		if (node->entry.ev.e) {
+			node->next = ctrl->evq.delivered;
+			ctrl->evq.delivered = node;
+			return &node->entry.ev;
+		}
+
+		/* No event to deliver. */
+		node->next = ctrl->evq.free;
+		ctrl->evq.free = node;
+	}
+	return NULL;
+}
+
+/*!
+ * \brief Queue a copy of the given event for the upper layer.
+ *
+ * \param ctrl D channel controller.
+ * \param ev Event to queue.
+ *
+ * \note Use when more than one event needs to be passed up at once.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_event_enqueue(struct pri *ctrl, const pri_event *ev)
+{
+	struct pri_event_node *node;
+
+	node = pri_event_node_get(ctrl);
+	if (!node) {
+		return -1;
+	}
+	pri_event_save(ctrl, &node->entry, ev);
+	pri_event_node_insert(ctrl, node, ctrl->evq.tail);
+	return 0;
+}
+
+/*!
+ * \brief Queue an action that generates an event after the current event is delivered.
+ *
+ * \param ctrl D channel controller.
+ * \param func Action to run.  It passes up an event like a timer callback.
+ * \param data Value to give the action.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int pri_event_defer(struct pri *ctrl, void (*func)(void *data), void *data)
+{
+	struct pri_event_node *node;
+
+	node = pri_event_node_get(ctrl);
+	if (!node) {
+		return -1;
+	}
+	node->func = func;
+	node->data = data;
+	node->entry.ev.e = 0;
+	pri_event_node_insert(ctrl, node, ctrl->evq.tail);
+	return 0;
+}
+
+/*!
+ * \brief Cancel any queued deferred actions with the given data.
+ *
+ * \param ctrl D channel controller.
+ * \param data Value given to pri_event_defer().
+ *
+ * \return Nothing
+ */
+void pri_event_defer_del(struct pri *ctrl, void *data)
+{
+	struct pri_event_node *node;
+
+	for (node = ctrl->evq.head; node; node = node->next) {
+		if (node->func && node->data == data) {
+			node->func = NULL;
+		}
+	}
+}
+
+/*!
+ * \brief Get the next event to pass to the upper layer.
+ *
+ * \param ctrl D channel controller.
+ * \param e Event generated by the current pass. (NULL if none)
+ * \param mark Last queued event node before the current pass started.
+ *
+ * \details
+ * The event generated by the current pass is delivered before any
+ * events queued during the pass and after any events queued before.
+ *
+ * \return Event for upper layer to process or NULL if no events.
+ */
+pri_event *pri_event_deliver(struct pri *ctrl, pri_event *e, struct pri_event_node *mark)
+{
+	struct pri_event_node *node;
+
+	pri_event_recycle(ctrl);
+	if (e) {
+		if (!ctrl->evq.head) {
+			/* Nothing else is waiting so no need to copy the event. */
+			return e;
+		}
+		node = pri_event_node_get(ctrl);
+		if (!node) {
+			return e;
+		}
+		pri_event_save(ctrl, &node->entry, e);
+		pri_event_node_insert(ctrl, node, mark);
+	}
+	return pri_event_dequeue(ctrl);
+}
+
+/*!
+ * \brief Release all event queue nodes.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \return Nothing
+ */
+void pri_event_queue_destroy(struct pri *ctrl)
+{
+	struct pri_event_node *node;
+
+	pri_event_recycle(ctrl);
+	while ((node = ctrl->evq.head)) {
+		ctrl->evq.head = node->next;
+		free(node);
+	}
+	ctrl->evq.tail = NULL;
+	while ((node = ctrl->evq.free)) {
+		ctrl->evq.free = node->next;
+		free(node);
+	}
+}
+
+int pri_get_events(struct pri *ctrl, pri_event **out, int max)
+{
+	pri_event *e;
+	int count;
+
+	if (!ctrl || !out || max < 0) {
+		return -1;
+	}
+	pri_event_recycle(ctrl);
+	pri_schedule_pass_begin(ctrl, NULL);
+	for (count = 0; count < max; ++count) {
+		e = pri_event_dequeue(ctrl);
+		if (!e) {
+			break;
+		}
+		out[count] = e;
+	}
+	pri_schedule_pass_end(ctrl);
+	return count;
+}
+
 pri_event *pri_check_event(struct pri *pri)
 {
 	char buf[1024];
 	int res;
-	pri_event *e;
+
 	res = pri->read_func ? pri->read_func(pri, buf, sizeof(buf)) : 0;
 	if (!res)
 		return NULL;
+	return pri_receive_frame(pri, buf, res);
+}
+
+#if defined(CLOCK_MONOTONIC)
+/*!
+ * \internal
+ * \brief Count the processing time of a received frame in the stats histogram.
+ *
+ * \param ctrl D channel controller.
+ * \param start When the frame processing started.
+ *
+ * \return Nothing
+ */
+static void pri_stats_process_time(struct pri *ctrl, const struct timespec *start)
+{
+	struct timespec end;
+	long usec;
+	int bucket;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	usec = (end.tv_sec - start->tv_sec) * 1000000L
+		+ (end.tv_nsec - start->tv_nsec) / 1000;
+	for (bucket = 0; 0 < usec && bucket < PRI_STATS_HIST_BUCKETS - 1; ++bucket) {
+		usec >>= 1;
+	}
+	++ctrl->stats.process_us[bucket];
+}
+#endif	/* defined(CLOCK_MONOTONIC) */
+
+/*!
+ * \internal
+ * \brief Process a received frame.
+ *
+ * \param ctrl D channel controller.
+ * \param buf Received frame.
+ * \param len Length of the received frame.
+ *
+ * \return Event for upper layer to process or NULL if none.
+ */
+static pri_event *pri_receive_frame_process(struct pri *ctrl, const void *buf, int len)
+{
+	pri_event *e;
+	struct pri_event_node *mark;
+
 	/* Receive the q921 packet */
-	e = q921_receive(pri, (q921_h *)buf, res);
+	pri_schedule_pass_begin(ctrl, NULL);
+	mark = ctrl->evq.tail;
+	pri_cmd_ring_run(ctrl);
+	e = q921_receive(ctrl, buf, len);
+	e = pri_event_deliver(ctrl, e, mark);
+	pri_schedule_pass_end(ctrl);
 	return e;
 }
 
+pri_event *pri_receive_frame(struct pri *ctrl, const void *buf, int len)
+{
+#if defined(CLOCK_MONOTONIC)
+	pri_event *e;
+	struct timespec start;
+#endif	/* defined(CLOCK_MONOTONIC) */
+
+	if (!ctrl || !buf || len <= 0) {
+		return NULL;
+	}
+#if defined(CLOCK_MONOTONIC)
+	if (ctrl->stats_timing) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		e = pri_receive_frame_process(ctrl, buf, len);
+		pri_stats_process_time(ctrl, &start);
+		return e;
+	}
+#endif	/* defined(CLOCK_MONOTONIC) */
+	return pri_receive_frame_process(ctrl, buf, len);
+}
+
+int pri_process_batch(struct pri *ctrl, int readable, struct pri_event_batch *ring)
+{
+	char buf[1024];
+	pri_event *e;
+	int added;
+	int res;
+
+	if (!ctrl || !ring || !ring->entry || ring->size < ring->count) {
+		return -1;
+	}
+
+	pri_schedule_pass_begin(ctrl, NULL);
+	added = 0;
+	if (readable && ring->count < ring->size) {
+		res = ctrl->read_func ? ctrl->read_func(ctrl, buf, sizeof(buf)) : 0;
+		if (0 < res) {
+			e = pri_receive_frame(ctrl, buf, res);
+			if (e) {
+				pri_event_save(ctrl, &ring->entry[(ring->head + ring->count) % ring->size], e);
+				++ring->count;
+				++added;
+			}
+		}
+	}
+	res = pri_schedule_run_batch(ctrl, NULL, ring);
+	if (0 < res) {
+		added += res;
+	}
+	pri_schedule_pass_end(ctrl);
+	return added;
+}
+
 static int wait_pri(struct pri *pri)
 {	
 	struct timeval *tv, real;
@@ -795,7 +1437,7 @@ static int wait_pri(struct pri *pri)
 	FD_SET(pri->fd, &fds);
 	tv = pri_schedule_next(pri);
 	if (tv) {
-		gettimeofday(&real, NULL);
+		pri_schedule_now(pri, &real);
 		real.tv_sec = tv->tv_sec - real.tv_sec;
 		real.tv_usec = tv->tv_usec - real.tv_usec;
 		if (real.tv_usec < 0) {
@@ -1614,17 +2256,48 @@ int pri_call(struct pri *pri, q931_call *c, int transmode, int channel, int excl
 	return q931_setup(pri, c, &req);
 }	
 
-static void (*__pri_error)(struct pri *pri, char *stuff);
-static void (*__pri_message)(struct pri *pri, char *stuff);
-
 void pri_set_message(void (*func)(struct pri *pri, char *stuff))
 {
-	__pri_message = func;
+	pri_default_ctx.message = func;
 }
 
 void pri_set_error(void (*func)(struct pri *pri, char *stuff))
 {
-	__pri_error = func;
+	pri_default_ctx.error = func;
+}
+
+/*!
+ * \internal
+ * \brief Get the library context of the given controller.
+ *
+ * \param ctrl D channel controller.  (NULL or not created by pri_ctrl_new() allowed)
+ *
+ * \return Library context to use.
+ */
+static struct pri_context *pri_ctx_get(struct pri *ctrl)
+{
+	return (ctrl && ctrl->ctx) ? ctrl->ctx : &pri_default_ctx;
+}
+
+/*!
+ * \internal
+ * \brief Pass the given output text to the message callback of the controller context.
+ *
+ * \param ctrl D channel controller.  NULL for the default context.
+ * \param str Output text.
+ *
+ * \return Nothing
+ */
+static void pri_message_out(struct pri *ctrl, char *str)
+{
+	struct pri_context *ctx;
+
+	ctx = pri_ctx_get(ctrl);
+	if (ctx->message) {
+		ctx->message(ctrl, str);
+	} else {
+		fputs(str, stdout);
+	}
 }
 
 static void pri_old_message(struct pri *ctrl, const char *fmt, va_list *ap)
@@ -1632,10 +2305,7 @@ static void pri_old_message(struct pri *ctrl, const char *fmt, va_list *ap)
 	char tmp[1024];
 
 	vsnprintf(tmp, sizeof(tmp), fmt, *ap);
-	if (__pri_message)
-		__pri_message(ctrl, tmp);
-	else
-		fputs(tmp, stdout);
+	pri_message_out(ctrl, tmp);
 }
 
 void pri_message(struct pri *ctrl, const char *fmt, ...)
@@ -1666,11 +2336,7 @@ void pri_message(struct pri *ctrl, const char *fmt, ...)
 		 */
 
 		/* vsnprintf() error or output string was truncated. */
-		if (__pri_message) {
-			__pri_message(ctrl, truncated_output);
-		} else {
-			fputs(truncated_output, stdout);
-		}
+		pri_message_out(ctrl, truncated_output);
 
 		/* Add a terminating '\n' to force a flush of the line. */
 		ctrl->msg_line->length = strlen(ctrl->msg_line->str);
@@ -1688,23 +2354,21 @@ void pri_message(struct pri *ctrl, const char *fmt, ...)
 		&& ctrl->msg_line->str[ctrl->msg_line->length - 1] == '\n') {
 		/* The accumulated output line was terminated so send it out. */
 		ctrl->msg_line->length = 0;
-		if (__pri_message) {
-			__pri_message(ctrl, ctrl->msg_line->str);
-		} else {
-			fputs(ctrl->msg_line->str, stdout);
-		}
+		pri_message_out(ctrl, ctrl->msg_line->str);
 	}
 }
 
 void pri_error(struct pri *pri, const char *fmt, ...)
 {
+	struct pri_context *ctx;
 	char tmp[1024];
 	va_list ap;
 	va_start(ap, fmt);
 	vsnprintf(tmp, sizeof(tmp), fmt, ap);
 	va_end(ap);
-	if (__pri_error)
-		__pri_error(pri, tmp);
+	ctx = pri_ctx_get(pri);
+	if (ctx->error)
+		ctx->error(pri, tmp);
 	else
 		fputs(tmp, stderr);
 }
@@ -1768,7 +2432,6 @@ char *pri_dump_info_str(struct pri *ctrl)
 	char *buf;
 	size_t buf_size;
 	size_t used;
-	struct q921_frame *f;
 	struct q921_link *link;
 	struct pri_cc_record *cc_record;
 	struct q931_call *call;
@@ -1821,11 +2484,14 @@ char *pri_dump_info_str(struct pri *ctrl)
 	used = pri_snprintf(buf, used, buf_size, "Q931 TX: %d\n", ctrl->q931_txcount);
 	used = pri_snprintf(buf, used, buf_size, "Q921 RX: %d\n", ctrl->q921_rxcount);
 	used = pri_snprintf(buf, used, buf_size, "Q921 TX: %d\n", ctrl->q921_txcount);
+	used = pri_snprintf(buf, used, buf_size, "Q921 I-frame retransmissions: %u\n",
+		ctrl->stats.iframe_retx);
+	used = pri_snprintf(buf, used, buf_size, "Q921 REJ RX: %u  TX: %u\n",
+		ctrl->stats.rej_rx, ctrl->stats.rej_tx);
+	used = pri_snprintf(buf, used, buf_size, "Q921 window stalls: %u\n",
+		ctrl->stats.window_stalls);
 	for (link = &ctrl->link; link; link = link->next) {
-		q921outstanding = 0;
-		for (f = link->tx_queue; f; f = f->next) {
-			++q921outstanding;
-		}
+		q921outstanding = link->tx_queue.tail - link->tx_queue.head;
 		used = pri_snprintf(buf, used, buf_size, "Q921 Outstanding: %u (TEI=%d)\n",
 			q921outstanding, link->tei);
 	}
@@ -1846,6 +2512,10 @@ char *pri_dump_info_str(struct pri *ctrl)
 	}
 	used = pri_snprintf(buf, used, buf_size, "Total active-calls:%u global:%u\n",
 		num_calls, num_globals);
+	used = pri_snprintf(buf, used, buf_size,
+		"Call pool size:%u free:%u hits:%lu misses:%lu\n",
+		ctrl->callslab->size, ctrl->callslab->num_free,
+		ctrl->callslab->hits, ctrl->callslab->misses);
 
 	/*
 	 * List simplified call completion records.
@@ -1869,6 +2539,14 @@ char *pri_dump_info_str(struct pri *ctrl)
 	return buf;
 }
 
+unsigned pri_get_call_serial(struct pri *ctrl, q931_call *call)
+{
+	if (!ctrl || !pri_is_call_valid(ctrl, call)) {
+		return 0;
+	}
+	return call->serial;
+}
+
 int pri_get_crv(struct pri *pri, q931_call *call, int *callmode)
 {
 	if (!pri || !pri_is_call_valid(pri, call)) {
@@ -1877,6 +2555,60 @@ int pri_get_crv(struct pri *pri, q931_call *call, int *callmode)
 	return q931_call_getcrv(pri, call, callmode);
 }
 
+int pri_set_call_pool_size(struct pri *ctrl, unsigned size)
+{
+	if (!ctrl) {
+		return -1;
+	}
+	return q931_call_slab_reserve(ctrl, size);
+}
+
+int pri_get_call_pool_stats(struct pri *ctrl, unsigned long *hits, unsigned long *misses)
+{
+	if (!ctrl) {
+		return -1;
+	}
+	if (hits) {
+		*hits = ctrl->callslab->hits;
+	}
+	if (misses) {
+		*misses = ctrl->callslab->misses;
+	}
+	return 0;
+}
+
+void pri_stats_timing_enable(struct pri *ctrl, int enable)
+{
+	if (ctrl) {
+		ctrl->stats_timing = enable ? 1 : 0;
+	}
+}
+
+int pri_get_stats(struct pri *ctrl, struct pri_stats *stats)
+{
+	struct pri *master;
+	struct pri_cc_record *cc_record;
+
+	if (!ctrl || !stats) {
+		return -1;
+	}
+	*stats = ctrl->stats;
+	stats->q921_rx = ctrl->q921_rxcount;
+	stats->q921_tx = ctrl->q921_txcount;
+	stats->q931_rx = ctrl->q931_rxcount;
+	stats->q931_tx = ctrl->q931_txcount;
+	stats->sched_timers = ctrl->sched.heap_used;
+	stats->calls = ctrl->callindex->cr.used;
+
+	/* Call completion records are kept by the NFAS master. */
+	master = PRI_NFAS_MASTER(ctrl);
+	stats->cc_records = 0;
+	for (cc_record = master->cc.pool; cc_record; cc_record = cc_record->next) {
+		++stats->cc_records;
+	}
+	return 0;
+}
+
 int pri_set_crv(struct pri *pri, q931_call *call, int crv, int callmode)
 {
 	if (!pri || !pri_is_call_valid(pri, call)) {
@@ -1914,9 +2646,16 @@ void pri_enslave(struct pri *master, struct pri *slave)
 	 */
 
 	master = PRI_NFAS_MASTER(master);
+	if (master->ctx != slave->ctx) {
+		/* Timer ids are only unique within a library context. */
+		pri_error(master, "NFAS D channels must use the same library context\n");
+		return;
+	}
 	master->nfas = 1;
 	slave->nfas = 1;
 	slave->callpool = &master->localpool;
+	slave->callindex = &master->localindex;
+	slave->callslab = &master->localslab;
 
 	/* Link the slave to the master on the end of the master's list. */
 	slave->master = master;
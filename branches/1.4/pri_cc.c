@@ -2394,7 +2394,7 @@ void pri_cc_qsig_cancel(struct pri *ctrl, q931_call *call, int msgtype, const st
 			 */
 			switch (cc_record->state) {
 			case CC_STATE_WAIT_CALLBACK:
-				if (ctrl->debug & PRI_DEBUG_CC) {
+				if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_CC)) {
 					pri_message(ctrl,
 						"-- Collision with our ccExecPossible event call.  Canceling CC.\n");
 				}
@@ -2663,7 +2663,7 @@ const char *pri_cc_fsm_event_str(enum CC_EVENTS event)
 
 static const char pri_cc_act_header[] = "%ld  CC-Act: %s\n";
 #define PRI_CC_ACT_DEBUG_OUTPUT(ctrl, cc_id)							\
-	if ((ctrl)->debug & PRI_DEBUG_CC) {									\
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_CC)) {									\
 		pri_message((ctrl), pri_cc_act_header, (cc_id), __FUNCTION__);	\
 	}
 
@@ -2685,8 +2685,10 @@ static void pri_cc_act_set_self_destruct(struct pri *ctrl, struct pri_cc_record
 	PRI_CC_ACT_DEBUG_OUTPUT(ctrl, cc_record->record_id);
 
 	/* Abort any pending indirect events. */
-	pri_schedule_del(ctrl, cc_record->t_indirect);
-	cc_record->t_indirect = 0;
+	if (cc_record->indirect_pending) {
+		pri_event_defer_del(ctrl, cc_record);
+		cc_record->indirect_pending = 0;
+	}
 
 #if defined(CC_SANITY_CHECKS)
 	if (cc_record->t_retention) {
@@ -3741,7 +3743,7 @@ static void pri_cc_indirect_status_rsp_a(void *data)
 {
 	struct pri_cc_record *cc_record = data;
 
-	cc_record->t_indirect = 0;
+	cc_record->indirect_pending = 0;
 	q931_cc_indirect(cc_record->ctrl, cc_record, pri_cc_fill_status_rsp_a);
 }
 
@@ -3763,11 +3765,11 @@ static void pri_cc_act_pass_up_status_rsp_a_indirect(struct pri *ctrl, struct pr
 	PRI_CC_ACT_DEBUG_OUTPUT(ctrl, cc_record->record_id);
 	if (cc_record->fsm.ptmp.party_a_status_acc != CC_PARTY_A_AVAILABILITY_INVALID) {
 		/* Accumulated party A status is not invalid so pass it up. */
-		if (cc_record->t_indirect) {
+		if (cc_record->indirect_pending) {
 			pri_error(ctrl, "!! An indirect action is already active!");
-			pri_schedule_del(ctrl, cc_record->t_indirect);
+			pri_event_defer_del(ctrl, cc_record);
 		}
-		cc_record->t_indirect = pri_schedule_event(ctrl, 0, pri_cc_indirect_status_rsp_a,
+		cc_record->indirect_pending = !pri_event_defer(ctrl, pri_cc_indirect_status_rsp_a,
 			cc_record);
 	}
 }
@@ -3890,7 +3892,7 @@ static void pri_cc_indirect_status_a(void *data)
 {
 	struct pri_cc_record *cc_record = data;
 
-	cc_record->t_indirect = 0;
+	cc_record->indirect_pending = 0;
 	q931_cc_indirect(cc_record->ctrl, cc_record, pri_cc_fill_status_a);
 }
 
@@ -3912,11 +3914,11 @@ static void pri_cc_act_pass_up_a_status_indirect(struct pri *ctrl, struct pri_cc
 	PRI_CC_ACT_DEBUG_OUTPUT(ctrl, cc_record->record_id);
 	if (cc_record->party_a_status != CC_PARTY_A_AVAILABILITY_INVALID) {
 		/* Party A status is not invalid so pass it up. */
-		if (cc_record->t_indirect) {
+		if (cc_record->indirect_pending) {
 			pri_error(ctrl, "!! An indirect action is already active!");
-			pri_schedule_del(ctrl, cc_record->t_indirect);
+			pri_event_defer_del(ctrl, cc_record);
 		}
-		cc_record->t_indirect = pri_schedule_event(ctrl, 0, pri_cc_indirect_status_a,
+		cc_record->indirect_pending = !pri_event_defer(ctrl, pri_cc_indirect_status_a,
 			cc_record);
 	}
 }
@@ -4237,7 +4239,7 @@ static void pri_cc_act_set_call_to_hangup(struct pri *ctrl, struct pri_cc_record
 
 /*!
  * \internal
- * \brief Post the CC_EVENT_HANGUP_SIGNALING event (timeout action).
+ * \brief Post the CC_EVENT_HANGUP_SIGNALING event (deferred action).
  *
  * \param data CC record pointer.
  *
@@ -4247,7 +4249,7 @@ static void pri_cc_post_hangup_signaling(void *data)
 {
 	struct pri_cc_record *cc_record = data;
 
-	cc_record->t_indirect = 0;
+	cc_record->indirect_pending = 0;
 	q931_cc_timeout(cc_record->ctrl, cc_record, CC_EVENT_HANGUP_SIGNALING);
 }
 
@@ -4263,11 +4265,11 @@ static void pri_cc_post_hangup_signaling(void *data)
 static void pri_cc_act_post_hangup_signaling(struct pri *ctrl, struct pri_cc_record *cc_record)
 {
 	PRI_CC_ACT_DEBUG_OUTPUT(ctrl, cc_record->record_id);
-	if (cc_record->t_indirect) {
+	if (cc_record->indirect_pending) {
 		pri_error(ctrl, "!! An indirect action is already active!");
-		pri_schedule_del(ctrl, cc_record->t_indirect);
+		pri_event_defer_del(ctrl, cc_record);
 	}
-	cc_record->t_indirect = pri_schedule_event(ctrl, 0, pri_cc_post_hangup_signaling,
+	cc_record->indirect_pending = !pri_event_defer(ctrl, pri_cc_post_hangup_signaling,
 		cc_record);
 }
 
@@ -6771,7 +6773,7 @@ int pri_cc_event(struct pri *ctrl, q931_call *call, struct pri_cc_record *cc_rec
 		return 1;
 	}
 	orig_state = cc_record->state;
-	if (ctrl->debug & PRI_DEBUG_CC) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_CC)) {
 		pri_message(ctrl, "%ld CC-Event: %s in state %s\n", cc_record->record_id,
 			pri_cc_fsm_event_str(event), pri_cc_fsm_state_str(orig_state));
 	}
@@ -6783,7 +6785,7 @@ int pri_cc_event(struct pri *ctrl, q931_call *call, struct pri_cc_record *cc_rec
 	}
 	/* Execute the state. */
 	cc_fsm[orig_state](ctrl, call, cc_record, event);
-	if (ctrl->debug & PRI_DEBUG_CC) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_CC)) {
 		pri_message(ctrl, "%ld  CC-Next-State: %s\n", cc_record->record_id,
 			(orig_state == cc_record->state)
 			? "$" : pri_cc_fsm_state_str(cc_record->state));
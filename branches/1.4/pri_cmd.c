@@ -0,0 +1,271 @@
+/*
+ * libpri: An implementation of Primary Rate ISDN
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ *
+ * In addition, when this program is distributed with Asterisk in
+ * any form that would qualify as a 'combined work' or as a
+ * 'derivative work' (but not mere aggregation), you can redistribute
+ * and/or modify the combination under the terms of the license
+ * provided with that copy of Asterisk, instead of the license
+ * terms granted here.
+ */
+
+/*!
+ * \file
+ * \brief Cross thread call control command ring
+ *
+ * \details
+ * A bounded multiple producer single consumer ring.  Each cell has a
+ * sequence number telling whether it is free for the producer that
+ * claimed its position or holds a command ready for the consumer.
+ * Producers claim positions by advancing the tail with a compare and
+ * swap.  Only the D channel thread advances the head.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "compat.h"
+#include "libpri.h"
+#include "pri_internal.h"
+
+
+/*! Most commands run per processing pass so frames are not starved. */
+#define PRI_CMD_RUN_MAX		64
+
+/*! \brief Command ring cell. */
+struct pri_cmd_cell {
+	/*! Position the cell is ready for.  (pos: free, pos + 1: holds the command at pos) */
+	unsigned seq;
+	/*! Queued command. */
+	struct pri_cmd cmd;
+};
+
+/*! \brief Call control command ring. */
+struct pri_cmd_ring {
+	/*! Function waking the D channel thread.  (NULL if none) */
+	void (*wake)(struct pri *ctrl, void *data);
+	/*! Value to give the wake function. */
+	void *wake_data;
+	/*! Number of cells minus one.  (Number of cells is a power of 2) */
+	unsigned mask;
+	/*! Next position producers claim. */
+	unsigned tail;
+	/*! Next position the D channel thread runs.  (D channel thread only) */
+	unsigned head;
+	/*! Ring cells. */
+	struct pri_cmd_cell cell[0];
+};
+
+int pri_cmd_ring_create(struct pri *ctrl, int size, void (*wake)(struct pri *ctrl, void *data), void *data)
+{
+	struct pri_cmd_ring *ring;
+	unsigned cells;
+	unsigned idx;
+
+	if (!ctrl || size <= 0 || ctrl->cmd_ring) {
+		return -1;
+	}
+	for (cells = 1; cells < size; cells <<= 1) {
+	}
+	ring = calloc(1, sizeof(*ring) + cells * sizeof(ring->cell[0]));
+	if (!ring) {
+		return -1;
+	}
+	ring->wake = wake;
+	ring->wake_data = data;
+	ring->mask = cells - 1;
+	for (idx = 0; idx < cells; ++idx) {
+		ring->cell[idx].seq = idx;
+	}
+	ctrl->cmd_ring = ring;
+	return 0;
+}
+
+/*!
+ * \brief Set the function waking the D channel thread for queued commands.
+ *
+ * \param ctrl D channel controller.
+ * \param wake Function called by the submitting thread.  NULL if not needed.
+ * \param data Value to give the wake function.
+ *
+ * \note Only used while no thread can be submitting commands.
+ *
+ * \return Nothing
+ */
+void pri_cmd_ring_wake_set(struct pri *ctrl, void (*wake)(struct pri *ctrl, void *data), void *data)
+{
+	if (ctrl->cmd_ring) {
+		ctrl->cmd_ring->wake = wake;
+		ctrl->cmd_ring->wake_data = data;
+	}
+}
+
+/*!
+ * \brief Destroy the command ring of the D channel controller.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \return Nothing
+ */
+void pri_cmd_ring_destroy(struct pri *ctrl)
+{
+	free(ctrl->cmd_ring);
+	ctrl->cmd_ring = NULL;
+}
+
+int pri_cmd_submit(struct pri *ctrl, const struct pri_cmd *cmd)
+{
+	struct pri_cmd_ring *ring;
+	struct pri_cmd_cell *cell;
+	unsigned pos;
+	int dif;
+
+	if (!ctrl || !cmd || !ctrl->cmd_ring) {
+		return -1;
+	}
+	ring = ctrl->cmd_ring;
+
+	pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	for (;;) {
+		cell = &ring->cell[pos & ring->mask];
+		dif = (int) (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+		if (!dif) {
+			/* The cell is free.  Try to claim the position. */
+			if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, 0,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+			/* Another producer claimed it.  pos now has the current tail. */
+		} else if (dif < 0) {
+			/* The ring is full. */
+			return -1;
+		} else {
+			pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		}
+	}
+	cell->cmd = *cmd;
+	__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+	if (ring->wake) {
+		ring->wake(ctrl, ring->wake_data);
+	}
+	return 0;
+}
+
+/*!
+ * \brief Determine if the D channel controller has queued commands.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \retval TRUE if commands are queued.
+ */
+int pri_cmd_ring_pending(struct pri *ctrl)
+{
+	struct pri_cmd_ring *ring;
+
+	ring = ctrl->cmd_ring;
+	if (!ring) {
+		return 0;
+	}
+	return __atomic_load_n(&ring->cell[ring->head & ring->mask].seq, __ATOMIC_ACQUIRE)
+		== ring->head + 1;
+}
+
+/*!
+ * \internal
+ * \brief Run the given call control command.
+ *
+ * \param ctrl D channel controller.
+ * \param cmd Command to run.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int pri_cmd_exec(struct pri *ctrl, const struct pri_cmd *cmd)
+{
+	if (!cmd->serial || !q931_is_call_valid(ctrl, cmd->call)
+		|| cmd->call->serial != cmd->serial) {
+		/* The call is gone.  The record may belong to another call now. */
+		return -1;
+	}
+	switch (cmd->type) {
+	case PRI_CMD_ANSWER:
+		return pri_answer(ctrl, cmd->call, cmd->channel, cmd->info);
+	case PRI_CMD_HANGUP:
+		return pri_hangup(ctrl, cmd->call, cmd->cause);
+	case PRI_CMD_PROGRESS:
+		return pri_progress_with_cause(ctrl, cmd->call, cmd->channel, cmd->info, cmd->cause);
+	case PRI_CMD_PROCEEDING:
+		return pri_proceeding(ctrl, cmd->call, cmd->channel, cmd->info);
+	case PRI_CMD_ACKNOWLEDGE:
+		return pri_acknowledge(ctrl, cmd->call, cmd->channel, cmd->info);
+	case PRI_CMD_NEED_MORE_INFO:
+		return pri_need_more_info(ctrl, cmd->call, cmd->channel, cmd->info);
+	case PRI_CMD_INFORMATION:
+		return pri_information(ctrl, cmd->call, cmd->info);
+	default:
+		pri_error(ctrl, "Unknown command type %d\n", cmd->type);
+		return -1;
+	}
+}
+
+/*!
+ * \brief Run the queued call control commands.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \details
+ * Each command queues a PRI_EVENT_CMD_DONE event with its result.
+ * At most PRI_CMD_RUN_MAX commands are run so received frames are
+ * not held up.  Any left over are run by the next pass.
+ *
+ * \return Nothing
+ */
+void pri_cmd_ring_run(struct pri *ctrl)
+{
+	struct pri_cmd_ring *ring;
+	struct pri_cmd_cell *cell;
+	struct pri_cmd cmd;
+	pri_event ev;
+	int count;
+
+	ring = ctrl->cmd_ring;
+	if (!ring) {
+		return;
+	}
+	for (count = 0; count < PRI_CMD_RUN_MAX; ++count) {
+		cell = &ring->cell[ring->head & ring->mask];
+		if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != ring->head + 1) {
+			/* The ring is empty. */
+			break;
+		}
+		cmd = cell->cmd;
+		/* Give the cell back to the producers for the next lap. */
+		__atomic_store_n(&cell->seq, ring->head + ring->mask + 1, __ATOMIC_RELEASE);
+		++ring->head;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.cmd_done.e = PRI_EVENT_CMD_DONE;
+		ev.cmd_done.channel = cmd.channel;
+		ev.cmd_done.call = cmd.call;
+		ev.cmd_done.type = cmd.type;
+		ev.cmd_done.tag = cmd.tag;
+		ev.cmd_done.result = pri_cmd_exec(ctrl, &cmd);
+		pri_event_enqueue(ctrl, &ev);
+	}
+}
+
+/* ------------------------------------------------------------------- */
+/* end pri_cmd.c */
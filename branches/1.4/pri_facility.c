@@ -2400,7 +2400,7 @@ int qsig_cf_callrerouting(struct pri *ctrl, q931_call *call, const char *dest,
  *
  * Just need to resend the message to the other tromboned leg of the call.
  */
-static int anfpr_pathreplacement_respond(struct pri *ctrl, q931_call *call, q931_ie *ie)
+static int anfpr_pathreplacement_respond(struct pri *ctrl, q931_call *call, const q931_ie *ie)
 {
 	int res;
 
@@ -4177,14 +4177,14 @@ void pri_mcid_enable(struct pri *ctrl, int enable)
  *
  * \return Nothing
  */
-void rose_handle_reject(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie,
+void rose_handle_reject(struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie,
 	const struct fac_extension_header *header, const struct rose_msg_reject *reject)
 {
 	q931_call *orig_call;
 	struct apdu_event *apdu;
 	struct apdu_msg_data msg;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		/* Gripe to the user about getting rejected. */
 		pri_message(ctrl, "ROSE REJECT:\n");
 		if (reject->invoke_id_present) {
@@ -4248,7 +4248,7 @@ void rose_handle_reject(struct pri *ctrl, q931_call *call, int msgtype, q931_ie
  *
  * \return Nothing
  */
-void rose_handle_error(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie,
+void rose_handle_error(struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie,
 	const struct fac_extension_header *header, const struct rose_msg_error *error)
 {
 	const char *dms100_operation;
@@ -4256,7 +4256,7 @@ void rose_handle_error(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *
 	struct apdu_event *apdu;
 	struct apdu_msg_data msg;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		/* Gripe to the user about getting an error. */
 		pri_message(ctrl, "ROSE RETURN ERROR:\n");
 		switch (ctrl->switchtype) {
@@ -4332,7 +4332,7 @@ void rose_handle_error(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *
  *
  * \return Nothing
  */
-void rose_handle_result(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie,
+void rose_handle_result(struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie,
 	const struct fac_extension_header *header, const struct rose_msg_result *result)
 {
 	q931_call *orig_call;
@@ -4355,7 +4355,7 @@ void rose_handle_result(struct pri *ctrl, q931_call *call, int msgtype, q931_ie
 			call->transferable = 1;
 			break;
 		case ROSE_DMS100_RLT_THIRD_PARTY:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "Successfully completed RLT transfer!\n");
 			}
 			break;
@@ -4408,7 +4408,7 @@ void rose_handle_result(struct pri *ctrl, q931_call *call, int msgtype, q931_ie
  *
  * \return Nothing
  */
-void rose_handle_invoke(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie,
+void rose_handle_invoke(struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie,
 	const struct fac_extension_header *header, const struct rose_msg_invoke *invoke)
 {
 	struct pri_cc_record *cc_record;
@@ -4734,8 +4734,11 @@ void rose_handle_invoke(struct pri *ctrl, q931_call *call, int msgtype, q931_ie
 		 * It should be safe enough to do this.  If not then we will have to search
 		 * the call pool to ensure that the link_id is not already in use.
 		 */
-		call->master_call->link_id = get_invokeid(ctrl);
-		call->master_call->is_link_id_valid = 1;
+		if (q931_set_link_id(ctrl, call->master_call, get_invokeid(ctrl))) {
+			send_facility_error(ctrl, call, invoke->invoke_id,
+				ROSE_ERROR_Gen_ResourceUnavailable);
+			break;
+		}
 		send_ect_link_id_rsp(ctrl, call, invoke->invoke_id);
 		break;
 	case ROSE_ETSI_EctInform:
@@ -5552,7 +5555,7 @@ void rose_handle_invoke(struct pri *ctrl, q931_call *call, int msgtype, q931_ie
 		break;
 #endif	/* Not handled yet */
 	default:
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl,
 				"!! ROSE invoke operation not handled on switchtype:%s! %s\n",
 				pri_switch2str(ctrl->switchtype), rose_operation2str(invoke->operation));
@@ -241,10 +241,10 @@ int pri_call_add_standard_apdus(struct pri *pri, q931_call *call);
 
 void asn1_dump(struct pri *ctrl, const unsigned char *start_asn1, const unsigned char *end);
 
-void rose_handle_invoke(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, const struct fac_extension_header *header, const struct rose_msg_invoke *invoke);
-void rose_handle_result(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, const struct fac_extension_header *header, const struct rose_msg_result *result);
-void rose_handle_error(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, const struct fac_extension_header *header, const struct rose_msg_error *error);
-void rose_handle_reject(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, const struct fac_extension_header *header, const struct rose_msg_reject *reject);
+void rose_handle_invoke(struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, const struct fac_extension_header *header, const struct rose_msg_invoke *invoke);
+void rose_handle_result(struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, const struct fac_extension_header *header, const struct rose_msg_result *result);
+void rose_handle_error(struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, const struct fac_extension_header *header, const struct rose_msg_error *error);
+void rose_handle_reject(struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, const struct fac_extension_header *header, const struct rose_msg_reject *reject);
 
 int pri_cc_interrogate_rsp(struct pri *ctrl, q931_call *call, const struct rose_msg_invoke *invoke);
 void pri_cc_ptmp_request(struct pri *ctrl, q931_call *call, const struct rose_msg_invoke *invoke);
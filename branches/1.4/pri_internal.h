@@ -48,6 +48,74 @@ struct pri_sched {
 	struct timeval when;
 	void (*callback)(void *data);
 	void *data;
+	/*! Schedule order to keep timers with the same expiration time FIFO. */
+	unsigned seq;
+	/*! Position of this active timer in the expiration heap. */
+	unsigned heap_pos;
+	/*! Next free timer slot index + 1 if this slot is free. (0 if last) */
+	unsigned next_free;
+};
+
+/*! Open addressing hash index of Q.931 call records. */
+struct q931_call_hash {
+	/*! Hash slots using linear probing. (NULL if slot empty) */
+	struct q931_call **slot;
+	/*! Number of hash slots. (Power of 2 or zero) */
+	unsigned size;
+	/*! Number of bits in a hash slot index. */
+	unsigned bits;
+	/*! Number of call records in the index. */
+	unsigned used;
+};
+
+/*! Indexes kept alongside the Q.931 call pool list. */
+struct q931_call_index {
+	/*! Last call record in the call pool list. */
+	struct q931_call *tail;
+	/*! Serial number given to the last call record created. */
+	unsigned serial;
+	/*! Call pool records indexed by call reference value. */
+	struct q931_call_hash cr;
+	/*! Call pool records with a valid ECT link id indexed by link id. */
+	struct q931_call_hash link_id;
+	/*! Call pool records and their subcalls indexed by record address. */
+	struct q931_call_hash ptr;
+};
+
+/*! Block of preallocated Q.931 call records. */
+struct q931_call_chunk {
+	/*! Next allocated block. */
+	struct q931_call_chunk *next;
+	/*! Array of call records in this block. */
+	struct q931_call *calls;
+};
+
+/*! Slab of preallocated Q.931 call records. */
+struct q931_call_slab {
+	/*! Allocated blocks of call records. */
+	struct q931_call_chunk *chunks;
+	/*! Unused slab call records. (Linked by next) */
+	struct q931_call *free;
+	/*! Number of call records in the slab. */
+	unsigned size;
+	/*! Number of unused slab call records. */
+	unsigned num_free;
+	/*! Number of call record allocations taken from the slab. */
+	unsigned long hits;
+	/*! Number of call record allocations that had to use malloc(). */
+	unsigned long misses;
+};
+
+/*! Upper layer event waiting in the event queue. */
+struct pri_event_node {
+	/*! Next node in the list. */
+	struct pri_event_node *next;
+	/*! Deferred action to generate the event when dequeued. (NULL if event already present) */
+	void (*func)(void *data);
+	/*! Value to give the deferred action. */
+	void *data;
+	/*! Event with its own copy of the event subcommands. (No event if e is zero) */
+	struct pri_event_entry entry;
 };
 
 /*
@@ -71,12 +139,53 @@ struct pri_msg_line {
 	char str[2048];
 };
 
+/*! Number of bits in a timer id giving the slot within its timer pool. */
+#define PRI_SCHED_POOL_BITS	20
+/*! Number of timer pools a context can give out.  (Pool 0 is never used) */
+#define PRI_SCHED_POOLS		(1 << (32 - PRI_SCHED_POOL_BITS))
+
+/*! \brief Library state shared by the controllers created with it. */
+struct pri_context {
+	/*! Message output callback.  (NULL to write to stdout) */
+	void (*message)(struct pri *ctrl, char *stuff);
+	/*! Error output callback.  (NULL to write to stderr) */
+	void (*error)(struct pri *ctrl, char *stuff);
+	/*! Last scheduler timer pool id given out. */
+	unsigned pool_id;
+	/*!
+	 * \brief D channel owning each scheduler timer pool.  (Indexed by timer id >> PRI_SCHED_POOL_BITS)
+	 * \note Allocated with PRI_SCHED_POOLS entries when the first timer pool is created.
+	 */
+	struct pri **pool_owner;
+};
+
 /*! \brief D channel controller structure */
 struct pri {
+	/*! Library context the controller was created with. */
+	struct pri_context *ctx;
 	int fd;				/* File descriptor for D-Channel */
 	pri_io_cb read_func;		/* Read data callback */
 	pri_io_cb write_func;		/* Write data callback */
 	void *userdata;
+	/*! Frames collected during a processing pass for a batched write. */
+	struct {
+		/*! Batched write callback.  (NULL if not batching) */
+		pri_io_batch_cb write_func;
+		/*! Storage for the collected frames. */
+		unsigned char *buf;
+		/*! Octets of storage used. */
+		int used;
+		/*! Number of collected frames. */
+		int count;
+		/*! Collected frames. */
+		struct pri_io_frame frame[Q921_TX_BATCH_FRAMES];
+	} tx_batch;
+	/*! Binary trace record ring.  (NULL if not recording) */
+	struct pri_trace_ring *trace_ring;
+	/*! pcapng capture file writer.  (NULL if not capturing) */
+	struct pri_pcap *pcap;
+	/*! Call control commands from other threads.  (NULL if not created) */
+	struct pri_cmd_ring *cmd_ring;
 	/*! Accumulated pri_message() line. (Valid in master record only) */
 	struct pri_msg_line *msg_line;
 	/*! NFAS master/primary channel if appropriate */
@@ -84,14 +193,30 @@ struct pri {
 	/*! Next NFAS slaved D channel if appropriate */
 	struct pri *slave;
 	struct {
-		/*! Dynamically allocated array of timers that can grow as needed. */
-		struct pri_sched *timer;
-		/*! Numer of timer slots in the allocated array of timers. */
+		/*! Directory of timer slot chunks.  Allocated chunks never move. */
+		struct pri_sched **chunk;
+		/*! Number of timer slot chunks allocated. */
+		unsigned num_chunks;
+		/*! Number of timer slots in the allocated chunks. */
 		unsigned num_slots;
-		/*! Maximum timer slots currently needed. */
-		unsigned max_used;
+		/*! First free timer slot index + 1. (0 if no free slots) */
+		unsigned free_head;
 		/*! First timer id in this timer pool. */
 		unsigned first_id;
+		/*! Min-heap of active timer slot indexes ordered by expiration time. */
+		unsigned *heap;
+		/*! Number of active timers in the expiration heap. */
+		unsigned heap_used;
+		/*! Schedule order of the next timer started. */
+		unsigned seq;
+		/*! Current time read at the start of the event loop pass. */
+		struct timeval now;
+		/*! Nesting count of event loop passes using the cached current time. */
+		unsigned now_cached;
+		/*! Scheduler time base. */
+		enum pri_sched_clock clock;
+		/*! Application supplied scheduler time source. (NULL if not used) */
+		pri_time_cb time_func;
 	} sched;
 	int debug;			/* Debug stuff */
 	int state;			/* State of D-channel */
@@ -117,9 +242,14 @@ struct pri {
 	unsigned int aoc_support:1;/* TRUE if can send AOC events to the upper layer. */
 	unsigned int manual_connect_ack:1;/* TRUE if the CONNECT_ACKNOWLEDGE is sent with API call */
 	unsigned int mcid_support:1;/* TRUE if the upper layer supports MCID */
+	unsigned int stats_timing:1;/* TRUE if received frame processing is timed */
 
 	/*! Layer 2 link control for D channel. */
 	struct q921_link link;
+	/*! Layer 2 links indexed by assigned TEI.  (NULL if TEI not assigned) */
+	struct q921_link *tei_link[Q921_TEI_GROUP + 1];
+	/*! Automatic TEIs not assigned to a link.  (Bit n is TEI Q921_TEI_AUTO_FIRST + n) */
+	unsigned long long tei_free;
 	/*! Layer 2 persistence option. */
 	enum pri_layer2_persistence l2_persistence;
 	/*! T201 TEI Identity Check timer. */
@@ -137,16 +267,37 @@ struct pri {
 	pri_event ev;		/* Static event thingy */
 	/*! Subcommands for static event thingy. */
 	struct pri_subcommands subcmds;
+	/*! Upper layer events waiting to be delivered. */
+	struct {
+		/*! First queued event node. */
+		struct pri_event_node *head;
+		/*! Last queued event node. */
+		struct pri_event_node *tail;
+		/*! Event nodes delivered to the upper layer by the last call. */
+		struct pri_event_node *delivered;
+		/*! Pool of unused event nodes. */
+		struct pri_event_node *free;
+		/*! Time returned by pri_schedule_next() while events are queued. */
+		struct timeval when;
+	} evq;
 	
 	/* Q.931 calls */
 	struct q931_call **callpool;
 	struct q931_call *localpool;
+	/*! Indexes of the call pool.  (Points to the localindex of the callpool owner) */
+	struct q931_call_index *callindex;
+	struct q931_call_index localindex;
+	/*! Call record allocator.  (Points to the localslab of the callpool owner) */
+	struct q931_call_slab *callslab;
+	struct q931_call_slab localslab;
 
 	/* q921/q931 packet counters */
 	unsigned int q921_txcount;
 	unsigned int q921_rxcount;
 	unsigned int q931_txcount;
 	unsigned int q931_rxcount;
+	/*! Performance counters not kept elsewhere.  (See pri_get_stats()) */
+	struct pri_stats stats;
 
 	short last_invoke;	/* Last ROSE invoke ID (Valid in master record only) */
 
@@ -178,7 +329,7 @@ struct pri {
 	/*! For delayed processing of facility ie's. */
 	struct {
 		/*! Array of facility ie locations in the current received message. */
-		q931_ie *ie[MAX_FACILITY_IES];
+		const q931_ie *ie[MAX_FACILITY_IES];
 		/*! Codeset facility ie found within. */
 		unsigned char codeset[MAX_FACILITY_IES];
 		/*! Number of facility ie's in the array from the current received message. */
@@ -432,6 +583,12 @@ struct q931_call {
 	struct pri *pri;	/* D channel controller (master) */
 	struct q921_link *link;	/* Q.921 link associated with this call. */
 	struct q931_call *next;
+	/*! Previous call record in the call pool list.  (NULL if first or a subcall) */
+	struct q931_call *prev;
+	/*! Tells the record from earlier calls that used the same memory.  (0 for dummy calls) */
+	unsigned serial;
+	/*! TRUE if the record belongs to a call record slab block. */
+	int slab_owned;
 	int cr;				/* Call Reference */
 	/* Slotmap specified (bitmap of channels 31/24-1) (Channel Identifier IE) (-1 means not specified) */
 	int slotmap;
@@ -657,10 +814,6 @@ struct q931_call {
 
 	/*! Control the RESTART reception to the upper layer. */
 	struct {
-		/*! Timer ID of RESTART notification events to upper layer. */
-		int timer;
-		/*! Current RESTART notification index. */
-		int idx;
 		/*! Number of channels in the channel ID list. */
 		int count;
 		/*! Channel ID list */
@@ -845,8 +998,8 @@ struct pri_cc_record {
 	} msg;
 	/*! Party A availability status */
 	enum CC_PARTY_A_AVAILABILITY party_a_status;
-	/*! Indirect timer id to abort indirect action events. */
-	int t_indirect;
+	/*! TRUE if an indirect action is waiting in the event queue. */
+	int indirect_pending;
 	/*!
 	 * \brief PTMP T_RETENTION timer id.
 	 * \note
@@ -946,8 +1099,30 @@ int q931_is_call_valid_gripe(struct pri *ctrl, struct q931_call *call, const cha
 unsigned pri_schedule_event(struct pri *ctrl, int ms, void (*function)(void *data), void *data);
 
 extern pri_event *pri_schedule_run(struct pri *pri);
+void pri_schedule_pass_begin(struct pri *ctrl, const struct timeval *now);
+void pri_schedule_pass_end(struct pri *ctrl);
 
 void pri_schedule_del(struct pri *ctrl, unsigned id);
+void pri_schedule_destroy(struct pri *ctrl);
+
+void pri_event_save(struct pri *ctrl, struct pri_event_entry *entry, const pri_event *ev);
+int pri_event_enqueue(struct pri *ctrl, const pri_event *ev);
+int pri_event_defer(struct pri *ctrl, void (*func)(void *data), void *data);
+void pri_event_defer_del(struct pri *ctrl, void *data);
+pri_event *pri_event_deliver(struct pri *ctrl, pri_event *e, struct pri_event_node *mark);
+void pri_event_queue_destroy(struct pri *ctrl);
+
+void pri_trace_frame(struct pri *ctrl, const void *h, int len, int txrx);
+void pri_trace_q921_state(struct pri *ctrl, int tei, int old_state, int new_state);
+void pri_trace_call_state(struct pri *ctrl, int cr, int old_state, int new_state);
+void pri_trace_ring_destroy(struct pri *ctrl);
+
+void pri_pcap_frame(struct pri *ctrl, const void *h, int len, int txrx);
+
+void pri_cmd_ring_wake_set(struct pri *ctrl, void (*wake)(struct pri *ctrl, void *data), void *data);
+void pri_cmd_ring_destroy(struct pri *ctrl);
+int pri_cmd_ring_pending(struct pri *ctrl);
+void pri_cmd_ring_run(struct pri *ctrl);
 int pri_schedule_check(struct pri *ctrl, unsigned id, void (*function)(void *data), void *data);
 
 extern pri_event *pri_mkerror(struct pri *pri, char *errstr);
@@ -955,9 +1130,42 @@ extern pri_event *pri_mkerror(struct pri *pri, char *errstr);
 void pri_message(struct pri *ctrl, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
 void pri_error(struct pri *ctrl, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
 
+/*!
+ * \brief Determine if any of the given debug trace flags are enabled.
+ *
+ * \param ctrl D channel controller.
+ * \param flags PRI_DEBUG_xxx flags to check.
+ *
+ * \note Always false when built with LIBPRI_NO_TRACE so the
+ * compiler drops the trace code it guards.
+ */
+#if defined(LIBPRI_NO_TRACE)
+#define PRI_DEBUG_ON(ctrl, flags)	0
+#else
+#define PRI_DEBUG_ON(ctrl, flags)	((ctrl)->debug & (flags))
+#endif
+
+/*!
+ * \brief Output a debug trace message if any of the given flags are enabled.
+ *
+ * \param ctrl D channel controller.
+ * \param flags PRI_DEBUG_xxx flags that enable the message.
+ * \param ... pri_message() format and arguments.
+ *
+ * \note The message arguments are not evaluated unless the trace is enabled.
+ */
+#define PRI_TRACE(ctrl, flags, ...) \
+	do { \
+		if (PRI_DEBUG_ON(ctrl, flags)) { \
+			pri_message((ctrl), __VA_ARGS__); \
+		} \
+	} while (0)
+
 void libpri_copy_string(char *dst, const char *src, size_t size);
 
 void pri_link_destroy(struct q921_link *link);
+void pri_link_tei_add(struct q921_link *link);
+void pri_link_tei_del(struct q921_link *link);
 struct q921_link *pri_link_new(struct pri *ctrl, int sapi, int tei);
 
 void q931_init_call_record(struct q921_link *link, struct q931_call *call, int cr);
@@ -1023,6 +1231,9 @@ int q931_master_pass_event(struct pri *ctrl, struct q931_call *subcall, int msg_
 struct pri_subcommand *q931_alloc_subcommand(struct pri *ctrl);
 
 struct q931_call *q931_find_link_id_call(struct pri *ctrl, int link_id);
+int q931_set_link_id(struct pri *ctrl, struct q931_call *call, int link_id);
+int q931_call_slab_reserve(struct pri *ctrl, unsigned size);
+void q931_call_slab_destroy(struct q931_call_slab *slab);
 struct q931_call *q931_find_held_active_call(struct pri *ctrl, struct q931_call *held_call);
 
 int q931_request_subaddress(struct pri *ctrl, struct q931_call *call, int notify, const struct q931_party_name *name, const struct q931_party_number *number);
@@ -0,0 +1,370 @@
+/*
+ * libpri: An implementation of Primary Rate ISDN
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ *
+ * In addition, when this program is distributed with Asterisk in
+ * any form that would qualify as a 'combined work' or as a
+ * 'derivative work' (but not mere aggregation), you can redistribute
+ * and/or modify the combination under the terms of the license
+ * provided with that copy of Asterisk, instead of the license
+ * terms granted here.
+ */
+
+/*!
+ * \file
+ * \brief pcapng capture of D channel frames
+ *
+ * \details
+ * Frames are written with the LINKTYPE_LINUX_LAPD encapsulation so
+ * Wireshark can decode them with its LAPD and Q.931 dissectors.
+ * Captured frames are collected in memory and written out when the
+ * buffer fills or when the flush timer expires.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "compat.h"
+#include "libpri.h"
+#include "pri_internal.h"
+
+
+/*! Octets of captured frames collected before writing them. */
+#define PRI_PCAP_BUF_SIZE		(64 * 1024)
+/*! Longest time captured frames wait in memory. (ms) */
+#define PRI_PCAP_FLUSH_MS		1000
+
+/* pcapng block types */
+#define PCAPNG_BT_SHB			0x0A0D0D0A
+#define PCAPNG_BT_IDB			0x00000001
+#define PCAPNG_BT_EPB			0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC	0x1A2B3C4D
+
+/*! Link type of LAPD frames with a Linux cooked capture style header. */
+#define LINKTYPE_LINUX_LAPD		177
+/*! Octets of the LINKTYPE_LINUX_LAPD pseudo header. */
+#define LAPD_PSEUDO_HDR_LEN		16
+/* LINKTYPE_LINUX_LAPD pseudo header values */
+#define LAPD_PKTTYPE_HOST		0
+#define LAPD_PKTTYPE_OUTGOING	4
+#define LAPD_HATYPE				8445	/* ARPHRD_LAPD */
+#define LAPD_PROTOCOL			0x0030	/* ETH_P_LAPD */
+
+/*! Octets of an enhanced packet block without the packet data. */
+#define PCAPNG_EPB_OVERHEAD		32
+
+/*! \brief pcapng capture file writer. */
+struct pri_pcap {
+	/*! Name of the capture file. */
+	char *filename;
+	/*! Open capture file. */
+	int fd;
+	/*! Capture file size limit before rotating.  (Zero if no rotation) */
+	long rotate_size;
+	/*! Octets written to the current capture file. */
+	long file_size;
+	/*! Flush timer id. */
+	unsigned flush_timer;
+	/*! Octets of buf used. */
+	int used;
+	/*! Captured frames not written yet. */
+	unsigned char buf[PRI_PCAP_BUF_SIZE];
+};
+
+/*!
+ * \internal
+ * \brief Put a 32 bit value into the capture buffer.
+ *
+ * \param pcap Capture file writer.
+ * \param value Value to put in host byte order.
+ *
+ * \return Nothing
+ */
+static void pri_pcap_put32(struct pri_pcap *pcap, unsigned int value)
+{
+	memcpy(pcap->buf + pcap->used, &value, sizeof(value));
+	pcap->used += sizeof(value);
+}
+
+/*!
+ * \internal
+ * \brief Put a 16 bit value into the capture buffer.
+ *
+ * \param pcap Capture file writer.
+ * \param value Value to put in host byte order.
+ *
+ * \return Nothing
+ */
+static void pri_pcap_put16(struct pri_pcap *pcap, unsigned short value)
+{
+	memcpy(pcap->buf + pcap->used, &value, sizeof(value));
+	pcap->used += sizeof(value);
+}
+
+/*!
+ * \internal
+ * \brief Put a 16 bit value into the capture buffer in network byte order.
+ *
+ * \param pcap Capture file writer.
+ * \param value Value to put.
+ *
+ * \return Nothing
+ */
+static void pri_pcap_put16_be(struct pri_pcap *pcap, unsigned short value)
+{
+	pcap->buf[pcap->used++] = value >> 8;
+	pcap->buf[pcap->used++] = value;
+}
+
+/*!
+ * \internal
+ * \brief Put the section header and interface description blocks.
+ *
+ * \param pcap Capture file writer.
+ *
+ * \note The pcapng blocks are written in host byte order.  Readers
+ * tell which from the byte order magic.
+ *
+ * \return Nothing
+ */
+static void pri_pcap_put_header(struct pri_pcap *pcap)
+{
+	/* Section header block */
+	pri_pcap_put32(pcap, PCAPNG_BT_SHB);
+	pri_pcap_put32(pcap, 28);
+	pri_pcap_put32(pcap, PCAPNG_BYTE_ORDER_MAGIC);
+	pri_pcap_put16(pcap, 1);	/* Major version */
+	pri_pcap_put16(pcap, 0);	/* Minor version */
+	pri_pcap_put32(pcap, 0xFFFFFFFF);	/* Section length unknown */
+	pri_pcap_put32(pcap, 0xFFFFFFFF);
+	pri_pcap_put32(pcap, 28);
+
+	/* Interface description block */
+	pri_pcap_put32(pcap, PCAPNG_BT_IDB);
+	pri_pcap_put32(pcap, 20);
+	pri_pcap_put16(pcap, LINKTYPE_LINUX_LAPD);
+	pri_pcap_put16(pcap, 0);
+	pri_pcap_put32(pcap, 0);	/* No snap length limit */
+	pri_pcap_put32(pcap, 20);
+}
+
+/*!
+ * \internal
+ * \brief Write the captured frames to the capture file.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \return Nothing
+ */
+static void pri_pcap_flush(struct pri *ctrl)
+{
+	struct pri_pcap *pcap = ctrl->pcap;
+	int written;
+	int res;
+
+	for (written = 0; written < pcap->used; written += res) {
+		res = write(pcap->fd, pcap->buf + written, pcap->used - written);
+		if (res < 0) {
+			if (errno == EINTR) {
+				res = 0;
+				continue;
+			}
+			pri_error(ctrl, "Unable to write capture file '%s': %s\n", pcap->filename,
+				strerror(errno));
+			break;
+		}
+	}
+	pcap->file_size += written;
+	pcap->used = 0;
+}
+
+/*!
+ * \internal
+ * \brief Flush timer expired.
+ *
+ * \param data D channel controller.
+ *
+ * \return Nothing
+ */
+static void pri_pcap_flush_expiry(void *data)
+{
+	struct pri *ctrl = data;
+
+	ctrl->pcap->flush_timer = 0;
+	pri_pcap_flush(ctrl);
+}
+
+/*!
+ * \internal
+ * \brief Start a new capture file and keep the previous one.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \details
+ * The current capture file is renamed with a ".1" suffix replacing
+ * any file already there.  Disk usage is then bounded by twice the
+ * rotation size.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int pri_pcap_rotate(struct pri *ctrl)
+{
+	struct pri_pcap *pcap = ctrl->pcap;
+	char old_name[PATH_MAX];
+
+	pri_pcap_flush(ctrl);
+	close(pcap->fd);
+	snprintf(old_name, sizeof(old_name), "%s.1", pcap->filename);
+	if (rename(pcap->filename, old_name)) {
+		pri_error(ctrl, "Unable to rename capture file '%s': %s\n", pcap->filename,
+			strerror(errno));
+	}
+	pcap->fd = open(pcap->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (pcap->fd < 0) {
+		pri_error(ctrl, "Unable to open capture file '%s': %s\n", pcap->filename,
+			strerror(errno));
+		return -1;
+	}
+	pcap->file_size = 0;
+	pri_pcap_put_header(pcap);
+	return 0;
+}
+
+/*!
+ * \brief Capture a Q.921 frame.
+ *
+ * \param ctrl D channel controller.
+ * \param h Q.921 frame.
+ * \param len Length of the frame without the FCS.
+ * \param txrx TRUE if the frame is transmitted.
+ *
+ * \note Caller checks that capture is enabled.
+ *
+ * \return Nothing
+ */
+void pri_pcap_frame(struct pri *ctrl, const void *h, int len, int txrx)
+{
+	struct pri_pcap *pcap = ctrl->pcap;
+	struct timeval now;
+	unsigned long long usec;
+	int pkt_len;
+	int pad;
+	int block_len;
+
+	if (len <= 0 || PRI_PCAP_BUF_SIZE - PCAPNG_EPB_OVERHEAD - LAPD_PSEUDO_HDR_LEN - 3 < len) {
+		return;
+	}
+	pkt_len = LAPD_PSEUDO_HDR_LEN + len;
+	pad = (4 - (pkt_len & 3)) & 3;
+	block_len = PCAPNG_EPB_OVERHEAD + pkt_len + pad;
+
+	if (pcap->rotate_size && pcap->rotate_size < pcap->file_size + pcap->used + block_len
+		&& pri_pcap_rotate(ctrl)) {
+		/* Capture cannot continue. */
+		pri_pcap_close(ctrl);
+		return;
+	}
+	if (PRI_PCAP_BUF_SIZE - pcap->used < block_len) {
+		pri_pcap_flush(ctrl);
+	}
+
+	pri_schedule_now(ctrl, &now);
+	usec = (unsigned long long) now.tv_sec * 1000000 + now.tv_usec;
+
+	/* Enhanced packet block */
+	pri_pcap_put32(pcap, PCAPNG_BT_EPB);
+	pri_pcap_put32(pcap, block_len);
+	pri_pcap_put32(pcap, 0);	/* Interface id */
+	pri_pcap_put32(pcap, usec >> 32);
+	pri_pcap_put32(pcap, usec);
+	pri_pcap_put32(pcap, pkt_len);
+	pri_pcap_put32(pcap, pkt_len);
+
+	/* LINKTYPE_LINUX_LAPD pseudo header */
+	pri_pcap_put16_be(pcap, txrx ? LAPD_PKTTYPE_OUTGOING : LAPD_PKTTYPE_HOST);
+	pri_pcap_put16_be(pcap, LAPD_HATYPE);
+	pri_pcap_put16_be(pcap, 1);	/* Address length */
+	/* Address: Which side of the interface we are. */
+	memset(pcap->buf + pcap->used, 0, 8);
+	pcap->buf[pcap->used] = (ctrl->localtype == PRI_NETWORK) ? 1 : 0;
+	pcap->used += 8;
+	pri_pcap_put16_be(pcap, LAPD_PROTOCOL);
+
+	memcpy(pcap->buf + pcap->used, h, len);
+	pcap->used += len;
+	memset(pcap->buf + pcap->used, 0, pad);
+	pcap->used += pad;
+	pri_pcap_put32(pcap, block_len);
+
+	if (!pcap->flush_timer) {
+		pcap->flush_timer = pri_schedule_event(ctrl, PRI_PCAP_FLUSH_MS,
+			pri_pcap_flush_expiry, ctrl);
+	}
+}
+
+int pri_pcap_open(struct pri *ctrl, const char *filename, int rotate_size)
+{
+	struct pri_pcap *pcap;
+
+	if (!ctrl || !filename || rotate_size < 0) {
+		return -1;
+	}
+	pri_pcap_close(ctrl);
+
+	pcap = calloc(1, sizeof(*pcap));
+	if (!pcap) {
+		return -1;
+	}
+	pcap->filename = strdup(filename);
+	if (!pcap->filename) {
+		free(pcap);
+		return -1;
+	}
+	pcap->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (pcap->fd < 0) {
+		pri_error(ctrl, "Unable to open capture file '%s': %s\n", filename,
+			strerror(errno));
+		free(pcap->filename);
+		free(pcap);
+		return -1;
+	}
+	pcap->rotate_size = rotate_size;
+	pri_pcap_put_header(pcap);
+	ctrl->pcap = pcap;
+	return 0;
+}
+
+void pri_pcap_close(struct pri *ctrl)
+{
+	struct pri_pcap *pcap;
+
+	if (!ctrl || !ctrl->pcap) {
+		return;
+	}
+	pcap = ctrl->pcap;
+	pri_schedule_del(ctrl, pcap->flush_timer);
+	if (0 <= pcap->fd) {
+		pri_pcap_flush(ctrl);
+		close(pcap->fd);
+	}
+	free(pcap->filename);
+	free(pcap);
+	ctrl->pcap = NULL;
+}
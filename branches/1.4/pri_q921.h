@@ -170,12 +170,42 @@ enum q921_tx_frame_status {
 };
 
 typedef struct q921_frame {
-	struct q921_frame *next;			/*!< Next in list */
 	int len;							/*!< Length of header + body */
 	enum q921_tx_frame_status status;	/*!< Tx frame status */
 	q921_i h;							/*!< Actual frame contents. */
 } q921_frame;
 
+/*! Largest I frame information field a Tx queue frame buffer can hold. */
+#define Q921_TX_FRAME_DATA_MAX	1024
+/*! Initial number of Tx queue ring positions.  Covers the modulo 128 sequence space. */
+#define Q921_TX_QUEUE_INITIAL	128
+/*! Maximum number of frames collected for one batched write. */
+#define Q921_TX_BATCH_FRAMES	32
+/*! Octets of frame storage collected for one batched write. */
+#define Q921_TX_BATCH_OCTETS	(8 * (Q921_TX_FRAME_DATA_MAX + 6))
+
+/*!
+ * \brief Q.921 I frame Tx queue.
+ *
+ * \details
+ * Ring of reusable frame buffers.  The sequence counters run freely
+ * and a frame's ring position is its sequence modulo size.
+ * Frames in [head, next) have been sent and await acknowledgement.
+ * Frames in [next, tail) have not been sent yet.
+ */
+struct q921_tx_queue {
+	/*! Frame buffers.  (Allocated on first use of a ring position) */
+	struct q921_frame **ring;
+	/*! Number of ring positions.  (Power of 2) */
+	unsigned size;
+	/*! Sequence of the oldest queued frame. */
+	unsigned head;
+	/*! Sequence of the first frame not currently sent. */
+	unsigned next;
+	/*! Sequence following the newest queued frame. */
+	unsigned tail;
+};
+
 #define Q921_INC(j) (j) = (((j) + 1) % 128)
 #define Q921_DEC(j) (j) = (((j) - 1) % 128)
 
@@ -220,7 +250,7 @@ struct q921_link {
 	struct q931_call *dummy_call;
 
 	/*! Q.921 Re-transmission queue */
-	struct q921_frame *tx_queue;
+	struct q921_tx_queue tx_queue;
 
 	/*! Q.921 State */
 	enum q921_state state;
@@ -273,7 +303,7 @@ static inline int Q921_ADD(int a, int b)
 }
 
 /* Dumps a *known good* Q.921 packet */
-extern void q921_dump(struct pri *pri, q921_h *h, int len, int debugflags, int txrx);
+extern void q921_dump(struct pri *pri, const q921_h *h, int len, int debugflags, int txrx);
 
 /* Bring up the D-channel */
 void q921_start(struct q921_link *link);
@@ -281,9 +311,12 @@ void q921_bring_layer2_up(struct pri *ctrl);
 
 //extern void q921_reset(struct pri *pri, int reset_iqueue);
 
-extern pri_event *q921_receive(struct pri *pri, q921_h *h, int len);
+extern pri_event *q921_receive(struct pri *pri, const q921_h *h, int len);
 
 int q921_transmit_iframe(struct q921_link *link, void *buf, int len, int cr);
+void q921_free_iqueue(struct q921_link *link);
+void q921_transmit_flush(struct pri *ctrl);
+const char *q921_state2str(enum q921_state state);
 
 int q921_transmit_uiframe(struct q921_link *link, void *buf, int len);
 
@@ -453,7 +453,7 @@ extern int maintenance_service(struct pri *pri, int span, int channel, int chang
 /* Q.SIG specific */
 #define QSIG_IE_TRANSIT_COUNT		0x31
 
-int q931_receive(struct q921_link *link, q931_h *h, int len);
+int q931_receive(struct q921_link *link, const q931_h *h, int len);
 
 extern int q931_alerting(struct pri *pri, q931_call *call, int channel, int info);
 
@@ -494,7 +494,7 @@ extern int q931_setup(struct pri *pri, q931_call *c, struct pri_sr *req);
 
 int q931_register(struct pri *ctrl, q931_call *call);
 
-void q931_dump(struct pri *ctrl, int tei, q931_h *h, int len, int txrx);
+void q931_dump(struct pri *ctrl, int tei, const q931_h *h, int len, int txrx);
 
 void q931_destroycall(struct pri *pri, q931_call *c);
 
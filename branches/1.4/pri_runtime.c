@@ -0,0 +1,813 @@
+/*
+ * libpri: An implementation of Primary Rate ISDN
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ *
+ * In addition, when this program is distributed with Asterisk in
+ * any form that would qualify as a 'combined work' or as a
+ * 'derivative work' (but not mere aggregation), you can redistribute
+ * and/or modify the combination under the terms of the license
+ * provided with that copy of Asterisk, instead of the license
+ * terms granted here.
+ */
+
+/*!
+ * \file
+ * \brief Worker thread pool driving many D channel controllers
+ *
+ * \details
+ * Each worker owns an epoll set holding the D channel fd and a
+ * timerfd for each of its controllers plus a wake eventfd.  The
+ * timerfd is kept armed at the pri_schedule_next_ns() deadline so
+ * a worker only touches the controllers that have work to do.
+ *
+ * Events are written by pri_process_batch() straight into the free
+ * slots of the worker event queue, then published by advancing the
+ * queue tail.  The application thread reading the queue only
+ * advances the head.
+ *
+ * Commands from pri_cmd_submit() wake the worker through the wake
+ * eventfd like pri_runtime_call() does.
+ *
+ * A controller finding the event queue full is taken out of the
+ * epoll set until the application frees space.  The application
+ * then wakes the worker through the wake eventfd.  The other
+ * controllers of the worker keep running meanwhile.
+ */
+
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "compat.h"
+#include "libpri.h"
+#include "pri_internal.h"
+
+#if defined(__linux__)
+
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+/*! Default number of events a worker queue holds. */
+#define PRI_RT_QUEUE_SIZE		64
+/*! Most epoll events handled per wait. */
+#define PRI_RT_EPOLL_EVENTS		64
+/*! epoll data value of the worker wake eventfd. */
+#define PRI_RT_WAKE				UINT64_MAX
+
+/*! \brief Controller owned by a worker. */
+struct pri_rt_span {
+	/*! D channel controller. */
+	struct pri *ctrl;
+	/*! Deadline timer of the controller. */
+	int timer_fd;
+	/*! Position of the controller in the worker span array. */
+	unsigned idx;
+	/*! TRUE if out of the epoll set waiting for event queue space. */
+	int parked;
+};
+
+/*! \brief Function queued to run on a worker. */
+struct pri_rt_cmd {
+	/*! Next queued function. */
+	struct pri_rt_cmd *next;
+	/*! Controller to run the function on. */
+	struct pri_rt_span *span;
+	/*! Function to run. */
+	void (*func)(struct pri *ctrl, void *data);
+	/*! Value to give the function. */
+	void *data;
+};
+
+/*! \brief Worker thread. */
+struct pri_rt_worker {
+	/*! Worker thread. */
+	pthread_t thread;
+	/*! epoll set of the worker. */
+	int epoll_fd;
+	/*! Wakes the worker for queued functions or to stop. */
+	int wake_fd;
+	/*! Tells the application events are queued. */
+	int event_fd;
+	/*! Controllers of the worker. */
+	struct pri_rt_span **span;
+	/*! Number of controllers of the worker. */
+	unsigned num_spans;
+	/*! TRUE if the worker is to exit. */
+	int stop;
+	/*! Number of controllers out of the epoll set.  (Worker only) */
+	unsigned num_parked;
+	/*! TRUE if the worker wants a wake when event queue space is freed. */
+	int waiting;
+
+	/*! Protects the queued function list. */
+	pthread_mutex_t lock;
+	/*! Queued functions to run. */
+	struct pri_rt_cmd *cmd_head;
+	/*! Last queued function. */
+	struct pri_rt_cmd *cmd_tail;
+
+	/*! Event queue slots. */
+	struct pri_event_entry *entry;
+	/*! Controller of each event queue slot. */
+	struct pri **entry_ctrl;
+	/*! Number of event queue slots.  (Power of 2) */
+	unsigned size;
+	/*! Events taken by the application.  (Written by the application only) */
+	unsigned head;
+	/*! Events queued by the worker.  (Written by the worker only) */
+	unsigned tail;
+};
+
+/*! \brief Worker thread pool runtime. */
+struct pri_runtime {
+	/*! Worker threads. */
+	struct pri_rt_worker *worker;
+	/*! Number of worker threads. */
+	int num_workers;
+	/*! TRUE if the worker threads are running. */
+	int started;
+};
+
+/*!
+ * \internal
+ * \brief Arm the deadline timer of the controller.
+ *
+ * \param span Controller owned by the worker.
+ *
+ * \return Nothing
+ */
+static void pri_rt_span_arm(struct pri_rt_span *span)
+{
+	struct itimerspec its;
+	long long deadline;
+
+	memset(&its, 0, sizeof(its));
+	deadline = pri_schedule_next_ns(span->ctrl);
+	if (0 <= deadline) {
+		if (!deadline) {
+			/* Zero would disarm the timer. */
+			deadline = 1;
+		}
+		its.it_value.tv_sec = deadline / 1000000000LL;
+		its.it_value.tv_nsec = deadline % 1000000000LL;
+	}
+	timerfd_settime(span->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/*!
+ * \internal
+ * \brief Arm the deadline timers of the controller and its NFAS group.
+ *
+ * \param worker Worker owning the controller.
+ * \param span Controller owned by the worker.
+ *
+ * \note An NFAS D channel can start timers on the others in its group.
+ *
+ * \return Nothing
+ */
+static void pri_rt_group_arm(struct pri_rt_worker *worker, struct pri_rt_span *span)
+{
+	struct pri *master;
+	unsigned idx;
+
+	if (!span->ctrl->nfas) {
+		pri_rt_span_arm(span);
+		return;
+	}
+	master = PRI_NFAS_MASTER(span->ctrl);
+	for (idx = 0; idx < worker->num_spans; ++idx) {
+		if (PRI_NFAS_MASTER(worker->span[idx]->ctrl) == master) {
+			pri_rt_span_arm(worker->span[idx]);
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Put the controller fds in or take them out of the epoll set.
+ *
+ * \param worker Worker owning the controller.
+ * \param span Controller owned by the worker.
+ * \param enable TRUE to poll the fds.
+ *
+ * \note The fds stay registered.  Only the polled events change.
+ *
+ * \return Nothing
+ */
+static void pri_rt_span_poll(struct pri_rt_worker *worker, struct pri_rt_span *span, int enable)
+{
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = enable ? EPOLLIN : 0;
+	ev.data.u64 = (uint64_t) span->idx << 1;
+	epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, span->ctrl->fd, &ev);
+	ev.data.u64 |= 1;
+	epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, span->timer_fd, &ev);
+}
+
+/*!
+ * \internal
+ * \brief Stop polling the controller until there is event queue space.
+ *
+ * \param worker Worker owning the controller.
+ * \param span Controller owned by the worker.
+ *
+ * \return Nothing
+ */
+static void pri_rt_span_park(struct pri_rt_worker *worker, struct pri_rt_span *span)
+{
+	if (span->parked) {
+		return;
+	}
+	span->parked = 1;
+	++worker->num_parked;
+	pri_rt_span_poll(worker, span, 0);
+}
+
+/*!
+ * \internal
+ * \brief Poll the parked controllers again if there is event queue space.
+ *
+ * \param worker Worker with parked controllers.
+ *
+ * \note If the queue is still full the application wakes the worker
+ * once it takes events.
+ *
+ * \return Nothing
+ */
+static void pri_rt_worker_unpark(struct pri_rt_worker *worker)
+{
+	unsigned idx;
+
+	__atomic_store_n(&worker->waiting, 1, __ATOMIC_SEQ_CST);
+	if (worker->tail - __atomic_load_n(&worker->head, __ATOMIC_SEQ_CST) == worker->size) {
+		return;
+	}
+	__atomic_store_n(&worker->waiting, 0, __ATOMIC_RELAXED);
+
+	for (idx = 0; idx < worker->num_spans; ++idx) {
+		if (worker->span[idx]->parked) {
+			worker->span[idx]->parked = 0;
+			pri_rt_span_poll(worker, worker->span[idx], 1);
+		}
+	}
+	worker->num_parked = 0;
+}
+
+/*!
+ * \internal
+ * \brief Process the controller and queue the generated events.
+ *
+ * \param worker Worker owning the controller.
+ * \param span Controller owned by the worker.
+ * \param readable TRUE if the D channel fd is readable.
+ *
+ * \note The controller is parked if the event queue is full.
+ *
+ * \retval Number of events queued.
+ * \retval -1 if the event queue is full.
+ */
+static int pri_rt_span_run(struct pri_rt_worker *worker, struct pri_rt_span *span, int readable)
+{
+	struct pri_event_batch ring;
+	unsigned head;
+	int added;
+	int idx;
+
+	/* Let the controller fill the free queue slots directly. */
+	head = __atomic_load_n(&worker->head, __ATOMIC_ACQUIRE);
+	ring.entry = worker->entry;
+	ring.size = worker->size;
+	ring.head = head & (worker->size - 1);
+	ring.count = worker->tail - head;
+	if (ring.count == ring.size) {
+		/* The armed fds report the controller again once it is unparked. */
+		pri_rt_group_arm(worker, span);
+		pri_rt_span_park(worker, span);
+		return -1;
+	}
+	added = pri_process_batch(span->ctrl, readable, &ring);
+	if (0 < added) {
+		for (idx = 0; idx < added; ++idx) {
+			worker->entry_ctrl[(worker->tail + idx) & (worker->size - 1)] = span->ctrl;
+		}
+		__atomic_store_n(&worker->tail, worker->tail + added, __ATOMIC_RELEASE);
+	}
+	pri_rt_group_arm(worker, span);
+	return added;
+}
+
+/*!
+ * \internal
+ * \brief Wake the worker for a command submitted to one of its controllers.
+ *
+ * \param ctrl D channel controller.
+ * \param data Worker owning the controller.
+ *
+ * \return Nothing
+ */
+static void pri_rt_cmd_wake(struct pri *ctrl, void *data)
+{
+	struct pri_rt_worker *worker = data;
+	uint64_t value = 1;
+
+	if (write(worker->wake_fd, &value, sizeof(value)) < 0) {
+		/* The worker is already being woken. */
+	}
+}
+
+/*!
+ * \internal
+ * \brief Run the functions queued for the worker.
+ *
+ * \param worker Worker to run the functions on.
+ *
+ * \note Also runs the commands submitted to the controller command rings.
+ *
+ * \retval TRUE if any events were queued.
+ */
+static int pri_rt_worker_cmds(struct pri_rt_worker *worker)
+{
+	struct pri_rt_cmd *cmd;
+	struct pri_rt_cmd *next;
+	unsigned idx;
+	int queued = 0;
+
+	for (idx = 0; idx < worker->num_spans; ++idx) {
+		if (pri_cmd_ring_pending(worker->span[idx]->ctrl)
+			&& 0 < pri_rt_span_run(worker, worker->span[idx], 0)) {
+			queued = 1;
+		}
+	}
+
+	pthread_mutex_lock(&worker->lock);
+	cmd = worker->cmd_head;
+	worker->cmd_head = NULL;
+	worker->cmd_tail = NULL;
+	pthread_mutex_unlock(&worker->lock);
+
+	while (cmd) {
+		next = cmd->next;
+		cmd->func(cmd->span->ctrl, cmd->data);
+		if (0 < pri_rt_span_run(worker, cmd->span, 0)) {
+			queued = 1;
+		}
+		free(cmd);
+		cmd = next;
+	}
+	return queued;
+}
+
+/*!
+ * \internal
+ * \brief Worker thread.
+ *
+ * \param data Worker.
+ *
+ * \return NULL
+ */
+static void *pri_rt_worker_thread(void *data)
+{
+	struct pri_rt_worker *worker = data;
+	struct epoll_event events[PRI_RT_EPOLL_EVENTS];
+	struct pri_rt_span *span;
+	uint64_t value;
+	unsigned idx;
+	int queued;
+	int num;
+	int x;
+
+	/* Pick up any timers started before the worker took over. */
+	for (idx = 0; idx < worker->num_spans; ++idx) {
+		pri_rt_span_arm(worker->span[idx]);
+	}
+
+	while (!__atomic_load_n(&worker->stop, __ATOMIC_ACQUIRE)) {
+		num = epoll_wait(worker->epoll_fd, events, PRI_RT_EPOLL_EVENTS, -1);
+		if (num < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			pri_error(NULL, "Runtime worker epoll_wait failed: %s\n", strerror(errno));
+			break;
+		}
+
+		queued = 0;
+		for (x = 0; x < num; ++x) {
+			if (events[x].data.u64 == PRI_RT_WAKE) {
+				if (read(worker->wake_fd, &value, sizeof(value)) < 0) {
+					/* Nothing to clear. */
+				}
+				if (pri_rt_worker_cmds(worker)) {
+					queued = 1;
+				}
+				continue;
+			}
+			span = worker->span[events[x].data.u64 >> 1];
+			if (span->parked) {
+				/* Parked by an earlier event of this wait. */
+				continue;
+			}
+			if (0 < pri_rt_span_run(worker, span, !(events[x].data.u64 & 1))) {
+				queued = 1;
+			}
+		}
+		if (queued) {
+			value = 1;
+			if (write(worker->event_fd, &value, sizeof(value)) < 0) {
+				/* The counter is already signalling the application. */
+			}
+		}
+		if (worker->num_parked) {
+			pri_rt_worker_unpark(worker);
+		}
+	}
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Release the resources of the worker.
+ *
+ * \param worker Worker to release.
+ *
+ * \return Nothing
+ */
+static void pri_rt_worker_destroy(struct pri_rt_worker *worker)
+{
+	struct pri_rt_cmd *cmd;
+	unsigned idx;
+
+	for (idx = 0; idx < worker->num_spans; ++idx) {
+		close(worker->span[idx]->timer_fd);
+		free(worker->span[idx]);
+	}
+	free(worker->span);
+	while ((cmd = worker->cmd_head)) {
+		worker->cmd_head = cmd->next;
+		free(cmd);
+	}
+	pthread_mutex_destroy(&worker->lock);
+	if (0 <= worker->epoll_fd) {
+		close(worker->epoll_fd);
+	}
+	if (0 <= worker->wake_fd) {
+		close(worker->wake_fd);
+	}
+	if (0 <= worker->event_fd) {
+		close(worker->event_fd);
+	}
+	free(worker->entry);
+	free(worker->entry_ctrl);
+}
+
+/*!
+ * \internal
+ * \brief Initialize the worker.
+ *
+ * \param worker Worker to initialize.
+ * \param size Number of event queue slots.  (Power of 2)
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int pri_rt_worker_init(struct pri_rt_worker *worker, unsigned size)
+{
+	struct epoll_event ev;
+
+	pthread_mutex_init(&worker->lock, NULL);
+	worker->size = size;
+	worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	worker->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	worker->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	worker->entry = calloc(size, sizeof(*worker->entry));
+	worker->entry_ctrl = calloc(size, sizeof(*worker->entry_ctrl));
+	if (worker->epoll_fd < 0 || worker->wake_fd < 0 || worker->event_fd < 0
+		|| !worker->entry || !worker->entry_ctrl) {
+		return -1;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u64 = PRI_RT_WAKE;
+	return epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->wake_fd, &ev);
+}
+
+struct pri_runtime *pri_runtime_new(int workers, int queue_size)
+{
+	struct pri_runtime *rt;
+	unsigned size;
+	int idx;
+
+	if (workers <= 0) {
+		return NULL;
+	}
+	if (queue_size <= 0) {
+		queue_size = PRI_RT_QUEUE_SIZE;
+	}
+	for (size = 1; size < queue_size; size <<= 1) {
+	}
+
+	rt = calloc(1, sizeof(*rt));
+	if (!rt) {
+		return NULL;
+	}
+	rt->worker = calloc(workers, sizeof(*rt->worker));
+	if (!rt->worker) {
+		free(rt);
+		return NULL;
+	}
+	for (idx = 0; idx < workers; ++idx) {
+		rt->worker[idx].epoll_fd = -1;
+		rt->worker[idx].wake_fd = -1;
+		rt->worker[idx].event_fd = -1;
+	}
+	for (idx = 0; idx < workers; ++idx) {
+		++rt->num_workers;
+		if (pri_rt_worker_init(&rt->worker[idx], size)) {
+			pri_runtime_destroy(rt);
+			return NULL;
+		}
+	}
+	return rt;
+}
+
+int pri_runtime_add(struct pri_runtime *rt, struct pri *ctrl)
+{
+	struct pri_rt_worker *worker;
+	struct pri_rt_span **spans;
+	struct pri_rt_span *span;
+	struct pri *master;
+	struct epoll_event ev;
+	unsigned idx;
+	int best;
+	int x;
+
+	if (!rt || !ctrl || rt->started || ctrl->fd < 0) {
+		return -1;
+	}
+
+	/* Keep an NFAS group together, else balance the controllers. */
+	master = PRI_NFAS_MASTER(ctrl);
+	best = 0;
+	for (x = 0; x < rt->num_workers; ++x) {
+		worker = &rt->worker[x];
+		for (idx = 0; idx < worker->num_spans; ++idx) {
+			if (worker->span[idx]->ctrl == ctrl) {
+				/* Already added. */
+				return -1;
+			}
+			if (PRI_NFAS_MASTER(worker->span[idx]->ctrl) == master) {
+				break;
+			}
+		}
+		if (idx < worker->num_spans) {
+			best = x;
+			break;
+		}
+		if (worker->num_spans < rt->worker[best].num_spans) {
+			best = x;
+		}
+	}
+	worker = &rt->worker[best];
+
+	spans = realloc(worker->span, (worker->num_spans + 1) * sizeof(*spans));
+	if (!spans) {
+		return -1;
+	}
+	worker->span = spans;
+	span = calloc(1, sizeof(*span));
+	if (!span) {
+		return -1;
+	}
+	span->ctrl = ctrl;
+	span->idx = worker->num_spans;
+	span->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (span->timer_fd < 0) {
+		free(span);
+		return -1;
+	}
+
+	/* The low bit of the epoll data tells the deadline timer from the D channel. */
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u64 = (uint64_t) worker->num_spans << 1;
+	if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, ctrl->fd, &ev)) {
+		close(span->timer_fd);
+		free(span);
+		return -1;
+	}
+	ev.data.u64 |= 1;
+	if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, span->timer_fd, &ev)) {
+		epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, ctrl->fd, NULL);
+		close(span->timer_fd);
+		free(span);
+		return -1;
+	}
+	worker->span[worker->num_spans++] = span;
+	pri_cmd_ring_wake_set(ctrl, pri_rt_cmd_wake, worker);
+	return best;
+}
+
+int pri_runtime_start(struct pri_runtime *rt)
+{
+	int idx;
+
+	if (!rt || rt->started) {
+		return -1;
+	}
+	for (idx = 0; idx < rt->num_workers; ++idx) {
+		if (pthread_create(&rt->worker[idx].thread, NULL, pri_rt_worker_thread,
+			&rt->worker[idx])) {
+			/* Stop the ones already running. */
+			rt->num_workers = idx;
+			rt->started = 1;
+			pri_runtime_destroy(rt);
+			return -1;
+		}
+	}
+	rt->started = 1;
+	return 0;
+}
+
+void pri_runtime_destroy(struct pri_runtime *rt)
+{
+	struct pri_rt_worker *worker;
+	uint64_t value = 1;
+	int idx;
+
+	if (!rt) {
+		return;
+	}
+	for (idx = 0; idx < rt->num_workers; ++idx) {
+		worker = &rt->worker[idx];
+		if (rt->started) {
+			__atomic_store_n(&worker->stop, 1, __ATOMIC_RELEASE);
+			if (write(worker->wake_fd, &value, sizeof(value)) < 0) {
+				/* The worker is already being woken. */
+			}
+			pthread_join(worker->thread, NULL);
+		}
+		pri_rt_worker_destroy(worker);
+	}
+	free(rt->worker);
+	free(rt);
+}
+
+int pri_runtime_event_fd(struct pri_runtime *rt, int worker)
+{
+	if (!rt || worker < 0 || rt->num_workers <= worker) {
+		return -1;
+	}
+	return rt->worker[worker].event_fd;
+}
+
+int pri_runtime_get_events(struct pri_runtime *rt, int worker, struct pri_runtime_event *out, int max)
+{
+	struct pri_rt_worker *w;
+	uint64_t value;
+	unsigned head;
+	unsigned tail;
+	unsigned slot;
+	int count;
+
+	if (!rt || worker < 0 || rt->num_workers <= worker || !out || max < 0) {
+		return -1;
+	}
+	w = &rt->worker[worker];
+	if (read(w->event_fd, &value, sizeof(value)) < 0) {
+		/* No new events signalled.  Check the queue anyway. */
+	}
+
+	head = w->head;
+	tail = __atomic_load_n(&w->tail, __ATOMIC_ACQUIRE);
+	for (count = 0; count < max && head != tail; ++count, ++head) {
+		slot = head & (w->size - 1);
+		out[count].ctrl = w->entry_ctrl[slot];
+		pri_event_save(NULL, &out[count].entry, &w->entry[slot].ev);
+		out[count].entry.call_serial = w->entry[slot].call_serial;
+	}
+	__atomic_store_n(&w->head, head, __ATOMIC_SEQ_CST);
+	if (count && __atomic_exchange_n(&w->waiting, 0, __ATOMIC_SEQ_CST)) {
+		/* Have the worker poll its parked controllers again. */
+		value = 1;
+		if (write(w->wake_fd, &value, sizeof(value)) < 0) {
+			/* The worker is already being woken. */
+		}
+	}
+	if (head != tail) {
+		/* Keep the fd readable for the events left behind. */
+		value = 1;
+		if (write(w->event_fd, &value, sizeof(value)) < 0) {
+			/* The counter is already signalling. */
+		}
+	}
+	return count;
+}
+
+int pri_runtime_call(struct pri_runtime *rt, struct pri *ctrl, void (*func)(struct pri *ctrl, void *data), void *data)
+{
+	struct pri_rt_worker *worker;
+	struct pri_rt_cmd *cmd;
+	uint64_t value = 1;
+	unsigned idx;
+	int x;
+
+	if (!rt || !ctrl || !func) {
+		return -1;
+	}
+
+	/* Find the owning worker.  The controllers do not change once started. */
+	worker = NULL;
+	cmd = NULL;
+	for (x = 0; x < rt->num_workers && !worker; ++x) {
+		for (idx = 0; idx < rt->worker[x].num_spans; ++idx) {
+			if (rt->worker[x].span[idx]->ctrl == ctrl) {
+				worker = &rt->worker[x];
+				break;
+			}
+		}
+	}
+	if (!worker) {
+		return -1;
+	}
+	cmd = calloc(1, sizeof(*cmd));
+	if (!cmd) {
+		return -1;
+	}
+	cmd->span = worker->span[idx];
+	cmd->func = func;
+	cmd->data = data;
+
+	pthread_mutex_lock(&worker->lock);
+	if (worker->cmd_tail) {
+		worker->cmd_tail->next = cmd;
+	} else {
+		worker->cmd_head = cmd;
+	}
+	worker->cmd_tail = cmd;
+	pthread_mutex_unlock(&worker->lock);
+
+	if (write(worker->wake_fd, &value, sizeof(value)) < 0) {
+		/* The worker is already being woken. */
+	}
+	return 0;
+}
+
+#else	/* !defined(__linux__) */
+
+struct pri_runtime *pri_runtime_new(int workers, int queue_size)
+{
+	return NULL;
+}
+
+int pri_runtime_add(struct pri_runtime *rt, struct pri *ctrl)
+{
+	return -1;
+}
+
+int pri_runtime_start(struct pri_runtime *rt)
+{
+	return -1;
+}
+
+void pri_runtime_destroy(struct pri_runtime *rt)
+{
+}
+
+int pri_runtime_event_fd(struct pri_runtime *rt, int worker)
+{
+	return -1;
+}
+
+int pri_runtime_get_events(struct pri_runtime *rt, int worker, struct pri_runtime_event *out, int max)
+{
+	return -1;
+}
+
+int pri_runtime_call(struct pri_runtime *rt, struct pri *ctrl, void (*func)(struct pri *ctrl, void *data), void *data)
+{
+	return -1;
+}
+
+#endif	/* !defined(__linux__) */
+
+/* ------------------------------------------------------------------- */
+/* end pri_runtime.c */
@@ -0,0 +1,344 @@
+/*
+ * libpri: An implementation of Primary Rate ISDN
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ *
+ * In addition, when this program is distributed with Asterisk in
+ * any form that would qualify as a 'combined work' or as a
+ * 'derivative work' (but not mere aggregation), you can redistribute
+ * and/or modify the combination under the terms of the license
+ * provided with that copy of Asterisk, instead of the license
+ * terms granted here.
+ */
+
+/*!
+ * \file
+ * \brief Binary trace record ring
+ *
+ * \details
+ * The D channel controller thread is the only producer and one
+ * application thread is the only consumer so the ring needs no lock.
+ * Each side owns one of the free running head/tail counters and
+ * publishes it to the other side with release/acquire ordering.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "compat.h"
+#include "libpri.h"
+#include "pri_internal.h"
+
+
+/*! Smallest trace ring size in octets. */
+#define PRI_TRACE_RING_MIN		4096
+/*! Longest frame a trace record can hold. */
+#define PRI_TRACE_FRAME_MAX		(0xffff - sizeof(struct pri_trace_record) - 3)
+
+/*! \brief Binary trace record ring. */
+struct pri_trace_ring {
+	/*! Record storage. */
+	unsigned char *buf;
+	/*! Octets of record storage.  (Power of 2) */
+	unsigned size;
+	/*! Where the next record is put.  (Written by the producer only) */
+	unsigned head;
+	/*! Where the next record is read.  (Written by the consumer only) */
+	unsigned tail;
+	/*! Number of records dropped because the ring was full. */
+	unsigned dropped;
+};
+
+/*!
+ * \internal
+ * \brief Copy data into the trace ring.
+ *
+ * \param ring Trace ring to copy into.
+ * \param pos Ring position counter to start at.
+ * \param src Data to copy.
+ * \param len Number of octets to copy.
+ *
+ * \return Nothing
+ */
+static void pri_trace_copy_in(struct pri_trace_ring *ring, unsigned pos, const void *src, unsigned len)
+{
+	unsigned offset;
+	unsigned part;
+
+	offset = pos & (ring->size - 1);
+	part = ring->size - offset;
+	if (len <= part) {
+		memcpy(ring->buf + offset, src, len);
+	} else {
+		memcpy(ring->buf + offset, src, part);
+		memcpy(ring->buf, (const unsigned char *) src + part, len - part);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Copy data out of the trace ring.
+ *
+ * \param ring Trace ring to copy from.
+ * \param pos Ring position counter to start at.
+ * \param dst Where to put the data.
+ * \param len Number of octets to copy.
+ *
+ * \return Nothing
+ */
+static void pri_trace_copy_out(const struct pri_trace_ring *ring, unsigned pos, void *dst, unsigned len)
+{
+	unsigned offset;
+	unsigned part;
+
+	offset = pos & (ring->size - 1);
+	part = ring->size - offset;
+	if (len <= part) {
+		memcpy(dst, ring->buf + offset, len);
+	} else {
+		memcpy(dst, ring->buf + offset, part);
+		memcpy((unsigned char *) dst + part, ring->buf, len - part);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Put a record into the trace ring if there is room.
+ *
+ * \param ctrl D channel controller.
+ * \param rec Record header to put.  (len is filled in)
+ * \param data Record data following the header.
+ * \param data_len Number of octets of record data.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the ring is full.
+ */
+static int pri_trace_put(struct pri *ctrl, struct pri_trace_record *rec, const void *data, int data_len)
+{
+	struct pri_trace_ring *ring;
+	unsigned head;
+	unsigned tail;
+	unsigned len;
+
+	ring = ctrl->trace_ring;
+	len = (sizeof(*rec) + data_len + 3) & ~3;
+	head = ring->head;
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (ring->size - (head - tail) < len) {
+		return -1;
+	}
+	rec->len = len;
+	rec->data_len = data_len;
+	pri_trace_copy_in(ring, head, rec, sizeof(*rec));
+	if (data_len) {
+		pri_trace_copy_in(ring, head + sizeof(*rec), data, data_len);
+	}
+	__atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Make a trace record.
+ *
+ * \param ctrl D channel controller.
+ * \param type Record type.
+ * \param txrx TRUE if the frame was transmitted.
+ * \param tei TEI of the link or -1 if not link related.
+ * \param arg0 Record type specific value.
+ * \param arg1 Record type specific value.
+ * \param arg2 Record type specific value.
+ * \param data Record data.
+ * \param data_len Number of octets of record data.
+ *
+ * \return Nothing
+ */
+static void pri_trace_record(struct pri *ctrl, enum pri_trace_record_type type, int txrx, int tei,
+	int arg0, int arg1, int arg2, const void *data, int data_len)
+{
+	struct pri_trace_record rec;
+	struct timeval now;
+
+	pri_schedule_now(ctrl, &now);
+	memset(&rec, 0, sizeof(rec));
+	rec.sec = now.tv_sec;
+	rec.usec = now.tv_usec;
+
+	if (ctrl->trace_ring->dropped) {
+		/* Tell the consumer how many records it missed before going on. */
+		rec.type = PRI_TRACE_REC_DROPPED;
+		rec.tei = -1;
+		rec.arg[0] = ctrl->trace_ring->dropped;
+		if (pri_trace_put(ctrl, &rec, NULL, 0)) {
+			++ctrl->trace_ring->dropped;
+			return;
+		}
+		ctrl->trace_ring->dropped = 0;
+	}
+
+	rec.type = type;
+	rec.txrx = txrx;
+	rec.tei = tei;
+	rec.arg[0] = arg0;
+	rec.arg[1] = arg1;
+	rec.arg[2] = arg2;
+	if (pri_trace_put(ctrl, &rec, data, data_len)) {
+		++ctrl->trace_ring->dropped;
+	}
+}
+
+/*!
+ * \brief Record a Q.921 frame in the trace ring.
+ *
+ * \param ctrl D channel controller.
+ * \param h Q.921 frame.
+ * \param len Length of the frame without the FCS.
+ * \param txrx TRUE if the frame is transmitted.
+ *
+ * \note Caller checks that the trace ring is enabled.
+ *
+ * \return Nothing
+ */
+void pri_trace_frame(struct pri *ctrl, const void *h, int len, int txrx)
+{
+	const q921_header *hdr;
+
+	if (len < (int) sizeof(*hdr) || PRI_TRACE_FRAME_MAX < (unsigned) len) {
+		return;
+	}
+	hdr = h;
+	pri_trace_record(ctrl, PRI_TRACE_REC_FRAME, txrx ? 1 : 0, hdr->tei, hdr->sapi, 0, 0,
+		h, len);
+}
+
+/*!
+ * \brief Record a Q.921 link state change in the trace ring.
+ *
+ * \param ctrl D channel controller.
+ * \param tei TEI of the link.
+ * \param old_state State the link is leaving.
+ * \param new_state State the link is entering.
+ *
+ * \note Caller checks that the trace ring is enabled.
+ *
+ * \return Nothing
+ */
+void pri_trace_q921_state(struct pri *ctrl, int tei, int old_state, int new_state)
+{
+	pri_trace_record(ctrl, PRI_TRACE_REC_Q921_STATE, 0, tei, old_state, new_state, 0,
+		NULL, 0);
+}
+
+/*!
+ * \brief Record a Q.931 call state change in the trace ring.
+ *
+ * \param ctrl D channel controller.
+ * \param cr Call reference of the call.
+ * \param old_state State the call is leaving.
+ * \param new_state State the call is entering.
+ *
+ * \note Caller checks that the trace ring is enabled.
+ *
+ * \return Nothing
+ */
+void pri_trace_call_state(struct pri *ctrl, int cr, int old_state, int new_state)
+{
+	pri_trace_record(ctrl, PRI_TRACE_REC_CALL_STATE, 0, -1, cr, old_state, new_state,
+		NULL, 0);
+}
+
+/*!
+ * \brief Release the trace ring of the given controller.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \return Nothing
+ */
+void pri_trace_ring_destroy(struct pri *ctrl)
+{
+	if (ctrl->trace_ring) {
+		free(ctrl->trace_ring->buf);
+		free(ctrl->trace_ring);
+		ctrl->trace_ring = NULL;
+	}
+}
+
+int pri_trace_ring_set(struct pri *ctrl, int size)
+{
+	struct pri_trace_ring *ring;
+	unsigned ring_size;
+	int mode;
+
+	if (!ctrl || size < 0) {
+		return -1;
+	}
+	pri_trace_ring_destroy(ctrl);
+	if (!size) {
+		return 0;
+	}
+
+	for (ring_size = PRI_TRACE_RING_MIN; ring_size < (unsigned) size; ring_size <<= 1) {
+	}
+	ring = calloc(1, sizeof(*ring));
+	if (!ring) {
+		return -1;
+	}
+	ring->buf = malloc(ring_size);
+	if (!ring->buf) {
+		free(ring);
+		return -1;
+	}
+	ring->size = ring_size;
+	ctrl->trace_ring = ring;
+
+	/* Start with what the decoder needs to know to interpret the frames. */
+	if (!ctrl->bri) {
+		mode = PRI_TRACE_MODE_PRI;
+	} else if (ctrl->link.tei == Q921_TEI_GROUP) {
+		mode = PRI_TRACE_MODE_BRI_PTMP;
+	} else {
+		mode = PRI_TRACE_MODE_BRI_PTP;
+	}
+	pri_trace_record(ctrl, PRI_TRACE_REC_SESSION, 0, -1, ctrl->switchtype,
+		ctrl->localtype, mode, NULL, 0);
+	return 0;
+}
+
+int pri_trace_ring_read(struct pri *ctrl, void *buf, int size)
+{
+	struct pri_trace_ring *ring;
+	unsigned short len;
+	unsigned head;
+	unsigned tail;
+	int used;
+
+	if (!ctrl || !ctrl->trace_ring || !buf || size < 0) {
+		return -1;
+	}
+	ring = ctrl->trace_ring;
+	tail = ring->tail;
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	used = 0;
+	while (tail != head) {
+		pri_trace_copy_out(ring, tail, &len, sizeof(len));
+		if (size - used < len) {
+			/* Only whole records are returned. */
+			break;
+		}
+		pri_trace_copy_out(ring, tail, (unsigned char *) buf + used, len);
+		tail += len;
+		used += len;
+	}
+	__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	return used;
+}
@@ -0,0 +1,569 @@
+/*
+ * libpri: An implementation of Primary Rate ISDN
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ *
+ * In addition, when this program is distributed with Asterisk in
+ * any form that would qualify as a 'combined work' or as a
+ * 'derivative work' (but not mere aggregation), you can redistribute
+ * and/or modify the combination under the terms of the license
+ * provided with that copy of Asterisk, instead of the license
+ * terms granted here.
+ */
+
+/*
+ * This program benchmarks the call rate of libpri.  Like testprilib,
+ * a NETWORK and a CPE D channel controller talk over a socketpair()
+ * with a thread each.  The NETWORK side places calls and the CPE side
+ * alerts and answers them.  The NETWORK side then disconnects and the
+ * CPE side releases.
+ *
+ * Reported are the calls per second, the latency of each message from
+ * the API call sending it to the event it causes on the other side,
+ * the number of libpri memory allocations per call, and the most
+ * timers each scheduler had running.
+ *
+ * The allocations are counted by linking with
+ * -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include "compat.h"
+#include "libpri.h"
+#include "pri_internal.h"
+
+#ifndef AF_LOCAL
+#define AF_LOCAL AF_UNIX
+#endif
+
+/*! Seconds without a completed call before giving up. (Longer than T312) */
+#define STALL_TIMEOUT	15
+/*! How long to wait for a free call reference value. (ns) */
+#define CREF_RETRY_NS	1000000
+
+/*! Messages whose latency is measured. */
+enum bench_msg {
+	MSG_SETUP,
+	MSG_ALERTING,
+	MSG_CONNECT,
+	MSG_DISCONNECT,
+	MSG_RELEASE,
+	MSG_NUM
+};
+
+static const char *msg_names[MSG_NUM] = {
+	"SETUP",
+	"ALERTING",
+	"CONNECT",
+	"DISCONNECT",
+	"RELEASE",
+};
+
+/*! \brief Benchmark call slot. */
+struct bench_call {
+	/*! When each message was sent. (ns) */
+	unsigned long long sent[MSG_NUM];
+	/*! Next free slot. */
+	int next_free;
+};
+
+/*! \brief One side of the benchmark. */
+struct bench_side {
+	struct pri *pri;
+	/*! Call slot of each call reference value. */
+	short slot_by_crv[0x8000];
+	/*! TRUE if the NETWORK side. */
+	int network;
+};
+
+static struct bench_side net_side;
+static struct bench_side cpe_side;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct bench_call *slots;
+static int free_slot = -1;
+
+/*! Latency samples of each message. (ns) */
+static unsigned *samples[MSG_NUM];
+static int num_samples[MSG_NUM];
+
+static int bri;
+static int max_calls = 10000;
+static int max_active = 100;
+static int rate;
+
+static int dchan_up;
+static int issued;
+static int cref_waits;
+static int active;
+static volatile int completed;
+static unsigned long long start_ns;
+static unsigned long long end_ns;
+static unsigned long allocs_start;
+
+static unsigned long num_allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+	__atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	__atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	__atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+	return __real_realloc(ptr, size);
+}
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_error(struct pri *pri, char *s)
+{
+	fprintf(stderr, "%s", s);
+}
+
+static void bench_message(struct pri *pri, char *s)
+{
+}
+
+static void sample(int slot, enum bench_msg msg)
+{
+	samples[msg][num_samples[msg]++] = now_ns() - slots[slot].sent[msg];
+}
+
+/*!
+ * \brief Place a call.
+ *
+ * \retval 0 on success.
+ * \retval -1 if no call reference value is free.
+ */
+static int place_call(struct pri *pri)
+{
+	q931_call *call;
+	char dest[16];
+	int channel;
+	int callmode;
+	int slot;
+	int crv;
+
+	call = pri_new_call(pri);
+	if (!call) {
+		/*
+		 * All call reference values are in use.  In NT PTMP mode a
+		 * cleared call keeps its call reference until T312 expires.
+		 */
+		++cref_waits;
+		return -1;
+	}
+
+	slot = free_slot;
+	free_slot = slots[slot].next_free;
+	snprintf(dest, sizeof(dest), "%d", slot);
+	channel = bri ? (slot % 2) + 1 : (slot % 23) + 1;
+	slots[slot].sent[MSG_SETUP] = now_ns();
+	if (pri_call(pri, call, PRI_TRANS_CAP_SPEECH, channel, 1, 1, "2564286000",
+		PRI_NATIONAL_ISDN, "Bench", PRES_ALLOWED_USER_NUMBER_PASSED_SCREEN,
+		dest, PRI_NATIONAL_ISDN, PRI_LAYER_1_ULAW)) {
+		fprintf(stderr, "Unable to place call\n");
+		exit(1);
+	}
+	/* Events report the call reference the way pri_get_crv() packs it. */
+	crv = pri_get_crv(pri, call, &callmode);
+	net_side.slot_by_crv[((crv << 3) | callmode) & 0x7fff] = slot;
+	++issued;
+	++active;
+	return 0;
+}
+
+static void release_slot(int slot)
+{
+	slots[slot].next_free = free_slot;
+	free_slot = slot;
+}
+
+static void net_event(struct pri *pri, pri_event *e)
+{
+	int slot;
+
+	switch (e->e) {
+	case PRI_EVENT_DCHAN_UP:
+		if (!dchan_up) {
+			dchan_up = 1;
+			start_ns = now_ns();
+			allocs_start = num_allocs;
+		}
+		break;
+	case PRI_EVENT_RINGING:
+		slot = net_side.slot_by_crv[e->ringing.cref & 0x7fff];
+		sample(slot, MSG_ALERTING);
+		break;
+	case PRI_EVENT_ANSWER:
+		slot = net_side.slot_by_crv[e->answer.cref & 0x7fff];
+		sample(slot, MSG_CONNECT);
+		slots[slot].sent[MSG_DISCONNECT] = now_ns();
+		pri_hangup(pri, e->answer.call, PRI_CAUSE_NORMAL_CLEARING);
+		break;
+	case PRI_EVENT_HANGUP:
+		slot = net_side.slot_by_crv[e->hangup.cref & 0x7fff];
+		sample(slot, MSG_RELEASE);
+		/* Send RELEASE COMPLETE and destroy the call. */
+		pri_hangup(pri, e->hangup.call, e->hangup.cause);
+		release_slot(slot);
+		--active;
+		if (++completed == max_calls) {
+			end_ns = now_ns();
+		}
+		break;
+	case PRI_EVENT_HANGUP_REQ:
+		fprintf(stderr, "Call unexpectedly cleared, cause %d\n", e->hangup.cause);
+		exit(1);
+	default:
+		break;
+	}
+}
+
+static void cpe_event(struct pri *pri, pri_event *e)
+{
+	int slot;
+
+	switch (e->e) {
+	case PRI_EVENT_RING:
+		slot = atoi(e->ring.callednum);
+		cpe_side.slot_by_crv[e->ring.cref & 0x7fff] = slot;
+		sample(slot, MSG_SETUP);
+		slots[slot].sent[MSG_ALERTING] = now_ns();
+		pri_acknowledge(pri, e->ring.call, e->ring.channel, 1);
+		slots[slot].sent[MSG_CONNECT] = now_ns();
+		pri_answer(pri, e->ring.call, e->ring.channel, 1);
+		break;
+	case PRI_EVENT_HANGUP_REQ:
+		slot = cpe_side.slot_by_crv[e->hangup.cref & 0x7fff];
+		sample(slot, MSG_DISCONNECT);
+		slots[slot].sent[MSG_RELEASE] = now_ns();
+		pri_hangup(pri, e->hangup.call, e->hangup.cause);
+		break;
+	default:
+		break;
+	}
+}
+
+static void side_events(struct bench_side *side, pri_event *e)
+{
+	pri_event *more[16];
+	int num;
+	int idx;
+
+	if (!e) {
+		return;
+	}
+	/* Queued events are only valid until the next pri_get_events(). */
+	num = pri_get_events(side->pri, more, sizeof(more) / sizeof(more[0]));
+	if (side->network) {
+		net_event(side->pri, e);
+	} else {
+		cpe_event(side->pri, e);
+	}
+	while (0 < num) {
+		for (idx = 0; idx < num; ++idx) {
+			if (side->network) {
+				net_event(side->pri, more[idx]);
+			} else {
+				cpe_event(side->pri, more[idx]);
+			}
+		}
+		num = pri_get_events(side->pri, more, sizeof(more) / sizeof(more[0]));
+	}
+}
+
+/*!
+ * \brief Place the calls the rate allows.
+ *
+ * \return Nanoseconds until the next call can be placed or 0 if none pending.
+ */
+static unsigned long long place_calls(struct pri *pri)
+{
+	unsigned long long due;
+	unsigned long long now;
+
+	while (dchan_up && issued < max_calls && active < max_active) {
+		if (rate) {
+			due = start_ns + (unsigned long long) issued * 1000000000ULL / rate;
+			now = now_ns();
+			if (now < due) {
+				return due - now;
+			}
+		}
+		if (place_call(pri)) {
+			return CREF_RETRY_NS;
+		}
+	}
+	return 0;
+}
+
+static void *dchan(void *data)
+{
+	struct bench_side *side = data;
+	struct pri *pri = side->pri;
+	struct timeval *next;
+	struct timeval now;
+	struct timeval tv;
+	unsigned long long wait_ns = 0;
+	fd_set fds;
+	int res;
+
+	for (;;) {
+		pthread_mutex_lock(&lock);
+		next = pri_schedule_next(pri);
+		if (next) {
+			pri_schedule_now(pri, &now);
+			timersub(next, &now, &tv);
+			if (tv.tv_sec < 0) {
+				tv.tv_sec = 0;
+				tv.tv_usec = 0;
+			}
+		}
+		pthread_mutex_unlock(&lock);
+		if (wait_ns && (!next || wait_ns < tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL)) {
+			tv.tv_sec = wait_ns / 1000000000ULL;
+			tv.tv_usec = (wait_ns % 1000000000ULL) / 1000;
+			next = &tv;
+		}
+		FD_ZERO(&fds);
+		FD_SET(pri_fd(pri), &fds);
+		res = select(pri_fd(pri) + 1, &fds, NULL, NULL, next ? &tv : NULL);
+		pthread_mutex_lock(&lock);
+		if (res < 0) {
+			if (errno != EINTR) {
+				perror("select");
+				exit(1);
+			}
+		} else if (!res) {
+			side_events(side, pri_schedule_run(pri));
+		} else {
+			side_events(side, pri_check_event(pri));
+		}
+		if (side->network) {
+			wait_ns = place_calls(pri);
+		}
+		pthread_mutex_unlock(&lock);
+	}
+	return NULL;
+}
+
+static int cmp_unsigned(const void *a, const void *b)
+{
+	unsigned x = *(const unsigned *) a;
+	unsigned y = *(const unsigned *) b;
+
+	return (x > y) - (x < y);
+}
+
+static double percentile_us(unsigned *values, int num, int percent)
+{
+	int idx;
+
+	if (!num) {
+		return 0;
+	}
+	idx = (num * percent) / 100;
+	if (num <= idx) {
+		idx = num - 1;
+	}
+	return values[idx] / 1000.0;
+}
+
+static void report(const char *mode)
+{
+	double elapsed;
+	struct pri_stats net_stats;
+	struct pri_stats cpe_stats;
+	int msg;
+
+	elapsed = (end_ns - start_ns) / 1e9;
+	printf("Mode %s, %d calls, %d concurrent", mode, max_calls, max_active);
+	if (rate) {
+		printf(", %d calls/s offered\n", rate);
+	} else {
+		printf(", unlimited rate\n");
+	}
+	printf("%d calls in %.3f s: %.0f calls/s\n", completed, elapsed,
+		elapsed ? completed / elapsed : 0);
+	printf("%-12s %10s %10s %10s %10s\n", "Latency", "p50 us", "p90 us", "p99 us", "max us");
+	for (msg = 0; msg < MSG_NUM; ++msg) {
+		qsort(samples[msg], num_samples[msg], sizeof(unsigned), cmp_unsigned);
+		printf("%-12s %10.1f %10.1f %10.1f %10.1f\n", msg_names[msg],
+			percentile_us(samples[msg], num_samples[msg], 50),
+			percentile_us(samples[msg], num_samples[msg], 90),
+			percentile_us(samples[msg], num_samples[msg], 99),
+			percentile_us(samples[msg], num_samples[msg], 100));
+	}
+	printf("Allocations per call: %.1f\n",
+		completed ? (double) (num_allocs - allocs_start) / completed : 0);
+	pri_get_stats(net_side.pri, &net_stats);
+	pri_get_stats(cpe_side.pri, &cpe_stats);
+	printf("Peak scheduler timers: network %u, cpe %u\n", net_stats.sched_timers_max,
+		cpe_stats.sched_timers_max);
+	printf("I-frame retransmissions: network %u, cpe %u\n", net_stats.iframe_retx,
+		cpe_stats.iframe_retx);
+	printf("Window stalls: network %u, cpe %u\n", net_stats.window_stalls,
+		cpe_stats.window_stalls);
+	if (cref_waits) {
+		printf("Waited %d times for a free call reference\n", cref_waits);
+	}
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: pribench [-m pri|ptp|ptmp] [-n calls] [-c concurrent] [-r calls/s]\n");
+	exit(1);
+}
+
+static struct pri *side_new(int fd, int nodetype, int ptpmode)
+{
+	struct pri *pri;
+
+	if (bri) {
+		pri = pri_new_bri(fd, ptpmode, nodetype, PRI_SWITCH_EUROISDN_E1);
+	} else {
+		pri = pri_new(fd, nodetype, PRI_SWITCH_NI2);
+	}
+	if (!pri) {
+		fprintf(stderr, "Unable to create D channel controller\n");
+		exit(1);
+	}
+	pri_set_sched_clock(pri, PRI_SCHED_CLOCK_MONOTONIC);
+	return pri;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *mode = "pri";
+	pthread_t tmp;
+	int pair[2];
+	int ptpmode = 0;
+	int last_completed;
+	int stalled;
+	int msg;
+	int c;
+
+	while ((c = getopt(argc, argv, "m:n:c:r:")) != -1) {
+		switch (c) {
+		case 'm':
+			mode = optarg;
+			if (!strcasecmp(mode, "pri")) {
+				bri = 0;
+			} else if (!strcasecmp(mode, "ptp")) {
+				bri = 1;
+				ptpmode = 1;
+			} else if (!strcasecmp(mode, "ptmp")) {
+				bri = 1;
+				ptpmode = 0;
+			} else {
+				usage();
+			}
+			break;
+		case 'n':
+			max_calls = atoi(optarg);
+			break;
+		case 'c':
+			max_active = atoi(optarg);
+			break;
+		case 'r':
+			rate = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (max_calls < 1 || max_active < 1 || rate < 0) {
+		usage();
+	}
+	if (bri && 100 < max_active) {
+		/* BRI call reference values are only 7 bits. */
+		max_active = 100;
+	}
+
+	slots = calloc(max_active, sizeof(*slots));
+	for (msg = 0; msg < MSG_NUM; ++msg) {
+		samples[msg] = calloc(max_calls, sizeof(unsigned));
+	}
+	if (!slots || !samples[MSG_NUM - 1]) {
+		exit(1);
+	}
+	for (c = max_active; c--;) {
+		release_slot(c);
+	}
+
+	pri_set_message(bench_message);
+	pri_set_error(bench_error);
+	if (socketpair(AF_LOCAL, SOCK_DGRAM, 0, pair)) {
+		perror("socketpair");
+		exit(1);
+	}
+	net_side.network = 1;
+	net_side.pri = side_new(pair[0], PRI_NETWORK, ptpmode);
+	cpe_side.pri = side_new(pair[1], PRI_CPE, ptpmode);
+	if (pthread_create(&tmp, NULL, dchan, &net_side)
+		|| pthread_create(&tmp, NULL, dchan, &cpe_side)) {
+		perror("thread");
+		exit(1);
+	}
+
+	last_completed = 0;
+	stalled = 0;
+	while (completed < max_calls) {
+		usleep(100000);
+		if (last_completed != completed) {
+			last_completed = completed;
+			stalled = 0;
+		} else if (STALL_TIMEOUT * 10 <= ++stalled) {
+			fprintf(stderr, "No progress for %d seconds\n", STALL_TIMEOUT);
+			pthread_mutex_lock(&lock);
+			end_ns = now_ns();
+			report(mode);
+			exit(1);
+		}
+	}
+	pthread_mutex_lock(&lock);
+	report(mode);
+	exit(0);
+}
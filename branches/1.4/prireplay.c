@@ -0,0 +1,538 @@
+/*
+ * libpri: An implementation of Primary Rate ISDN
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ *
+ * In addition, when this program is distributed with Asterisk in
+ * any form that would qualify as a 'combined work' or as a
+ * 'derivative work' (but not mere aggregation), you can redistribute
+ * and/or modify the combination under the terms of the license
+ * provided with that copy of Asterisk, instead of the license
+ * terms granted here.
+ */
+
+/*
+ * This program replays the frames received in a pcapng capture made
+ * with pri_pcap_open() through a D channel controller as fast as the
+ * CPU allows.  There is no file descriptor: received frames are fed
+ * with pri_receive_frame() and sent frames are discarded by the write
+ * callback.  The scheduler runs on a virtual clock driven by the
+ * capture timestamps so timers expire as they did when captured.
+ *
+ * The upper layer events are printed on stdout for diffing between
+ * libpri versions and the throughput is printed on stderr.
+ *
+ * The replayed application hangs up when asked to and can be told how
+ * to respond to incoming calls.  Q.921 sequence numbers only line up
+ * with the capture while the replay sends the same I frames as the
+ * captured application did.  Calls the captured application originated
+ * are not recreated so the replay follows the capture best when it was
+ * made on the side receiving the calls.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "libpri.h"
+
+/* pcapng block types */
+#define PCAPNG_BT_SHB			0x0A0D0D0A
+#define PCAPNG_BT_IDB			0x00000001
+#define PCAPNG_BT_EPB			0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC	0x1A2B3C4D
+
+#define LINKTYPE_LINUX_LAPD		177
+#define LAPD_PSEUDO_HDR_LEN		16
+#define LAPD_PKTTYPE_OUTGOING	4
+
+/* TEI management messages carrying the Ri of the TEI request. */
+#define TEI_IDENTITY_REQUEST	1
+#define TEI_IDENTITY_ASSIGNED	2
+
+/*! Longest pcapng block accepted. */
+#define MAX_BLOCK_LEN			(64 * 1024)
+
+/*! \brief Captured frame. */
+struct replay_frame {
+	/*! Capture timestamp. */
+	struct timeval when;
+	/*! TRUE if the captured side sent the frame. */
+	int tx;
+	/*! TRUE if the captured side was the network side. */
+	int network;
+	/*! Frame length without the FCS. */
+	int len;
+	/*! Frame followed by room for the FCS. */
+	unsigned char *data;
+};
+
+static struct replay_frame *frames;
+static int num_frames;
+
+/*! Virtual clock of the scheduler. */
+static struct timeval vclock;
+/*! Capture timestamp of the first frame. */
+static struct timeval vstart;
+
+/*! Ri of the TEI request sent by the replay.  (-1 if none yet) */
+static int replay_ri;
+/*! TEI the captured side used.  (-1 if not known) */
+static int captured_tei = -1;
+
+static int quiet;
+
+/*! How the replayed application responds to incoming calls. */
+enum ring_policy {
+	/*! Leave incoming calls alone. */
+	RING_POLICY_NONE,
+	/*! Send PROCEEDING and ALERTING. */
+	RING_POLICY_ALERT,
+	/*! Send PROCEEDING, ALERTING, and CONNECT. */
+	RING_POLICY_ANSWER,
+};
+static enum ring_policy ring_policy;
+static int rx_frames;
+static int tx_frames;
+static int calls;
+
+static int str2switch(char *swtype)
+{
+	if (!strcasecmp(swtype, "ni2"))
+		return PRI_SWITCH_NI2;
+	if (!strcasecmp(swtype, "dms100"))
+		return PRI_SWITCH_DMS100;
+	if (!strcasecmp(swtype, "lucent5e"))
+		return PRI_SWITCH_LUCENT5E;
+	if (!strcasecmp(swtype, "att4ess"))
+		return PRI_SWITCH_ATT4ESS;
+	if (!strcasecmp(swtype, "euroisdn"))
+		return PRI_SWITCH_EUROISDN_E1;
+	if (!strcasecmp(swtype, "qsig"))
+		return PRI_SWITCH_QSIG;
+	return -1;
+}
+
+static int str2node(char *node)
+{
+	if (!strcasecmp(node, "cpe"))
+		return PRI_CPE;
+	if (!strcasecmp(node, "network"))
+		return PRI_NETWORK;
+	return -1;
+}
+
+static unsigned int get32(const unsigned char *p, int swap)
+{
+	unsigned int value;
+
+	memcpy(&value, p, sizeof(value));
+	if (swap) {
+		value = (value >> 24) | ((value >> 8) & 0xff00)
+			| ((value << 8) & 0xff0000) | (value << 24);
+	}
+	return value;
+}
+
+static void load_capture(const char *filename)
+{
+	unsigned char *block;
+	unsigned char hdr[8];
+	unsigned int type;
+	unsigned int len;
+	unsigned long long ts;
+	int swap = 0;
+	int lapd = 0;
+	int max_frames = 0;
+	int idx;
+	struct replay_frame *frame;
+	FILE *f;
+
+	f = fopen(filename, "r");
+	if (!f) {
+		perror(filename);
+		exit(1);
+	}
+	block = malloc(MAX_BLOCK_LEN);
+	if (!block) {
+		exit(1);
+	}
+	while (fread(hdr, sizeof(hdr), 1, f) == 1) {
+		type = get32(hdr, 0);
+		if (type == PCAPNG_BT_SHB) {
+			/* The byte order magic tells the byte order of the section. */
+			if (fread(block, 4, 1, f) != 1) {
+				break;
+			}
+			swap = (get32(block, 0) != PCAPNG_BYTE_ORDER_MAGIC);
+			len = get32(hdr + 4, swap);
+			if (len < 12 + 4 || MAX_BLOCK_LEN < len
+				|| fread(block + 4, len - 12, 1, f) != 1) {
+				break;
+			}
+			continue;
+		}
+		type = get32(hdr, swap);
+		len = get32(hdr + 4, swap);
+		if (len < 12 || MAX_BLOCK_LEN < len || (len & 3)
+			|| fread(block, len - 8, 1, f) != 1) {
+			fprintf(stderr, "Corrupt capture block\n");
+			exit(1);
+		}
+		switch (type) {
+		case PCAPNG_BT_IDB:
+			lapd = ((get32(block, swap) & 0xffff) == LINKTYPE_LINUX_LAPD);
+			if (!lapd) {
+				fprintf(stderr, "Capture is not LINKTYPE_LINUX_LAPD\n");
+				exit(1);
+			}
+			break;
+		case PCAPNG_BT_EPB:
+			len = get32(block + 12, swap);
+			if (!lapd || len <= LAPD_PSEUDO_HDR_LEN || MAX_BLOCK_LEN < 20 + len) {
+				break;
+			}
+			if (num_frames == max_frames) {
+				max_frames = max_frames ? max_frames * 2 : 1024;
+				frames = realloc(frames, max_frames * sizeof(*frames));
+				if (!frames) {
+					exit(1);
+				}
+			}
+			frame = &frames[num_frames++];
+			ts = ((unsigned long long) get32(block + 4, swap) << 32) | get32(block + 8, swap);
+			frame->when.tv_sec = ts / 1000000;
+			frame->when.tv_usec = ts % 1000000;
+			frame->tx = ((block[20] << 8) | block[21]) == LAPD_PKTTYPE_OUTGOING;
+			frame->network = block[26];
+			frame->len = len - LAPD_PSEUDO_HDR_LEN;
+			frame->data = calloc(1, frame->len + 2);
+			if (!frame->data) {
+				exit(1);
+			}
+			memcpy(frame->data, block + 20 + LAPD_PSEUDO_HDR_LEN, frame->len);
+			break;
+		default:
+			break;
+		}
+	}
+	free(block);
+	fclose(f);
+
+	for (idx = 0; idx < num_frames; ++idx) {
+		frame = &frames[idx];
+		if (frame->tx && 2 <= frame->len && (frame->data[1] >> 1) != 127) {
+			captured_tei = frame->data[1] >> 1;
+			break;
+		}
+	}
+}
+
+/*!
+ * \brief Get the Ri of a TEI management frame.
+ *
+ * \param buf Frame to check.
+ * \param len Length of the frame.
+ * \param msg TEI management message wanted.
+ *
+ * \return Ri of the message or -1 if not the wanted message.
+ */
+static int tei_mgmt_ri(const unsigned char *buf, int len, int msg)
+{
+	/* SAPI 63, group TEI, UI frame, management entity */
+	if (len < 8 || (buf[0] >> 2) != 63 || buf[1] != 0xff || buf[2] != 0x03
+		|| buf[3] != 0x0f || buf[6] != msg) {
+		return -1;
+	}
+	return (buf[4] << 8) | buf[5];
+}
+
+static int discard_write(struct pri *pri, void *buf, int buflen)
+{
+	int ri;
+
+	++tx_frames;
+	ri = tei_mgmt_ri(buf, buflen, TEI_IDENTITY_REQUEST);
+	if (0 <= ri) {
+		replay_ri = ri;
+	}
+	return buflen;
+}
+
+static int no_read(struct pri *pri, void *buf, int buflen)
+{
+	return -1;
+}
+
+static void replay_message(struct pri *pri, char *stuff)
+{
+	fprintf(stderr, "%s", stuff);
+}
+
+static void virtual_now(struct pri *pri, struct timeval *now)
+{
+	*now = vclock;
+}
+
+static void handle_event(struct pri *pri, pri_event *e)
+{
+	struct timeval rel;
+
+	if (e->e == PRI_EVENT_RING) {
+		++calls;
+	}
+	if (!quiet) {
+		timersub(&vclock, &vstart, &rel);
+		printf("%ld.%06ld %s", (long) rel.tv_sec, (long) rel.tv_usec, pri_event2str(e->e));
+		switch (e->e) {
+		case PRI_EVENT_RING:
+			printf(" channel=%d cref=%d called=%s calling=%s", e->ring.channel,
+				e->ring.cref, e->ring.callednum, e->ring.callingnum);
+			break;
+		case PRI_EVENT_HANGUP:
+		case PRI_EVENT_HANGUP_REQ:
+		case PRI_EVENT_HANGUP_ACK:
+			printf(" channel=%d cref=%d cause=%d", e->hangup.channel, e->hangup.cref,
+				e->hangup.cause);
+			break;
+		case PRI_EVENT_ANSWER:
+			printf(" channel=%d cref=%d", e->answer.channel, e->answer.cref);
+			break;
+		case PRI_EVENT_RINGING:
+			printf(" channel=%d cref=%d", e->ringing.channel, e->ringing.cref);
+			break;
+		case PRI_EVENT_PROCEEDING:
+			printf(" channel=%d cref=%d", e->proceeding.channel, e->proceeding.cref);
+			break;
+		default:
+			break;
+		}
+		printf("\n");
+	}
+
+	/* Act like a simple application so the calls progress. */
+	switch (e->e) {
+	case PRI_EVENT_RING:
+		if (ring_policy != RING_POLICY_NONE) {
+			pri_proceeding(pri, e->ring.call, e->ring.channel, 0);
+			pri_acknowledge(pri, e->ring.call, e->ring.channel, 0);
+		}
+		if (ring_policy == RING_POLICY_ANSWER) {
+			pri_answer(pri, e->ring.call, e->ring.channel, 1);
+		}
+		break;
+	case PRI_EVENT_HANGUP_REQ:
+	case PRI_EVENT_HANGUP:
+		pri_hangup(pri, e->hangup.call, e->hangup.cause);
+		break;
+	default:
+		break;
+	}
+}
+
+static void handle_events(struct pri *pri, pri_event *e)
+{
+	pri_event *more[16];
+	int num;
+	int idx;
+
+	if (!e) {
+		return;
+	}
+	/* Queued events are only valid until the next pri_get_events(). */
+	num = pri_get_events(pri, more, sizeof(more) / sizeof(more[0]));
+	handle_event(pri, e);
+	while (0 < num) {
+		for (idx = 0; idx < num; ++idx) {
+			handle_event(pri, more[idx]);
+		}
+		num = pri_get_events(pri, more, sizeof(more) / sizeof(more[0]));
+	}
+}
+
+static void replay(int switchtype, int nodetype, int bri, int ptp)
+{
+	static unsigned char patched[MAX_BLOCK_LEN];
+	struct replay_frame *frame;
+	struct timeval *next;
+	struct pri *pri;
+	int captured_ri = -1;
+	int ri;
+	int idx;
+
+	replay_ri = -1;
+
+	if (bri) {
+		pri = pri_new_bri_cb(-1, ptp, nodetype, switchtype, no_read, discard_write, NULL);
+	} else {
+		pri = pri_new_cb(-1, nodetype, switchtype, no_read, discard_write, NULL);
+	}
+	if (!pri) {
+		fprintf(stderr, "Unable to create D channel controller\n");
+		exit(1);
+	}
+	vstart = frames[0].when;
+	vclock = vstart;
+	pri_set_sched_time_cb(pri, virtual_now);
+
+	for (idx = 0; idx < num_frames; ++idx) {
+		frame = &frames[idx];
+
+		/* Expire the timers due before this frame at the time they were due. */
+		while ((next = pri_schedule_next(pri)) && !timercmp(&frame->when, next, <)) {
+			if (timercmp(&vclock, next, <)) {
+				vclock = *next;
+			}
+			handle_events(pri, pri_schedule_run(pri));
+		}
+		if (timercmp(&vclock, &frame->when, <)) {
+			vclock = frame->when;
+		}
+		if (frame->tx) {
+			ri = tei_mgmt_ri(frame->data, frame->len, TEI_IDENTITY_REQUEST);
+			if (0 <= ri) {
+				captured_ri = ri;
+			}
+			continue;
+		}
+		++rx_frames;
+
+		/*
+		 * The Ri of a TEI request is random so give the replay the TEI
+		 * the captured side was assigned.  The capture may have started
+		 * after the request was sent so also go by the TEI used.
+		 */
+		ri = tei_mgmt_ri(frame->data, frame->len, TEI_IDENTITY_ASSIGNED);
+		if (0 <= ri && 0 <= replay_ri
+			&& (ri == captured_ri || (captured_ri < 0 && (frame->data[7] >> 1) == captured_tei))) {
+			memcpy(patched, frame->data, frame->len + 2);
+			patched[4] = replay_ri >> 8;
+			patched[5] = replay_ri;
+			handle_events(pri, pri_receive_frame(pri, patched, frame->len + 2));
+			continue;
+		}
+		handle_events(pri, pri_receive_frame(pri, frame->data, frame->len + 2));
+	}
+	/* There is no API to free a D channel controller so it is left behind. */
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: prireplay [-a policy] [-q] [-l loops] [-s switchtype] [-n nodetype] [-b|-B] <capture>\n"
+		"  -a  Respond to incoming calls with none, alert, or answer (Default none)\n"
+		"  -q  Do not print the events\n"
+		"  -l  Replay the capture this many times\n"
+		"  -s  Switch type (Default ni2)\n"
+		"  -n  Node type of the captured side (Default from the capture)\n"
+		"  -b  BRI point-to-point\n"
+		"  -B  BRI point-to-multipoint\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec start;
+	struct timespec end;
+	double elapsed;
+	int switchtype = PRI_SWITCH_NI2;
+	int nodetype = -1;
+	int bri = 0;
+	int ptp = 0;
+	int loops = 1;
+	int loop;
+	int c;
+
+	while ((c = getopt(argc, argv, "a:ql:s:n:bB")) != -1) {
+		switch (c) {
+		case 'a':
+			if (!strcasecmp(optarg, "none")) {
+				ring_policy = RING_POLICY_NONE;
+			} else if (!strcasecmp(optarg, "alert")) {
+				ring_policy = RING_POLICY_ALERT;
+			} else if (!strcasecmp(optarg, "answer")) {
+				ring_policy = RING_POLICY_ANSWER;
+			} else {
+				usage();
+			}
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		case 'l':
+			loops = atoi(optarg);
+			if (loops < 1) {
+				usage();
+			}
+			break;
+		case 's':
+			switchtype = str2switch(optarg);
+			if (switchtype < 0) {
+				fprintf(stderr, "Valid switchtypes are: ni2, dms100, lucent5e, att4ess, euroisdn, and qsig\n");
+				exit(1);
+			}
+			break;
+		case 'n':
+			nodetype = str2node(optarg);
+			if (nodetype < 0) {
+				fprintf(stderr, "Valid nodetypes are: network and cpe\n");
+				exit(1);
+			}
+			break;
+		case 'b':
+			bri = 1;
+			ptp = 1;
+			break;
+		case 'B':
+			bri = 1;
+			ptp = 0;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (argc <= optind) {
+		usage();
+	}
+
+	pri_set_message(replay_message);
+	pri_set_error(replay_message);
+
+	load_capture(argv[optind]);
+	if (!num_frames) {
+		fprintf(stderr, "No frames in capture\n");
+		exit(1);
+	}
+	if (nodetype < 0) {
+		nodetype = frames[0].network ? PRI_NETWORK : PRI_CPE;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (loop = 0; loop < loops; ++loop) {
+		replay(switchtype, nodetype, bri, ptp);
+		if (!loop) {
+			/* Only the first pass is printed for diffing. */
+			quiet = 1;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	fprintf(stderr, "%d frames received, %d frames sent, %d calls in %.6f s\n",
+		rx_frames, tx_frames, calls, elapsed);
+	if (0 < elapsed) {
+		fprintf(stderr, "%.0f frames/s, %.0f calls/s\n", rx_frames / elapsed, calls / elapsed);
+	}
+	return 0;
+}
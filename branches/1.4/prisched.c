@@ -30,88 +30,457 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "libpri.h"
 #include "pri_internal.h"
 
 
-/*! Initial number of scheduled timer slots. */
-#define SCHED_EVENTS_INITIAL	128
+/*! Number of scheduled timer slots allocated at a time. */
+#define SCHED_CHUNK_SIZE		128
 /*!
- * \brief Maximum number of scheduled timer slots.
- * \note Should be a power of 2 and at least SCHED_EVENTS_INITIAL.
+ * \brief Number of timer ids reserved for each timer pool.
+ * \note Limits how many timers a D channel can have active at once.
+ * \note Must be a power of 2 multiple of SCHED_CHUNK_SIZE.
  */
-#define SCHED_EVENTS_MAX		8192
-
-/*! \brief The maximum number of timers that were active at once. */
-static unsigned maxsched = 0;
-/*! Last pool id */
-static unsigned pool_id = 0;
+#define SCHED_POOL_IDS			(1 << PRI_SCHED_POOL_BITS)
 
 /* Scheduler routines */
 
+/*!
+ * \internal
+ * \brief Get the timer slot at the given index.
+ *
+ * \param ctrl D channel controller.
+ * \param x Timer slot index.  Must be less than num_slots.
+ *
+ * \return Timer slot
+ */
+static inline struct pri_sched *pri_sched_slot(struct pri *ctrl, unsigned x)
+{
+	return &ctrl->sched.chunk[x / SCHED_CHUNK_SIZE][x % SCHED_CHUNK_SIZE];
+}
+
+/*!
+ * \internal
+ * \brief Read the current time from the scheduler time base.
+ *
+ * \param ctrl D channel controller.
+ * \param now Where to put the current time.
+ *
+ * \return Nothing
+ */
+static void pri_sched_clock_read(struct pri *ctrl, struct timeval *now)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+#endif	/* defined(CLOCK_MONOTONIC) */
+
+	if (ctrl->sched.time_func) {
+		ctrl->sched.time_func(ctrl, now);
+		return;
+	}
+	switch (ctrl->sched.clock) {
+#if defined(CLOCK_MONOTONIC)
+	case PRI_SCHED_CLOCK_MONOTONIC:
+		if (!clock_gettime(CLOCK_MONOTONIC, &ts)) {
+			now->tv_sec = ts.tv_sec;
+			now->tv_usec = ts.tv_nsec / 1000;
+			break;
+		}
+		/* Fall back to the wall clock. */
+		/* Fall through */
+#endif	/* defined(CLOCK_MONOTONIC) */
+	default:
+		gettimeofday(now, NULL);
+		break;
+	}
+}
+
+/*!
+ * \brief Get the current time in the D channel scheduler time base.
+ *
+ * \param ctrl D channel controller.
+ * \param now Where to put the current time.
+ *
+ * \note The time read at the start of the current event loop pass
+ * is used if in one.
+ *
+ * \return Nothing
+ */
+void pri_schedule_now(struct pri *ctrl, struct timeval *now)
+{
+	if (ctrl->sched.now_cached) {
+		*now = ctrl->sched.now;
+	} else {
+		pri_sched_clock_read(ctrl, now);
+	}
+}
+
+/*!
+ * \brief Start an event loop pass using the given current time.
+ *
+ * \param ctrl D channel controller.
+ * \param now Current time in the scheduler time base.  NULL to read the clock.
+ *
+ * \details
+ * All timers started until pri_schedule_pass_end() is called are
+ * relative to the same current time so the clock is only read once
+ * per pass.
+ *
+ * \return Nothing
+ */
+void pri_schedule_pass_begin(struct pri *ctrl, const struct timeval *now)
+{
+	if (!ctrl->sched.now_cached++) {
+		if (now) {
+			ctrl->sched.now = *now;
+		} else {
+			pri_sched_clock_read(ctrl, &ctrl->sched.now);
+		}
+	}
+}
+
+/*!
+ * \brief End an event loop pass started by pri_schedule_pass_begin().
+ *
+ * \param ctrl D channel controller.
+ *
+ * \return Nothing
+ */
+void pri_schedule_pass_end(struct pri *ctrl)
+{
+	if (ctrl->sched.now_cached && !--ctrl->sched.now_cached) {
+		/* The pass is over.  Write any frames it collected. */
+		q921_transmit_flush(ctrl);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Move all running timers to a new scheduler time base.
+ *
+ * \param ctrl D channel controller.
+ * \param old_now Current time in the old time base.
+ *
+ * \return Nothing
+ */
+static void pri_sched_rebase(struct pri *ctrl, const struct timeval *old_now)
+{
+	struct timeval new_now;
+	struct pri_sched *timer;
+	long delta_sec;
+	long delta_usec;
+	unsigned pos;
+
+	pri_sched_clock_read(ctrl, &new_now);
+	delta_sec = new_now.tv_sec - old_now->tv_sec;
+	delta_usec = new_now.tv_usec - old_now->tv_usec;
+	if (ctrl->sched.now_cached) {
+		ctrl->sched.now = new_now;
+	}
+
+	/* Shifting every timer by the same amount keeps the heap ordered. */
+	for (pos = 0; pos < ctrl->sched.heap_used; ++pos) {
+		timer = pri_sched_slot(ctrl, ctrl->sched.heap[pos]);
+		timer->when.tv_sec += delta_sec;
+		timer->when.tv_usec += delta_usec;
+		if (timer->when.tv_usec < 0) {
+			timer->when.tv_usec += 1000000;
+			timer->when.tv_sec -= 1;
+		} else if (1000000 <= timer->when.tv_usec) {
+			timer->when.tv_usec -= 1000000;
+			timer->when.tv_sec += 1;
+		}
+	}
+}
+
+int pri_set_sched_clock(struct pri *ctrl, enum pri_sched_clock clock)
+{
+	struct timeval old_now;
+
+	if (!ctrl) {
+		return -1;
+	}
+	switch (clock) {
+	case PRI_SCHED_CLOCK_REALTIME:
+		break;
+	case PRI_SCHED_CLOCK_MONOTONIC:
+#if defined(CLOCK_MONOTONIC)
+		break;
+#else
+		return -1;
+#endif	/* defined(CLOCK_MONOTONIC) */
+	default:
+		return -1;
+	}
+	pri_sched_clock_read(ctrl, &old_now);
+	ctrl->sched.clock = clock;
+	pri_sched_rebase(ctrl, &old_now);
+	return 0;
+}
+
+void pri_set_sched_time_cb(struct pri *ctrl, pri_time_cb now_func)
+{
+	struct timeval old_now;
+
+	if (!ctrl) {
+		return;
+	}
+	pri_sched_clock_read(ctrl, &old_now);
+	ctrl->sched.time_func = now_func;
+	pri_sched_rebase(ctrl, &old_now);
+}
+
 /*!
  * \internal
  * \brief Increase the number of scheduler timer slots available.
  *
  * \param ctrl D channel controller.
  *
+ * \details
+ * Adds another chunk of timer slots to the free list.  Existing
+ * timer slots are never moved so timer ids remain stable.
+ *
  * \retval 0 on success.
  * \retval -1 on error.
  */
 static int pri_schedule_grow(struct pri *ctrl)
 {
-	unsigned num_slots;
-	struct pri_sched *timers;
+	struct pri_sched **chunks;
+	struct pri_sched *chunk;
+	unsigned *heap;
+	unsigned num_chunks;
+	unsigned x;
+
+	num_chunks = ctrl->sched.num_chunks;
+	if (SCHED_POOL_IDS / SCHED_CHUNK_SIZE <= num_chunks) {
+		/* All timer ids in this pool are in use. */
+		return -1;
+	}
 
-	/* Determine how many slots in the new timer table. */
-	if (ctrl->sched.num_slots) {
-		if (SCHED_EVENTS_MAX <= ctrl->sched.num_slots) {
-			/* Cannot grow the timer table any more. */
+	/* Get and initialize the new timer slot chunk. */
+	chunk = calloc(SCHED_CHUNK_SIZE, sizeof(*chunk));
+	if (!chunk) {
+		/* Could not get a new timer slot chunk. */
+		return -1;
+	}
+	if (!(num_chunks & (num_chunks - 1))) {
+		/*
+		 * The chunk directory is full.  Double it and the expiration heap.
+		 * Only the chunk pointers and the heap indexes move.
+		 */
+		chunks = realloc(ctrl->sched.chunk,
+			(num_chunks ? 2 * num_chunks : 1) * sizeof(*chunks));
+		if (!chunks) {
+			/* Could not get a new chunk directory. */
+			free(chunk);
 			return -1;
 		}
-		num_slots = ctrl->sched.num_slots * 2;
-		if (SCHED_EVENTS_MAX < num_slots) {
-			num_slots = SCHED_EVENTS_MAX;
+		ctrl->sched.chunk = chunks;
+		heap = realloc(ctrl->sched.heap,
+			(num_chunks ? 2 * num_chunks : 1) * SCHED_CHUNK_SIZE * sizeof(*heap));
+		if (!heap) {
+			/* Could not get a new expiration heap. */
+			free(chunk);
+			return -1;
 		}
-	} else {
-		num_slots = SCHED_EVENTS_INITIAL;
+		ctrl->sched.heap = heap;
+	}
+	if (!num_chunks) {
+		/* Creating the timer pool.  Find a pool no other D channel owns. */
+		if (!ctrl->ctx->pool_owner) {
+			ctrl->ctx->pool_owner = calloc(PRI_SCHED_POOLS, sizeof(*ctrl->ctx->pool_owner));
+			if (!ctrl->ctx->pool_owner) {
+				/* Could not get the timer pool owner table. */
+				free(chunk);
+				return -1;
+			}
+		}
+		for (x = 0; x < PRI_SCHED_POOLS; ++x) {
+			ctrl->ctx->pool_id += SCHED_POOL_IDS;
+			if (ctrl->ctx->pool_id
+				&& !ctrl->ctx->pool_owner[ctrl->ctx->pool_id >> PRI_SCHED_POOL_BITS]) {
+				break;
+			}
+		}
+		if (x == PRI_SCHED_POOLS) {
+			pri_error(ctrl, "No free timer pools.  Too many D channels in this context.\n");
+			free(chunk);
+			return -1;
+		}
+		ctrl->ctx->pool_owner[ctrl->ctx->pool_id >> PRI_SCHED_POOL_BITS] = ctrl;
+		ctrl->sched.first_id = ctrl->ctx->pool_id;
 	}
 
-	/* Get and initialize the new timer table. */
-	timers = calloc(num_slots, sizeof(struct pri_sched));
-	if (!timers) {
-		/* Could not get a new timer table. */
-		return -1;
+	/* Put the new timer slots on the free list in index order. */
+	ctrl->sched.chunk[num_chunks] = chunk;
+	ctrl->sched.num_chunks = num_chunks + 1;
+	for (x = SCHED_CHUNK_SIZE; x--;) {
+		chunk[x].next_free = ctrl->sched.free_head;
+		ctrl->sched.free_head = ctrl->sched.num_slots + x + 1;
 	}
-	if (ctrl->sched.timer) {
-		/* Copy over the old timer table. */
-		memcpy(timers, ctrl->sched.timer,
-			ctrl->sched.num_slots * sizeof(struct pri_sched));
-		free(ctrl->sched.timer);
-	} else {
-		/* Creating the timer pool. */
-		pool_id += SCHED_EVENTS_MAX;
-		if (pool_id < SCHED_EVENTS_MAX
-			|| pool_id + (SCHED_EVENTS_MAX - 1) < SCHED_EVENTS_MAX) {
-			/*
-			 * Not likely to happen.
-			 *
-			 * Timer id's may be aliased if this D channel is used in an
-			 * NFAS group with redundant D channels.  Another D channel in
-			 * the group may have the same pool_id.
-			 */
-			pri_error(ctrl,
-				"Pool_id wrapped.  Please ignore if you are not using NFAS with backup D channels.\n");
-			pool_id = SCHED_EVENTS_MAX;
+	ctrl->sched.num_slots += SCHED_CHUNK_SIZE;
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Determine if the left timer expires before the right timer.
+ *
+ * \param left Timer slot to compare.
+ * \param right Timer slot to compare.
+ *
+ * \note Timers with the same expiration time are ordered by when
+ * they were scheduled.
+ *
+ * \return TRUE if left expires first.
+ */
+static int pri_sched_before(const struct pri_sched *left, const struct pri_sched *right)
+{
+	if (left->when.tv_sec != right->when.tv_sec) {
+		return left->when.tv_sec < right->when.tv_sec;
+	}
+	if (left->when.tv_usec != right->when.tv_usec) {
+		return left->when.tv_usec < right->when.tv_usec;
+	}
+	return (int) (left->seq - right->seq) < 0;
+}
+
+/*!
+ * \internal
+ * \brief Put the given timer slot at the given expiration heap position.
+ *
+ * \param ctrl D channel controller.
+ * \param pos Expiration heap position.
+ * \param x Timer slot index.
+ *
+ * \return Nothing
+ */
+static void pri_sched_heap_set(struct pri *ctrl, unsigned pos, unsigned x)
+{
+	ctrl->sched.heap[pos] = x;
+	pri_sched_slot(ctrl, x)->heap_pos = pos;
+}
+
+/*!
+ * \internal
+ * \brief Move the timer at the given heap position toward the root.
+ *
+ * \param ctrl D channel controller.
+ * \param pos Expiration heap position.
+ *
+ * \return Nothing
+ */
+static void pri_sched_heap_up(struct pri *ctrl, unsigned pos)
+{
+	unsigned x;
+	unsigned parent;
+
+	x = ctrl->sched.heap[pos];
+	while (pos) {
+		parent = (pos - 1) / 2;
+		if (!pri_sched_before(pri_sched_slot(ctrl, x),
+			pri_sched_slot(ctrl, ctrl->sched.heap[parent]))) {
+			break;
 		}
-		ctrl->sched.first_id = pool_id;
+		pri_sched_heap_set(ctrl, pos, ctrl->sched.heap[parent]);
+		pos = parent;
 	}
+	pri_sched_heap_set(ctrl, pos, x);
+}
 
-	/* Put the new timer table in place. */
-	ctrl->sched.timer = timers;
-	ctrl->sched.num_slots = num_slots;
-	return 0;
+/*!
+ * \internal
+ * \brief Move the timer at the given heap position toward the leaves.
+ *
+ * \param ctrl D channel controller.
+ * \param pos Expiration heap position.
+ *
+ * \return Nothing
+ */
+static void pri_sched_heap_down(struct pri *ctrl, unsigned pos)
+{
+	unsigned x;
+	unsigned child;
+	unsigned used;
+
+	used = ctrl->sched.heap_used;
+	x = ctrl->sched.heap[pos];
+	for (;;) {
+		child = 2 * pos + 1;
+		if (used <= child) {
+			break;
+		}
+		if (child + 1 < used
+			&& pri_sched_before(pri_sched_slot(ctrl, ctrl->sched.heap[child + 1]),
+				pri_sched_slot(ctrl, ctrl->sched.heap[child]))) {
+			++child;
+		}
+		if (!pri_sched_before(pri_sched_slot(ctrl, ctrl->sched.heap[child]),
+			pri_sched_slot(ctrl, x))) {
+			break;
+		}
+		pri_sched_heap_set(ctrl, pos, ctrl->sched.heap[child]);
+		pos = child;
+	}
+	pri_sched_heap_set(ctrl, pos, x);
+}
+
+/*!
+ * \internal
+ * \brief Remove the given active timer slot from the expiration heap.
+ *
+ * \param ctrl D channel controller.
+ * \param x Timer slot index.
+ *
+ * \return Nothing
+ */
+static void pri_sched_heap_remove(struct pri *ctrl, unsigned x)
+{
+	unsigned pos;
+	unsigned last;
+
+	pos = pri_sched_slot(ctrl, x)->heap_pos;
+	last = ctrl->sched.heap[--ctrl->sched.heap_used];
+	if (last == x) {
+		/* Removed the last heap entry. */
+		return;
+	}
+	pri_sched_heap_set(ctrl, pos, last);
+	if (pos && pri_sched_before(pri_sched_slot(ctrl, last),
+		pri_sched_slot(ctrl, ctrl->sched.heap[(pos - 1) / 2]))) {
+		pri_sched_heap_up(ctrl, pos);
+	} else {
+		pri_sched_heap_down(ctrl, pos);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Stop the given timer slot if it is active and free it.
+ *
+ * \param ctrl D channel controller.
+ * \param x Timer slot index.
+ *
+ * \return Nothing
+ */
+static void pri_sched_stop(struct pri *ctrl, unsigned x)
+{
+	struct pri_sched *timer;
+
+	if (ctrl->sched.num_slots <= x) {
+		return;
+	}
+	timer = pri_sched_slot(ctrl, x);
+	if (timer->callback) {
+		pri_sched_heap_remove(ctrl, x);
+		timer->callback = NULL;
+
+		/* Put the timer slot on the free list. */
+		timer->next_free = ctrl->sched.free_head;
+		ctrl->sched.free_head = x + 1;
+	}
 }
 
 /*!
@@ -127,36 +496,36 @@ static int pri_schedule_grow(struct pri *ctrl)
  */
 unsigned pri_schedule_event(struct pri *ctrl, int ms, void (*function)(void *data), void *data)
 {
-	unsigned max_used;
+	struct pri_sched *timer;
 	unsigned x;
 	struct timeval tv;
 
-	max_used = ctrl->sched.max_used;
-	for (x = 0; x < max_used; ++x) {
-		if (!ctrl->sched.timer[x].callback) {
-			break;
-		}
-	}
-	if (x == ctrl->sched.num_slots && pri_schedule_grow(ctrl)) {
+	if (!ctrl->sched.free_head && pri_schedule_grow(ctrl)) {
 		pri_error(ctrl, "No more room in scheduler\n");
 		return 0;
 	}
-	if (ctrl->sched.max_used <= x) {
-		ctrl->sched.max_used = x + 1;
-	}
-	if (x >= maxsched) {
-		maxsched = x + 1;
-	}
-	gettimeofday(&tv, NULL);
+	x = ctrl->sched.free_head - 1;
+	timer = pri_sched_slot(ctrl, x);
+	ctrl->sched.free_head = timer->next_free;
+	pri_schedule_now(ctrl, &tv);
 	tv.tv_sec += ms / 1000;
 	tv.tv_usec += (ms % 1000) * 1000;
-	if (tv.tv_usec > 1000000) {
+	if (tv.tv_usec >= 1000000) {
 		tv.tv_usec -= 1000000;
 		tv.tv_sec += 1;
 	}
-	ctrl->sched.timer[x].when = tv;
-	ctrl->sched.timer[x].callback = function;
-	ctrl->sched.timer[x].data = data;
+	timer->when = tv;
+	timer->callback = function;
+	timer->data = data;
+	timer->seq = ctrl->sched.seq++;
+
+	/* Put the new timer into the expiration heap. */
+	ctrl->sched.heap[ctrl->sched.heap_used] = x;
+	pri_sched_heap_up(ctrl, ctrl->sched.heap_used++);
+	if (ctrl->stats.sched_timers_max < ctrl->sched.heap_used) {
+		ctrl->stats.sched_timers_max = ctrl->sched.heap_used;
+	}
+
 	return ctrl->sched.first_id + x;
 }
 
@@ -169,28 +538,59 @@ unsigned pri_schedule_event(struct pri *ctrl, int ms, void (*function)(void *dat
  */
 struct timeval *pri_schedule_next(struct pri *ctrl)
 {
-	struct timeval *closest = NULL;
-	unsigned x;
-
-	/* Scan the scheduled timer slots backwards so we can update the max_used value. */
-	for (x = ctrl->sched.max_used; x--;) {
-		if (ctrl->sched.timer[x].callback) {
-			if (!closest) {
-				/* This is the highest sheduled timer slot in use. */
-				closest = &ctrl->sched.timer[x].when;
-				ctrl->sched.max_used = x + 1;
-			} else if ((closest->tv_sec > ctrl->sched.timer[x].when.tv_sec)
-				|| ((closest->tv_sec == ctrl->sched.timer[x].when.tv_sec)
-					&& (closest->tv_usec > ctrl->sched.timer[x].when.tv_usec))) {
-				closest = &ctrl->sched.timer[x].when;
-			}
-		}
+	if (ctrl->evq.head || pri_cmd_ring_pending(ctrl)) {
+		/* Queued events or commands are waiting for pri_schedule_run(). */
+		pri_schedule_now(ctrl, &ctrl->evq.when);
+		return &ctrl->evq.when;
 	}
-	if (!closest) {
+	if (!ctrl->sched.heap_used) {
 		/* No scheduled timer slots are active. */
-		ctrl->sched.max_used = 0;
+		return NULL;
+	}
+	return &pri_sched_slot(ctrl, ctrl->sched.heap[0])->when;
+}
+
+long long pri_schedule_next_ns(struct pri *ctrl)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timeval *next;
+	struct timeval now;
+	struct timeval diff;
+	struct timespec mono;
+
+	if (!ctrl) {
+		return -1;
+	}
+	next = pri_schedule_next(ctrl);
+	if (!next) {
+		return -1;
+	}
+	if (clock_gettime(CLOCK_MONOTONIC, &mono)) {
+		return -1;
+	}
+	if (!ctrl->sched.time_func && ctrl->sched.clock == PRI_SCHED_CLOCK_MONOTONIC) {
+		/* Already in the right time base. */
+		return next->tv_sec * 1000000000LL + next->tv_usec * 1000LL;
+	}
+
+	/* Move the deadline from the scheduler time base. */
+	pri_schedule_now(ctrl, &now);
+	diff.tv_sec = next->tv_sec - now.tv_sec;
+	diff.tv_usec = next->tv_usec - now.tv_usec;
+	if (diff.tv_usec < 0) {
+		diff.tv_usec += 1000000;
+		diff.tv_sec -= 1;
 	}
-	return closest;
+	if (diff.tv_sec < 0) {
+		diff.tv_sec = 0;
+		diff.tv_usec = 0;
+	}
+	return (mono.tv_sec + diff.tv_sec) * 1000000000LL + mono.tv_nsec
+		+ diff.tv_usec * 1000LL;
+#else
+	/* There is no CLOCK_MONOTONIC time base to give the deadline in. */
+	return -1;
+#endif	/* defined(CLOCK_MONOTONIC) */
 }
 
 /*!
@@ -199,31 +599,43 @@ struct timeval *pri_schedule_next(struct pri *ctrl)
  *
  * \param ctrl D channel controller.
  * \param tv Current time.
+ * \param seq_limit Schedule order of the first timer not to run.
+ *
+ * \note Timers started by the expired timer callbacks since seq_limit
+ * are not run even if they have already expired.
  *
  * \return Event for upper layer to process or NULL if all expired timers run.
  */
-static pri_event *__pri_schedule_run(struct pri *ctrl, struct timeval *tv)
+static pri_event *__pri_schedule_run(struct pri *ctrl, const struct timeval *tv, unsigned seq_limit)
 {
 	unsigned x;
-	unsigned max_used;
 	void (*callback)(void *);
 	void *data;
 
-	max_used = ctrl->sched.max_used;
-	for (x = 0; x < max_used; ++x) {
-		if (ctrl->sched.timer[x].callback
-			&& ((ctrl->sched.timer[x].when.tv_sec < tv->tv_sec)
-			|| ((ctrl->sched.timer[x].when.tv_sec == tv->tv_sec)
-			&& (ctrl->sched.timer[x].when.tv_usec <= tv->tv_usec)))) {
-			/* This timer has expired. */
-			ctrl->schedev = 0;
-			callback = ctrl->sched.timer[x].callback;
-			data = ctrl->sched.timer[x].data;
-			ctrl->sched.timer[x].callback = NULL;
-			callback(data);
-			if (ctrl->schedev) {
-				return &ctrl->ev;
-			}
+	while (ctrl->sched.heap_used) {
+		x = ctrl->sched.heap[0];
+		if (tv->tv_sec < pri_sched_slot(ctrl, x)->when.tv_sec
+			|| (tv->tv_sec == pri_sched_slot(ctrl, x)->when.tv_sec
+			&& tv->tv_usec < pri_sched_slot(ctrl, x)->when.tv_usec)) {
+			/* The earliest timer has not expired yet. */
+			break;
+		}
+		if (0 <= (int) (pri_sched_slot(ctrl, x)->seq - seq_limit)) {
+			/*
+			 * This timer was started by a callback in this pass.  Any
+			 * older expired timers have already run since they sort first.
+			 */
+			break;
+		}
+
+		/* This timer has expired. */
+		ctrl->schedev = 0;
+		callback = pri_sched_slot(ctrl, x)->callback;
+		data = pri_sched_slot(ctrl, x)->data;
+		pri_sched_stop(ctrl, x);
+		callback(data);
+		if (ctrl->schedev) {
+			return &ctrl->ev;
 		}
 	}
 	return NULL;
@@ -234,14 +646,106 @@ static pri_event *__pri_schedule_run(struct pri *ctrl, struct timeval *tv)
  *
  * \param ctrl D channel controller.
  *
+ * \note Any queued events are returned before running timers.
+ *
  * \return Event for upper layer to process or NULL if all expired timers run.
  */
 pri_event *pri_schedule_run(struct pri *ctrl)
 {
-	struct timeval tv;
+	return pri_schedule_run_tv(ctrl, NULL);
+}
+
+/*!
+ * \brief Run all timers expired at the given time or return an event generated by an expired timer.
+ *
+ * \param ctrl D channel controller.
+ * \param now Current time in the scheduler time base.  NULL to read the clock.
+ *
+ * \note Any queued events are returned before running timers.
+ *
+ * \return Event for upper layer to process or NULL if all expired timers run.
+ */
+pri_event *pri_schedule_run_tv(struct pri *ctrl, const struct timeval *now)
+{
+	pri_event *e;
+	struct pri_event_node *mark;
+
+	pri_schedule_pass_begin(ctrl, now);
+	mark = ctrl->evq.tail;
+	pri_cmd_ring_run(ctrl);
+	e = NULL;
+	if (!ctrl->evq.head) {
+		e = __pri_schedule_run(ctrl, &ctrl->sched.now, ctrl->sched.seq);
+	}
+	e = pri_event_deliver(ctrl, e, mark);
+	pri_schedule_pass_end(ctrl);
+	return e;
+}
+
+int pri_schedule_run_batch(struct pri *ctrl, const struct timeval *now, struct pri_event_batch *ring)
+{
+	pri_event *e;
+	struct pri_event_node *mark;
+	unsigned seq_limit;
+	int added;
+
+	if (!ctrl || !ring || !ring->entry || ring->size < ring->count) {
+		return -1;
+	}
 
-	gettimeofday(&tv, NULL);
-	return __pri_schedule_run(ctrl, &tv);
+	pri_schedule_pass_begin(ctrl, now);
+	pri_cmd_ring_run(ctrl);
+	seq_limit = ctrl->sched.seq;
+	for (added = 0; ring->count < ring->size; ++added) {
+		/* Queued events go first. */
+		mark = ctrl->evq.tail;
+		e = NULL;
+		if (!ctrl->evq.head) {
+			e = __pri_schedule_run(ctrl, &ctrl->sched.now, seq_limit);
+		}
+		e = pri_event_deliver(ctrl, e, mark);
+		if (!e) {
+			break;
+		}
+		pri_event_save(ctrl, &ring->entry[(ring->head + ring->count) % ring->size], e);
+		++ring->count;
+	}
+	pri_schedule_pass_end(ctrl);
+	return added;
+}
+
+/*!
+ * \internal
+ * \brief Find the D channel owning the given timer id.
+ *
+ * \param ctrl D channel controller.
+ * \param id Scheduled event id.  (Not 0)
+ *
+ * \note Timers started by another D channel of the same NFAS group
+ * are found through the context timer pool owner table.
+ *
+ * \retval owner D channel controller if found.
+ * \retval NULL if the timer pool is not owned by this NFAS group.
+ */
+static struct pri *pri_sched_owner(struct pri *ctrl, unsigned id)
+{
+	struct pri *owner;
+
+	if (ctrl->sched.first_id <= id
+		&& id <= ctrl->sched.first_id + (SCHED_POOL_IDS - 1)) {
+		return ctrl;
+	}
+	if (!ctrl->nfas) {
+		return NULL;
+	}
+	if (!ctrl->ctx->pool_owner) {
+		return NULL;
+	}
+	owner = ctrl->ctx->pool_owner[id >> PRI_SCHED_POOL_BITS];
+	if (!owner || !owner->nfas || PRI_NFAS_MASTER(owner) != PRI_NFAS_MASTER(ctrl)) {
+		return NULL;
+	}
+	return owner;
 }
 
 /*!
@@ -255,32 +759,74 @@ pri_event *pri_schedule_run(struct pri *ctrl)
  */
 void pri_schedule_del(struct pri *ctrl, unsigned id)
 {
-	struct pri *nfas;
+	struct pri *owner;
 
 	if (!id) {
 		/* Disabled/unscheduled event id. */
 		return;
 	}
-	if (ctrl->sched.first_id <= id
-		&& id <= ctrl->sched.first_id + (SCHED_EVENTS_MAX - 1)) {
-		ctrl->sched.timer[id - ctrl->sched.first_id].callback = NULL;
+	owner = pri_sched_owner(ctrl, id);
+	if (owner) {
+		pri_sched_stop(owner, id - owner->sched.first_id);
 		return;
 	}
-	if (ctrl->nfas) {
-		/* Try to find the timer on another D channel. */
-		for (nfas = PRI_NFAS_MASTER(ctrl); nfas; nfas = nfas->slave) {
-			if (nfas->sched.first_id <= id
-				&& id <= nfas->sched.first_id + (SCHED_EVENTS_MAX - 1)) {
-				nfas->sched.timer[id - nfas->sched.first_id].callback = NULL;
-				return;
-			}
-		}
-	}
 	pri_error(ctrl,
 		"Asked to delete sched id 0x%08x??? first_id=0x%08x, num_slots=0x%08x\n", id,
 		ctrl->sched.first_id, ctrl->sched.num_slots);
 }
 
+/*!
+ * \brief Release all scheduler timer slots.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \note Any active timers are discarded without running them.
+ *
+ * \return Nothing
+ */
+void pri_schedule_destroy(struct pri *ctrl)
+{
+	unsigned idx;
+
+	if (ctrl->sched.num_chunks) {
+		/* Give the timer pool back. */
+		ctrl->ctx->pool_owner[ctrl->sched.first_id >> PRI_SCHED_POOL_BITS] = NULL;
+	}
+	for (idx = 0; idx < ctrl->sched.num_chunks; ++idx) {
+		free(ctrl->sched.chunk[idx]);
+	}
+	free(ctrl->sched.chunk);
+	free(ctrl->sched.heap);
+	ctrl->sched.chunk = NULL;
+	ctrl->sched.heap = NULL;
+	ctrl->sched.num_chunks = 0;
+	ctrl->sched.num_slots = 0;
+	ctrl->sched.free_head = 0;
+	ctrl->sched.heap_used = 0;
+}
+
+/*!
+ * \internal
+ * \brief Does the given timer slot have the callback.
+ *
+ * \param ctrl D channel controller.
+ * \param x Timer slot index.
+ * \param function Callback function to call when timeout.
+ * \param data Value to give callback function when timeout.
+ *
+ * \return TRUE if the timer slot has the callback.
+ */
+static int pri_sched_match(struct pri *ctrl, unsigned x, void (*function)(void *data), void *data)
+{
+	struct pri_sched *timer;
+
+	if (ctrl->sched.num_slots <= x) {
+		return 0;
+	}
+	timer = pri_sched_slot(ctrl, x);
+	return timer->callback == function && timer->data == data;
+}
+
 /*!
  * \brief Is the scheduled event this callback.
  *
@@ -294,26 +840,15 @@ void pri_schedule_del(struct pri *ctrl, unsigned id)
  */
 int pri_schedule_check(struct pri *ctrl, unsigned id, void (*function)(void *data), void *data)
 {
-	struct pri *nfas;
+	struct pri *owner;
 
 	if (!id) {
 		/* Disabled/unscheduled event id. */
 		return 0;
 	}
-	if (ctrl->sched.first_id <= id
-		&& id <= ctrl->sched.first_id + (SCHED_EVENTS_MAX - 1)) {
-		return ctrl->sched.timer[id - ctrl->sched.first_id].callback == function
-			&& ctrl->sched.timer[id - ctrl->sched.first_id].data == data;
-	}
-	if (ctrl->nfas) {
-		/* Try to find the timer on another D channel. */
-		for (nfas = PRI_NFAS_MASTER(ctrl); nfas; nfas = nfas->slave) {
-			if (nfas->sched.first_id <= id
-				&& id <= nfas->sched.first_id + (SCHED_EVENTS_MAX - 1)) {
-				return nfas->sched.timer[id - nfas->sched.first_id].callback == function
-					&& nfas->sched.timer[id - nfas->sched.first_id].data == data;
-			}
-		}
+	owner = pri_sched_owner(ctrl, id);
+	if (owner) {
+		return pri_sched_match(owner, id - owner->sched.first_id, function, data);
 	}
 	pri_error(ctrl,
 		"Asked to check sched id 0x%08x??? first_id=0x%08x, num_slots=0x%08x\n", id,
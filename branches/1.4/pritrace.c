@@ -0,0 +1,217 @@
+/*
+ * libpri: An implementation of Primary Rate ISDN
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ *
+ * In addition, when this program is distributed with Asterisk in
+ * any form that would qualify as a 'combined work' or as a
+ * 'derivative work' (but not mere aggregation), you can redistribute
+ * and/or modify the combination under the terms of the license
+ * provided with that copy of Asterisk, instead of the license
+ * terms granted here.
+ */
+
+/*
+ * This program renders a file of binary trace records saved from
+ * pri_trace_ring_read() as the libpri debug trace would have.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "compat.h"
+#include "libpri.h"
+#include "pri_internal.h"
+
+static int trace_flags = PRI_DEBUG_Q921_DUMP | PRI_DEBUG_Q931_DUMP;
+
+static int discard_io(struct pri *pri, void *buf, int buflen)
+{
+	/* The decoder never sends anything. */
+	return buflen;
+}
+
+static void my_pri_message(struct pri *pri, char *stuff)
+{
+	fprintf(stdout, "%s", stuff);
+}
+
+static void my_pri_error(struct pri *pri, char *stuff)
+{
+	fprintf(stderr, "%s", stuff);
+}
+
+static struct pri *session_new(int switchtype, int nodetype, int mode)
+{
+	struct pri *pri;
+
+	switch (mode) {
+	case PRI_TRACE_MODE_BRI_PTP:
+		pri = pri_new_bri_cb(-1, 1, nodetype, switchtype, discard_io, discard_io, NULL);
+		break;
+	case PRI_TRACE_MODE_BRI_PTMP:
+		pri = pri_new_bri_cb(-1, 0, nodetype, switchtype, discard_io, discard_io, NULL);
+		break;
+	case PRI_TRACE_MODE_PRI:
+	default:
+		pri = pri_new_cb(-1, nodetype, switchtype, discard_io, discard_io, NULL);
+		break;
+	}
+	if (pri) {
+		pri_set_debug(pri, trace_flags);
+	}
+	return pri;
+}
+
+/*!
+ * \brief Get a decoder controller for the given session parameters.
+ *
+ * \param pri Current decoder controller.  (NULL if none yet)
+ * \param switchtype Switch type of the session.
+ * \param nodetype Node type of the session.
+ * \param mode PRI_TRACE_MODE_xxx of the session.
+ *
+ * \return Controller to decode the session frames with.  (NULL on error)
+ */
+static struct pri *session_get(struct pri *pri, int switchtype, int nodetype, int mode)
+{
+	static int cur_switchtype;
+	static int cur_nodetype;
+	static int cur_mode;
+
+	if (pri && cur_switchtype == switchtype && cur_nodetype == nodetype
+		&& cur_mode == mode) {
+		return pri;
+	}
+
+	/*
+	 * libpri cannot free a controller, so the old one is leaked when the
+	 * parameters change.  A trace file rarely has more than a few sessions.
+	 */
+	pri = session_new(switchtype, nodetype, mode);
+	cur_switchtype = switchtype;
+	cur_nodetype = nodetype;
+	cur_mode = mode;
+	return pri;
+}
+
+static void dump_frame(struct pri *pri, const struct pri_trace_record *rec)
+{
+	const q921_h *h = (const q921_h *) rec->data;
+	int len = rec->data_len;
+
+	q921_dump(pri, h, len, trace_flags, rec->txrx);
+	if (!(trace_flags & PRI_DEBUG_Q931_DUMP) || h->h.sapi != Q921_SAPI_CALL_CTRL) {
+		return;
+	}
+	if (!(h->h.data[0] & 0x01)) {
+		/* I frame */
+		if (4 < len) {
+			q931_dump(pri, h->h.tei, (const q931_h *) h->i.data, len - 4, rec->txrx);
+		}
+	} else if (h->u.ft == 3 && !h->u.m2 && !h->u.m3) {
+		/* UI frame */
+		if (3 < len) {
+			q931_dump(pri, h->h.tei, (const q931_h *) h->u.data, len - 3, rec->txrx);
+		}
+	}
+}
+
+static void dump_record(struct pri **pri, const struct pri_trace_record *rec)
+{
+	printf("[%u.%06u] ", rec->sec, rec->usec);
+	switch (rec->type) {
+	case PRI_TRACE_REC_SESSION:
+		printf("Session: %s %s mode %d\n", pri_switch2str(rec->arg[0]),
+			pri_node2str(rec->arg[1]), rec->arg[2]);
+		*pri = session_get(*pri, rec->arg[0], rec->arg[1], rec->arg[2]);
+		break;
+	case PRI_TRACE_REC_FRAME:
+		printf("%s frame TEI=%d SAPI=%d len=%d\n", rec->txrx ? "Sent" : "Received",
+			rec->tei, rec->arg[0], rec->data_len);
+		if (!*pri) {
+			/* No session record.  Guess. */
+			*pri = session_get(NULL, PRI_SWITCH_NI2, PRI_CPE, PRI_TRACE_MODE_PRI);
+		}
+		if (*pri) {
+			dump_frame(*pri, rec);
+		}
+		break;
+	case PRI_TRACE_REC_Q921_STATE:
+		printf("TEI=%d Changing from state %d(%s) to %d(%s)\n", rec->tei,
+			rec->arg[0], q921_state2str(rec->arg[0]),
+			rec->arg[1], q921_state2str(rec->arg[1]));
+		break;
+	case PRI_TRACE_REC_CALL_STATE:
+		printf("Call %d enters state %d (%s)\n", rec->arg[0], rec->arg[2],
+			q931_call_state_str(rec->arg[2]));
+		break;
+	case PRI_TRACE_REC_DROPPED:
+		printf("!! %d trace records lost !!\n", rec->arg[0]);
+		break;
+	default:
+		printf("Unknown record type %d\n", rec->type);
+		break;
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pri_trace_record *rec;
+	struct pri *pri = NULL;
+	unsigned char buf[0x10000];
+	FILE *f;
+	int c;
+
+	while ((c = getopt(argc, argv, "r")) != -1) {
+		switch (c) {
+		case 'r':
+			trace_flags |= PRI_DEBUG_Q921_RAW;
+			break;
+		default:
+			fprintf(stderr, "Usage: pritrace [-r] <tracefile>\n");
+			exit(1);
+		}
+	}
+	if (argc <= optind) {
+		fprintf(stderr, "Usage: pritrace [-r] <tracefile>\n");
+		exit(1);
+	}
+
+	f = fopen(argv[optind], "r");
+	if (!f) {
+		perror(argv[optind]);
+		exit(1);
+	}
+
+	pri_set_message(my_pri_message);
+	pri_set_error(my_pri_error);
+
+	rec = (struct pri_trace_record *) buf;
+	while (fread(rec, sizeof(*rec), 1, f) == 1) {
+		if (rec->len < sizeof(*rec) || (rec->len & 3)
+			|| rec->len < sizeof(*rec) + rec->data_len) {
+			fprintf(stderr, "Corrupt trace record\n");
+			exit(1);
+		}
+		if (fread(rec->data, rec->len - sizeof(*rec), 1, f) != 1
+			&& sizeof(*rec) < rec->len) {
+			fprintf(stderr, "Truncated trace record\n");
+			exit(1);
+		}
+		dump_record(&pri, rec);
+	}
+	fclose(f);
+	return 0;
+}
@@ -103,7 +103,7 @@ static const char *q921_tei_mgmt2str(enum q921_tei_identity message)
  *
  * \return State name string
  */
-static const char *q921_state2str(enum q921_state state)
+const char *q921_state2str(enum q921_state state)
 {
 	switch (state) {
 	case Q921_TEI_UNASSIGNED:
@@ -132,7 +132,10 @@ static void q921_setstate(struct q921_link *link, int newstate)
 	struct pri *ctrl;
 
 	ctrl = link->ctrl;
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (ctrl->trace_ring && link->state != newstate) {
+		pri_trace_q921_state(ctrl, link->tei, link->state, newstate);
+	}
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		/*
 		 * Suppress displaying these state transitions:
 		 * Q921_MULTI_FRAME_ESTABLISHED <--> Q921_TIMER_RECOVERY
@@ -165,18 +168,96 @@ static void q921_setstate(struct q921_link *link, int newstate)
 	link->state = newstate;
 }
 
+/*!
+ * \internal
+ * \brief Get the Tx queue frame buffer at the given sequence.
+ *
+ * \param link Q.921 link holding the Tx queue.
+ * \param seq Tx queue sequence counter value.
+ *
+ * \return Frame buffer
+ */
+static inline struct q921_frame *q921_tx_frame(struct q921_link *link, unsigned seq)
+{
+	return link->tx_queue.ring[seq & (link->tx_queue.size - 1)];
+}
+
 static void q921_discard_iqueue(struct q921_link *link)
 {
-	struct q921_frame *f, *p;
+	/* The frame buffers are kept for reuse. */
+	link->tx_queue.head = link->tx_queue.tail;
+	link->tx_queue.next = link->tx_queue.tail;
+}
+
+/*!
+ * \brief Release the I frame Tx queue buffers of the given link.
+ *
+ * \param link Q.921 link to release the Tx queue buffers.
+ *
+ * \return Nothing
+ */
+void q921_free_iqueue(struct q921_link *link)
+{
+	unsigned idx;
 
-	f = link->tx_queue;
-	while (f) {
-		p = f;
-		f = f->next;
-		/* Free frame */
-		free(p);
+	for (idx = 0; idx < link->tx_queue.size; ++idx) {
+		free(link->tx_queue.ring[idx]);
 	}
-	link->tx_queue = NULL;
+	free(link->tx_queue.ring);
+	memset(&link->tx_queue, 0, sizeof(link->tx_queue));
+}
+
+/*!
+ * \internal
+ * \brief Get the frame buffer at the tail of the Tx queue.
+ *
+ * \param link Q.921 link holding the Tx queue.
+ * \param len Length of the I frame information field to hold.
+ *
+ * \note The ring only grows when more frames are queued than it has
+ * positions.  That only happens while unsent frames pile up waiting for
+ * the link to come up.
+ *
+ * \retval frame on success.  (Header and data zeroed)
+ * \retval NULL on error.
+ */
+static struct q921_frame *q921_tx_frame_get(struct q921_link *link, int len)
+{
+	struct q921_tx_queue *queue;
+	struct q921_frame **ring;
+	struct q921_frame **pos;
+	unsigned size;
+	unsigned seq;
+
+	queue = &link->tx_queue;
+	if (Q921_TX_FRAME_DATA_MAX < len) {
+		pri_error(link->ctrl, "!! I frame too long (%d > %d)\n", len,
+			Q921_TX_FRAME_DATA_MAX);
+		return NULL;
+	}
+	if (queue->tail - queue->head == queue->size) {
+		/* The ring is full.  Double it. */
+		size = queue->size ? queue->size * 2 : Q921_TX_QUEUE_INITIAL;
+		ring = calloc(size, sizeof(*ring));
+		if (!ring) {
+			return NULL;
+		}
+		for (seq = queue->head; seq != queue->tail; ++seq) {
+			ring[seq & (size - 1)] = queue->ring[seq & (queue->size - 1)];
+		}
+		free(queue->ring);
+		queue->ring = ring;
+		queue->size = size;
+	}
+	pos = &queue->ring[queue->tail & (queue->size - 1)];
+	if (!*pos) {
+		*pos = malloc(sizeof(**pos) + Q921_TX_FRAME_DATA_MAX + 2);
+		if (!*pos) {
+			return NULL;
+		}
+	}
+	memset(*pos, 0, sizeof(**pos) + len + 2);
+	return *pos;
 }
 
 static int q921_transmit(struct pri *ctrl, q921_h *h, int len) 
@@ -190,9 +271,32 @@ static int q921_transmit(struct pri *ctrl, q921_h *h, int len)
 	}
 #endif
 	ctrl->q921_txcount++;
+	if (ctrl->trace_ring) {
+		pri_trace_frame(ctrl, h, len, 1);
+	}
+	if (ctrl->pcap) {
+		pri_pcap_frame(ctrl, h, len, 1);
+	}
 	/* Just send it raw */
-	if (ctrl->debug & (PRI_DEBUG_Q921_DUMP | PRI_DEBUG_Q921_RAW))
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP | PRI_DEBUG_Q921_RAW))
 		q921_dump(ctrl, h, len, ctrl->debug, 1);
+	if (ctrl->tx_batch.write_func && ctrl->sched.now_cached) {
+		/* Collect the frame to write when the processing pass ends. */
+		if (ctrl->tx_batch.count == Q921_TX_BATCH_FRAMES
+			|| Q921_TX_BATCH_OCTETS - ctrl->tx_batch.used < len + 2) {
+			q921_transmit_flush(ctrl);
+		}
+		if (len + 2 <= Q921_TX_BATCH_OCTETS) {
+			struct pri_io_frame *frame;
+
+			frame = &ctrl->tx_batch.frame[ctrl->tx_batch.count++];
+			frame->buf = ctrl->tx_batch.buf + ctrl->tx_batch.used;
+			frame->len = len + 2;
+			memcpy(frame->buf, h, len + 2);
+			ctrl->tx_batch.used += len + 2;
+			return 0;
+		}
+	}
 	/* Write an extra two bytes for the FCS */
 	res = ctrl->write_func ? ctrl->write_func(ctrl, h, len + 2) : 0;
 	if (res != (len + 2)) {
@@ -202,6 +306,29 @@ static int q921_transmit(struct pri *ctrl, q921_h *h, int len)
 	return 0;
 }
 
+/*!
+ * \brief Write the frames collected for a batched write.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \return Nothing
+ */
+void q921_transmit_flush(struct pri *ctrl)
+{
+	int res;
+
+	if (!ctrl->tx_batch.count) {
+		return;
+	}
+	res = ctrl->tx_batch.write_func(ctrl, ctrl->tx_batch.frame, ctrl->tx_batch.count);
+	if (res != ctrl->tx_batch.count) {
+		pri_error(ctrl, "Short batch write: %d/%d frames (%s)\n", res,
+			ctrl->tx_batch.count, strerror(errno));
+	}
+	ctrl->tx_batch.count = 0;
+	ctrl->tx_batch.used = 0;
+}
+
 static void q921_mdl_send(struct pri *ctrl, enum q921_tei_identity message, int ri, int ai, int iscommand)
 {
 	q921_u *f;
@@ -217,7 +344,7 @@ static void q921_mdl_send(struct pri *ctrl, enum q921_tei_identity message, int
 	f->data[2] = ri & 0xff;
 	f->data[3] = message;
 	f->data[4] = (ai << 1) | 1;
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl,
 			"Sending MDL message: %d(%s), TEI=%d\n",
 			message, q921_tei_mgmt2str(message), ai);
@@ -310,7 +437,7 @@ static void q921_send_dm(struct q921_link *link, int fbit)
 		pri_error(ctrl, "Don't know how to DM on a type %d node\n", ctrl->localtype);
 		return;
 	}
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Sending DM\n", link->tei);
 	}
 	q921_transmit(ctrl, &h, 3);
@@ -339,7 +466,7 @@ static void q921_send_disc(struct q921_link *link, int pbit)
 		pri_error(ctrl, "Don't know how to DISC on a type %d node\n", ctrl->localtype);
 		return;
 	}
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Sending DISC\n", link->tei);
 	}
 	q921_transmit(ctrl, &h, 3);
@@ -368,7 +495,7 @@ static void q921_send_ua(struct q921_link *link, int fbit)
 		pri_error(ctrl, "Don't know how to UA on a type %d node\n", ctrl->localtype);
 		return;
 	}
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Sending UA\n", link->tei);
 	}
 	q921_transmit(ctrl, &h, 3);
@@ -397,7 +524,7 @@ static void q921_send_sabme(struct q921_link *link)
 		pri_error(ctrl, "Don't know how to SABME on a type %d node\n", ctrl->localtype);
 		return;
 	}
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Sending SABME\n", link->tei);
 	}
 	q921_transmit(ctrl, &h, 3);
@@ -406,38 +533,29 @@ static void q921_send_sabme(struct q921_link *link)
 static int q921_ack_packet(struct q921_link *link, int num)
 {
 	struct q921_frame *f;
-	struct q921_frame *prev;
 	struct pri *ctrl;
 
 	ctrl = link->ctrl;
 
-	for (prev = NULL, f = link->tx_queue; f; prev = f, f = f->next) {
-		if (f->status != Q921_TX_FRAME_SENT) {
-			break;
-		}
-		if (f->h.n_s == num) {
-			/* Cancel each packet as necessary */
-			/* That's our packet */
-			if (prev)
-				prev->next = f->next;
-			else
-				link->tx_queue = f->next;
-			if (ctrl->debug & PRI_DEBUG_Q921_DUMP) {
-				pri_message(ctrl,
-					"-- ACKing N(S)=%d, tx_queue head is N(S)=%d (-1 is empty, -2 is not transmitted)\n",
-					f->h.n_s,
-					link->tx_queue
-						? link->tx_queue->status == Q921_TX_FRAME_SENT
-							? link->tx_queue->h.n_s
-							: -2
-						: -1);
-			}
-			/* Update v_a */
-			free(f);
-			return 1;
-		}
+	/* Frames are acknowledged in sequence so only the oldest sent frame can match. */
+	if (link->tx_queue.head == link->tx_queue.next) {
+		return 0;
 	}
-	return 0;
+	f = q921_tx_frame(link, link->tx_queue.head);
+	if (f->h.n_s != num) {
+		return 0;
+	}
+	/* That's our packet */
+	++link->tx_queue.head;
+	PRI_TRACE(ctrl, PRI_DEBUG_Q921_DUMP,
+		"-- ACKing N(S)=%d, tx_queue head is N(S)=%d (-1 is empty, -2 is not transmitted)\n",
+		f->h.n_s,
+		link->tx_queue.head != link->tx_queue.tail
+			? link->tx_queue.head != link->tx_queue.next
+				? q921_tx_frame(link, link->tx_queue.head)->h.n_s
+				: -2
+			: -1);
+	return 1;
 }
 
 static void t203_expire(void *vlink);
@@ -450,7 +568,7 @@ static void reschedule_t200(struct q921_link *link)
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 		pri_message(ctrl, "-- Restarting T200 timer\n");
 	pri_schedule_del(ctrl, link->t200_timer);
 	link->t200_timer = pri_schedule_event(ctrl, ctrl->timers[PRI_TIMER_T200], t200_expire, link);
@@ -463,7 +581,7 @@ static void reschedule_t203(struct q921_link *link)
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 		pri_message(ctrl, "-- Restarting T203 timer\n");
 	pri_schedule_del(ctrl, link->t203_timer);
 	link->t203_timer = pri_schedule_event(ctrl, ctrl->timers[PRI_TIMER_T203], t203_expire, link);
@@ -477,11 +595,11 @@ static void start_t203(struct q921_link *link)
 	ctrl = link->ctrl;
 
 	if (link->t203_timer) {
-		if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 			pri_message(ctrl, "T203 requested to start without stopping first\n");
 		pri_schedule_del(ctrl, link->t203_timer);
 	}
-	if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 		pri_message(ctrl, "-- Starting T203 timer\n");
 	link->t203_timer = pri_schedule_event(ctrl, ctrl->timers[PRI_TIMER_T203], t203_expire, link);
 }
@@ -493,12 +611,12 @@ static void stop_t203(struct q921_link *link)
 	ctrl = link->ctrl;
 
 	if (link->t203_timer) {
-		if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 			pri_message(ctrl, "-- Stopping T203 timer\n");
 		pri_schedule_del(ctrl, link->t203_timer);
 		link->t203_timer = 0;
 	} else {
-		if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 			pri_message(ctrl, "-- T203 requested to stop when not started\n");
 	}
 }
@@ -510,11 +628,11 @@ static void start_t200(struct q921_link *link)
 	ctrl = link->ctrl;
 
 	if (link->t200_timer) {
-		if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 			pri_message(ctrl, "T200 requested to start without stopping first\n");
 		pri_schedule_del(ctrl, link->t200_timer);
 	}
-	if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 		pri_message(ctrl, "-- Starting T200 timer\n");
 	link->t200_timer = pri_schedule_event(ctrl, ctrl->timers[PRI_TIMER_T200], t200_expire, link);
 }
@@ -526,12 +644,12 @@ static void stop_t200(struct q921_link *link)
 	ctrl = link->ctrl;
 
 	if (link->t200_timer) {
-		if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 			pri_message(ctrl, "-- Stopping T200 timer\n");
 		pri_schedule_del(ctrl, link->t200_timer);
 		link->t200_timer = 0;
 	} else {
-		if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 			pri_message(ctrl, "-- T200 requested to stop when not started\n");
 	}
 }
@@ -552,20 +670,20 @@ static void kick_start_link(struct q921_link *link)
 
 	switch (link->state) {
 	case Q921_TEI_UNASSIGNED:
-		if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 			pri_message(ctrl, "Kick starting link from no TEI.\n");
 		}
 		q921_setstate(link, Q921_ESTABLISH_AWAITING_TEI);
 		q921_tei_request(link);
 		break;
 	case Q921_ASSIGN_AWAITING_TEI:
-		if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 			pri_message(ctrl, "Kick starting link when awaiting TEI.\n");
 		}
 		q921_setstate(link, Q921_ESTABLISH_AWAITING_TEI);
 		break;
 	case Q921_TEI_ASSIGNED:
-		if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 			pri_message(ctrl, "SAPI/TEI=%d/%d Kick starting link\n", link->sapi,
 				link->tei);
 		}
@@ -619,7 +737,7 @@ static void restart_timer_start(struct q921_link *link)
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_DUMP) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP)) {
 		pri_message(ctrl, "SAPI/TEI=%d/%d Starting link restart delay timer\n",
 			link->sapi, link->tei);
 	}
@@ -701,59 +819,51 @@ static int q921_send_queued_iframes(struct q921_link *link)
 
 	ctrl = link->ctrl;
 
-	for (f = link->tx_queue; f; f = f->next) {
-		if (f->status != Q921_TX_FRAME_SENT) {
-			/* This frame needs to be sent. */
-			break;
-		}
-	}
-	if (!f) {
+	if (link->tx_queue.next == link->tx_queue.tail) {
 		/* The Tx queue has no pending frames. */
 		return 0;
 	}
 
 	if (link->peer_rx_busy) {
 		/* Don't flood debug trace if not really looking at Q.921 layer. */
-		if (ctrl->debug & (/* PRI_DEBUG_Q921_STATE | */ PRI_DEBUG_Q921_DUMP)) {
-			pri_message(ctrl,
-				"TEI=%d Couldn't transmit I-frame at this time due to peer busy condition\n",
-				link->tei);
-		}
+		PRI_TRACE(ctrl, /* PRI_DEBUG_Q921_STATE | */ PRI_DEBUG_Q921_DUMP,
+			"TEI=%d Couldn't transmit I-frame at this time due to peer busy condition\n",
+			link->tei);
+		++ctrl->stats.peer_busy_stalls;
 		return 0;
 	}
 	if (link->v_s == Q921_ADD(link->v_a, ctrl->timers[PRI_TIMER_K])) {
 		/* Don't flood debug trace if not really looking at Q.921 layer. */
-		if (ctrl->debug & (/* PRI_DEBUG_Q921_STATE | */ PRI_DEBUG_Q921_DUMP)) {
-			pri_message(ctrl,
-				"TEI=%d Couldn't transmit I-frame at this time due to window shut\n",
-				link->tei);
-		}
+		PRI_TRACE(ctrl, /* PRI_DEBUG_Q921_STATE | */ PRI_DEBUG_Q921_DUMP,
+			"TEI=%d Couldn't transmit I-frame at this time due to window shut\n",
+			link->tei);
+		++ctrl->stats.window_stalls;
 		return 0;
 	}
 
 	/* Send all pending frames that fit in the window. */
-	for (; f; f = f->next) {
+	for (; link->tx_queue.next != link->tx_queue.tail; ++link->tx_queue.next) {
 		if (link->v_s == Q921_ADD(link->v_a, ctrl->timers[PRI_TIMER_K])) {
 			/* The window is no longer open. */
 			break;
 		}
+		f = q921_tx_frame(link, link->tx_queue.next);
 
 		/* Send it now... */
 		switch (f->status) {
 		case Q921_TX_FRAME_NEVER_SENT:
-			if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
-				pri_message(ctrl,
-					"TEI=%d Transmitting N(S)=%d, window is open V(A)=%d K=%d\n",
-					link->tei, link->v_s, link->v_a, ctrl->timers[PRI_TIMER_K]);
-			}
+			PRI_TRACE(ctrl, PRI_DEBUG_Q921_STATE,
+				"TEI=%d Transmitting N(S)=%d, window is open V(A)=%d K=%d\n",
+				link->tei, link->v_s, link->v_a, ctrl->timers[PRI_TIMER_K]);
 			break;
 		case Q921_TX_FRAME_PUSHED_BACK:
+			++ctrl->stats.iframe_retx;
 			if (f->h.n_s != link->v_s) {
 				/* Should never happen. */
 				pri_error(ctrl,
 					"TEI=%d Retransmitting frame with old N(S)=%d as N(S)=%d!\n",
 					link->tei, f->h.n_s, link->v_s);
-			} else if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+			} else if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 				pri_message(ctrl, "TEI=%d Retransmitting frame N(S)=%d now!\n",
 					link->tei, link->v_s);
 			}
@@ -779,7 +889,7 @@ static int q921_send_queued_iframes(struct q921_link *link)
 		Q921_INC(link->v_s);
 		++frames_txd;
 
-		if ((ctrl->debug & PRI_DEBUG_Q931_DUMP)
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_DUMP)
 			&& f->status == Q921_TX_FRAME_NEVER_SENT) {
 			/*
 			 * The transmit operation might dump the Q.921 header, so logging
@@ -829,9 +939,10 @@ static void q921_reject(struct q921_link *link, int pf)
 		pri_error(ctrl, "Don't know how to REJ on a type %d node\n", ctrl->localtype);
 		return;
 	}
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Sending REJ N(R)=%d\n", link->tei, link->v_r);
 	}
+	++ctrl->stats.rej_tx;
 	q921_transmit(ctrl, &h, 4);
 }
 
@@ -866,7 +977,7 @@ static void q921_rr(struct q921_link *link, int pbit, int cmd)
 		return;
 	}
 #if 0	/* Don't flood debug trace with RR if not really looking at Q.921 layer. */
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Sending RR N(R)=%d\n", link->tei, link->v_r);
 	}
 #endif
@@ -891,12 +1002,13 @@ static void t200_expire(void *vlink)
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_DUMP) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP)) {
 		pri_message(ctrl, "%s\n", __FUNCTION__);
 		q921_dump_pri(link, ' ');
 	}
 
 	link->t200_timer = 0;
+	++ctrl->stats.t200_expiries;
 
 	switch (link->state) {
 	case Q921_MULTI_FRAME_ESTABLISHED:
@@ -1011,9 +1123,12 @@ static struct q921_link *pri_find_tei(struct pri *ctrl, int sapi, int tei)
 {
 	struct q921_link *link;
 
-	for (link = &ctrl->link; link; link = link->next) {
-		if (link->tei == tei && link->sapi == sapi)
-			return link;
+	if (tei < 0 || Q921_TEI_GROUP < tei) {
+		return NULL;
+	}
+	link = ctrl->tei_link[tei];
+	if (link && link->sapi == sapi) {
+		return link;
 	}
 
 	return NULL;
@@ -1022,7 +1137,7 @@ static struct q921_link *pri_find_tei(struct pri *ctrl, int sapi, int tei)
 /* This is the equivalent of a DL-DATA request, as well as the I-frame queued up outcome */
 int q921_transmit_iframe(struct q921_link *link, void *buf, int len, int cr)
 {
-	struct q921_frame *f, *prev=NULL;
+	struct q921_frame *f;
 	struct pri *ctrl;
 
 	ctrl = link->ctrl;
@@ -1062,12 +1177,7 @@ int q921_transmit_iframe(struct q921_link *link, void *buf, int len, int cr)
 	case Q921_TIMER_RECOVERY:
 	case Q921_AWAITING_ESTABLISHMENT:
 	case Q921_MULTI_FRAME_ESTABLISHED:
-		/* Find queue tail. */
-		for (f = link->tx_queue; f; f = f->next) {
-			prev = f;
-		}
-
-		f = calloc(1, sizeof(struct q921_frame) + len + 2);
+		f = q921_tx_frame_get(link, len);
 		if (f) {
 			Q921_INIT(&f->h, link->sapi, link->tei);
 			switch (ctrl->localtype) {
@@ -1086,30 +1196,22 @@ int q921_transmit_iframe(struct q921_link *link, void *buf, int len, int cr)
 			}
 
 			/* Put new frame on queue tail. */
-			f->next = NULL;
 			f->status = Q921_TX_FRAME_NEVER_SENT;
 			f->len = len + 4;
 			memcpy(f->h.data, buf, len);
-			if (prev)
-				prev->next = f;
-			else
-				link->tx_queue = f;
+			++link->tx_queue.tail;
 
 			if (link->state != Q921_MULTI_FRAME_ESTABLISHED) {
-				if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
-					pri_message(ctrl,
-						"TEI=%d Just queued I-frame since in state %d(%s)\n",
-						link->tei,
-						link->state, q921_state2str(link->state));
-				}
+				PRI_TRACE(ctrl, PRI_DEBUG_Q921_STATE,
+					"TEI=%d Just queued I-frame since in state %d(%s)\n",
+					link->tei,
+					link->state, q921_state2str(link->state));
 				break;
 			}
 			if (link->peer_rx_busy) {
-				if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
-					pri_message(ctrl,
-						"TEI=%d Just queued I-frame due to peer busy condition\n",
-						link->tei);
-				}
+				PRI_TRACE(ctrl, PRI_DEBUG_Q921_STATE,
+					"TEI=%d Just queued I-frame due to peer busy condition\n",
+					link->tei);
 				break;
 			}
 
@@ -1122,7 +1224,7 @@ int q921_transmit_iframe(struct q921_link *link, void *buf, int len, int cr)
 				 * to flood the debug trace if we are not really looking at the
 				 * Q.921 layer.
 				 */
-				if ((ctrl->debug & (PRI_DEBUG_Q921_STATE | PRI_DEBUG_Q921_DUMP))
+				if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE | PRI_DEBUG_Q921_DUMP)
 					== PRI_DEBUG_Q921_STATE) {
 					pri_message(ctrl, "TEI=%d Just queued I-frame due to window shut\n",
 						link->tei);
@@ -1151,7 +1253,7 @@ static void t203_expire(void *vlink)
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 		pri_message(ctrl, "%s\n", __FUNCTION__);
 
 	link->t203_timer = 0;
@@ -1173,26 +1275,20 @@ static void t203_expire(void *vlink)
 static void q921_dump_iqueue_info(struct q921_link *link)
 {
 	struct pri *ctrl;
-	struct q921_frame *f;
-	int pending = 0;
-	int unacked = 0;
+	int pending;
+	int unacked;
 
 	ctrl = link->ctrl;
 
-	for (f = link->tx_queue; f; f = f->next) {
-		if (f->status == Q921_TX_FRAME_SENT) {
-			unacked++;
-		} else {
-			pending++;
-		}
-	}
+	unacked = link->tx_queue.next - link->tx_queue.head;
+	pending = link->tx_queue.tail - link->tx_queue.next;
 
 	pri_error(ctrl, "Number of pending packets %d, sent but unacked %d\n", pending, unacked);
 }
 
-static void q921_dump_pri_by_h(struct pri *ctrl, char direction_tag, q921_h *h);
+static void q921_dump_pri_by_h(struct pri *ctrl, char direction_tag, const q921_h *h);
 
-void q921_dump(struct pri *ctrl, q921_h *h, int len, int debugflags, int txrx)
+void q921_dump(struct pri *ctrl, const q921_h *h, int len, int debugflags, int txrx)
 {
 	int x;
 	const char *type;
@@ -1332,7 +1428,7 @@ void q921_dump(struct pri *ctrl, q921_h *h, int len, int debugflags, int txrx)
 	
 		if ((h->u.ft == 3) && (h->u.m3 == 0) && (h->u.m2 == 0) && (h->u.data[0] == 0x0f)) {
 			int ri;
-			u_int8_t *action;
+			const u_int8_t *action;
 	
 			/* TEI management related */
 			type = q921_tei_mgmt2str(h->u.data[3]);
@@ -1340,7 +1436,7 @@ void q921_dump(struct pri *ctrl, q921_h *h, int len, int debugflags, int txrx)
 			ri = (h->u.data[1] << 8) | h->u.data[2];
 			pri_message(ctrl, "%c Ri: %d\n", direction_tag, ri);
 			action = &h->u.data[4];
-			for (x = len - (action - (u_int8_t *) h); 0 < x; --x, ++action) {
+			for (x = len - (action - (const u_int8_t *) h); 0 < x; --x, ++action) {
 				pri_message(ctrl, "%c Ai: %d E:%d\n",
 					direction_tag, (*action >> 1) & 0x7f, *action & 0x01);
 			}
@@ -1365,7 +1461,7 @@ static void q921_dump_pri(struct q921_link *link, char direction_tag)
 		direction_tag, link->t200_timer, ctrl->timers[PRI_TIMER_N200], link->t203_timer);
 }
 
-static void q921_dump_pri_by_h(struct pri *ctrl, char direction_tag, q921_h *h)
+static void q921_dump_pri_by_h(struct pri *ctrl, char direction_tag, const q921_h *h)
 {
 	struct q921_link *link;
 
@@ -1472,9 +1568,9 @@ static void q921_tei_check(struct pri *ctrl)
 	t201_expire(ctrl);
 }
 
-static void q921_mdl_ignore(struct pri *ctrl, q921_u *h, const char *reason)
+static void q921_mdl_ignore(struct pri *ctrl, const q921_u *h, const char *reason)
 {
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		/*
 		 * Send out this message in debug modes since it is possible the
 		 * user has misconfigured their link for the wrong mode.
@@ -1484,17 +1580,55 @@ static void q921_mdl_ignore(struct pri *ctrl, q921_u *h, const char *reason)
 	}
 }
 
-static pri_event *q921_mdl_receive(struct pri *ctrl, q921_u *h, int len)
+/*!
+ * \internal
+ * \brief Get the lowest set bit of the free automatic TEI bitmap.
+ *
+ * \param free_teis Free automatic TEI bitmap.  (Not zero)
+ *
+ * \return Bit number of the lowest free TEI.
+ */
+static int q921_tei_free_first(unsigned long long free_teis)
+{
+	int bit;
+
+	bit = 0;
+	if (!(free_teis & 0xffffffffULL)) {
+		free_teis >>= 32;
+		bit += 32;
+	}
+	if (!(free_teis & 0xffff)) {
+		free_teis >>= 16;
+		bit += 16;
+	}
+	if (!(free_teis & 0xff)) {
+		free_teis >>= 8;
+		bit += 8;
+	}
+	if (!(free_teis & 0xf)) {
+		free_teis >>= 4;
+		bit += 4;
+	}
+	if (!(free_teis & 0x3)) {
+		free_teis >>= 2;
+		bit += 2;
+	}
+	if (!(free_teis & 0x1)) {
+		bit += 1;
+	}
+	return bit;
+}
+
+static pri_event *q921_mdl_receive(struct pri *ctrl, const q921_u *h, int len)
 {
 	int ri;
 	struct q921_link *sub;
 	struct q921_link *link;
 	pri_event *res = NULL;
-	u_int8_t *action;
-	int count;
+	const u_int8_t *action;
 	int tei;
 
-	if (len <= &h->data[0] - (u_int8_t *) h) {
+	if (len <= &h->data[0] - (const u_int8_t *) h) {
 		pri_error(ctrl, "Received short MDL frame\n");
 		return NULL;
 	}
@@ -1503,7 +1637,7 @@ static pri_event *q921_mdl_receive(struct pri *ctrl, q921_u *h, int len)
 			h->data[0]);
 		return NULL;
 	}
-	if (len <= &h->data[4] - (u_int8_t *) h) {
+	if (len <= &h->data[4] - (const u_int8_t *) h) {
 		pri_error(ctrl, "Received short MDL message\n");
 		return NULL;
 	}
@@ -1513,7 +1647,7 @@ static pri_event *q921_mdl_receive(struct pri *ctrl, q921_u *h, int len)
 			h->data[3], q921_tei_mgmt2str(h->data[3]));
 		return NULL;
 	}
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "Received MDL message: %d(%s)\n",
 			h->data[3], q921_tei_mgmt2str(h->data[3]));
 	}
@@ -1543,24 +1677,15 @@ static pri_event *q921_mdl_receive(struct pri *ctrl, q921_u *h, int len)
 		}
 
 		/* Find a TEI that is not allocated. */
-		tei = Q921_TEI_AUTO_FIRST;
-		do {
-			for (sub = &ctrl->link; sub->next; sub = sub->next) {
-				if (sub->next->tei == tei) {
-					/* This TEI is already assigned, try next one. */
-					++tei;
-					if (tei <= Q921_TEI_AUTO_LAST) {
-						break;
-					}
-					pri_error(ctrl, "TEI pool exhausted.  Reclaiming dead TEIs.\n");
-					q921_mdl_send(ctrl, Q921_TEI_IDENTITY_DENIED, ri, Q921_TEI_GROUP, 1);
-					q921_tei_check(ctrl);
-					return NULL;
-				}
-			}
-		} while (sub->next);
+		if (!ctrl->tei_free) {
+			pri_error(ctrl, "TEI pool exhausted.  Reclaiming dead TEIs.\n");
+			q921_mdl_send(ctrl, Q921_TEI_IDENTITY_DENIED, ri, Q921_TEI_GROUP, 1);
+			q921_tei_check(ctrl);
+			return NULL;
+		}
+		tei = Q921_TEI_AUTO_FIRST + q921_tei_free_first(ctrl->tei_free);
 
-		if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 			pri_message(ctrl, "Allocating new TEI %d\n", tei);
 		}
 		link = pri_link_new(ctrl, Q921_SAPI_CALL_CTRL, tei);
@@ -1568,20 +1693,19 @@ static pri_event *q921_mdl_receive(struct pri *ctrl, q921_u *h, int len)
 			pri_error(ctrl, "Unable to allocate layer 2 link for new TEI %d\n", tei);
 			return NULL;
 		}
+		/* Append to the list end so links stay in assignment order. */
+		for (sub = &ctrl->link; sub->next; sub = sub->next) {
+		}
 		sub->next = link;
 		q921_setstate(link, Q921_TEI_ASSIGNED);
 		q921_mdl_send(ctrl, Q921_TEI_IDENTITY_ASSIGNED, ri, tei, 1);
 
-		count = 0;
-		for (sub = ctrl->link.next; sub; sub = sub->next) {
-			++count;
-		}
-		if (Q921_TEI_AUTO_LAST - Q921_TEI_AUTO_FIRST + 1 <= count) {
+		if (!ctrl->tei_free) {
 			/*
 			 * We just allocated the last TEI.  Try to reclaim dead TEIs
 			 * before another is requested.
 			 */
-			if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 				pri_message(ctrl, "Allocated last TEI.  Reclaiming dead TEIs.\n");
 			}
 			q921_tei_check(ctrl);
@@ -1604,7 +1728,7 @@ static pri_event *q921_mdl_receive(struct pri *ctrl, q921_u *h, int len)
 
 		/* For each TEI listed in the message */
 		action = &h->data[4];
-		len -= (action - (u_int8_t *) h);
+		len -= (action - (const u_int8_t *) h);
 		for (; len; --len, ++action) {
 			if (*action & 0x01) {
 				/* This is the last TEI in the list because the Ai E bit is set. */
@@ -1618,29 +1742,25 @@ static pri_event *q921_mdl_receive(struct pri *ctrl, q921_u *h, int len)
 				continue;
 			}
 
-			for (sub = ctrl->link.next; sub; sub = sub->next) {
-				if (sub->tei == tei) {
-					/* Found the TEI. */
-					switch (sub->tei_check) {
-					case Q921_TEI_CHECK_NONE:
-						break;
-					case Q921_TEI_CHECK_DEAD:
-					case Q921_TEI_CHECK_DEAD_REPLY:
-						sub->tei_check = Q921_TEI_CHECK_REPLY;
-						break;
-					case Q921_TEI_CHECK_REPLY:
-						/* Duplicate TEI detected. */
-						sub->tei_check = Q921_TEI_CHECK_NONE;
-						q921_tei_remove(ctrl, tei);
-						q921_mdl_destroy(sub);
-						break;
-					}
-					break;
-				}
-			}
+			sub = ctrl->tei_link[tei];
 			if (!sub) {
 				/* TEI not found. */
 				q921_tei_remove(ctrl, tei);
+				continue;
+			}
+			switch (sub->tei_check) {
+			case Q921_TEI_CHECK_NONE:
+				break;
+			case Q921_TEI_CHECK_DEAD:
+			case Q921_TEI_CHECK_DEAD_REPLY:
+				sub->tei_check = Q921_TEI_CHECK_REPLY;
+				break;
+			case Q921_TEI_CHECK_REPLY:
+				/* Duplicate TEI detected. */
+				sub->tei_check = Q921_TEI_CHECK_NONE;
+				q921_tei_remove(ctrl, tei);
+				q921_mdl_destroy(sub);
+				break;
 			}
 		}
 		break;
@@ -1703,7 +1823,7 @@ static pri_event *q921_mdl_receive(struct pri *ctrl, q921_u *h, int len)
 		}
 
 		if (ri != link->ri) {
-			if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 				pri_message(ctrl,
 					"TEI assignment received for another Ri %02x (ours is %02x)\n",
 					ri, link->ri);
@@ -1714,8 +1834,10 @@ static pri_event *q921_mdl_receive(struct pri *ctrl, q921_u *h, int len)
 		pri_schedule_del(ctrl, link->t202_timer);
 		link->t202_timer = 0;
 
+		pri_link_tei_del(link);
 		link->tei = tei;
-		if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+		pri_link_tei_add(link);
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 			pri_message(ctrl, "Got assigned TEI %d\n", tei);
 		}
 
@@ -1803,7 +1925,7 @@ static pri_event *q921_mdl_receive(struct pri *ctrl, q921_u *h, int len)
 	return res;	/* Do we need to return something??? */
 }
 
-static int is_command(struct pri *ctrl, q921_h *h)
+static int is_command(struct pri *ctrl, const q921_h *h)
 {
 	int command = 0;
 	int c_r = h->s.h.c_r;
@@ -1823,7 +1945,7 @@ static void q921_clear_exception_conditions(struct q921_link *link)
 	link->acknowledge_pending = 0;
 }
 
-static pri_event *q921_sabme_rx(struct q921_link *link, q921_h *h)
+static pri_event *q921_sabme_rx(struct q921_link *link, const q921_h *h)
 {
 	pri_event *res = NULL;
 	struct pri *ctrl;
@@ -1888,14 +2010,14 @@ static pri_event *q921_sabme_rx(struct q921_link *link, q921_h *h)
 	return res;
 }
 
-static pri_event *q921_disc_rx(struct q921_link *link, q921_h *h)
+static pri_event *q921_disc_rx(struct q921_link *link, const q921_h *h)
 {
 	pri_event *res = NULL;
 	struct pri *ctrl;
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Got DISC\n", link->tei);
 	}
 
@@ -1935,7 +2057,7 @@ static void q921_mdl_remove(struct q921_link *link)
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "MDL-REMOVE: Removing TEI %d\n", link->tei);
 	}
 	if (BRI_NT_PTMP(ctrl)) {
@@ -1998,6 +2120,7 @@ static void q921_mdl_remove(struct q921_link *link)
 	 * Negate the TEI value so debug messages will display a
 	 * negated TEI when it is actually unassigned.
 	 */
+	pri_link_tei_del(link);
 	link->tei = -link->tei;
 
 	link->mdl_free_me = mdl_free_me;
@@ -2024,7 +2147,7 @@ static void q921_mdl_link_destroy(struct q921_link *link)
 		return;
 	}
 
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "Freeing TEI of %d\n", -freep->tei);
 	}
 
@@ -2164,7 +2287,7 @@ static void q921_mdl_error(struct q921_link *link, char error)
 	ctrl = link->ctrl;
 
 	/* Log the MDL-ERROR event when detected. */
-	is_debug_q921_state = (ctrl->debug & PRI_DEBUG_Q921_STATE);
+	is_debug_q921_state = (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE));
 	switch (error) {
 	case 'A':
 		pri_message(ctrl,
@@ -2262,7 +2385,7 @@ static void q921_mdl_error(struct q921_link *link, char error)
 	}
 }
 
-static pri_event *q921_ua_rx(struct q921_link *link, q921_h *h)
+static pri_event *q921_ua_rx(struct q921_link *link, const q921_h *h)
 {
 	struct pri *ctrl;
 	pri_event *res = NULL;
@@ -2270,7 +2393,7 @@ static pri_event *q921_ua_rx(struct q921_link *link, q921_h *h)
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Got UA\n", link->tei);
 	}
 
@@ -2373,7 +2496,7 @@ static void update_v_a(struct q921_link *link, int n_r)
 	ctrl = link->ctrl;
 
 	/* Cancel each packet as necessary */
-	if (ctrl->debug & PRI_DEBUG_Q921_DUMP)
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP))
 		pri_message(ctrl, "-- Got ACK for N(S)=%d to (but not including) N(S)=%d\n", link->v_a, n_r);
 	for (x = link->v_a; x != n_r; Q921_INC(x)) {
 		idealcnt++;
@@ -2403,7 +2526,7 @@ static int n_r_is_valid(struct q921_link *link, int n_r)
 
 static int q921_invoke_retransmission(struct q921_link *link, int n_r);
 
-static pri_event *timer_recovery_rr_rej_rx(struct q921_link *link, q921_h *h)
+static pri_event *timer_recovery_rr_rej_rx(struct q921_link *link, const q921_h *h)
 {
 	struct pri *ctrl;
 
@@ -2448,7 +2571,7 @@ n_r_error_out:
 	return NULL;
 }
 
-static pri_event *q921_rr_rx(struct q921_link *link, q921_h *h)
+static pri_event *q921_rr_rx(struct q921_link *link, const q921_h *h)
 {
 	pri_event *res = NULL;
 	struct pri *ctrl;
@@ -2456,7 +2579,7 @@ static pri_event *q921_rr_rx(struct q921_link *link, q921_h *h)
 	ctrl = link->ctrl;
 
 #if 0	/* Don't flood debug trace with RR if not really looking at Q.921 layer. */
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Got RR N(R)=%d\n", link->tei, h->s.n_r);
 	}
 #endif
@@ -2518,6 +2641,7 @@ static int q921_invoke_retransmission(struct q921_link *link, int n_r)
 {
 	struct q921_frame *f;
 	struct pri *ctrl;
+	unsigned seq;
 
 	ctrl = link->ctrl;
 
@@ -2525,7 +2649,8 @@ static int q921_invoke_retransmission(struct q921_link *link, int n_r)
 	 * All acked frames should already have been removed from the queue.
 	 * Push back all sent frames.
 	 */
-	for (f = link->tx_queue; f && f->status == Q921_TX_FRAME_SENT; f = f->next) {
+	for (seq = link->tx_queue.head; seq != link->tx_queue.next; ++seq) {
+		f = q921_tx_frame(link, seq);
 		f->status = Q921_TX_FRAME_PUSHED_BACK;
 
 		/* Sanity check: Is V(A) <= N(S) <= V(S)? */
@@ -2535,18 +2660,20 @@ static int q921_invoke_retransmission(struct q921_link *link, int n_r)
 				f->h.n_s, link->v_a, link->v_s);
 		}
 	}
+	link->tx_queue.next = link->tx_queue.head;
 	link->v_s = n_r;
 	return q921_send_queued_iframes(link);
 }
 
-static pri_event *q921_rej_rx(struct q921_link *link, q921_h *h)
+static pri_event *q921_rej_rx(struct q921_link *link, const q921_h *h)
 {
 	pri_event *res = NULL;
 	struct pri *ctrl;
 
 	ctrl = link->ctrl;
+	++ctrl->stats.rej_rx;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Got REJ N(R)=%d\n", link->tei, h->s.n_r);
 	}
 
@@ -2596,14 +2723,14 @@ static pri_event *q921_rej_rx(struct q921_link *link, q921_h *h)
 	return res;
 }
 
-static pri_event *q921_frmr_rx(struct q921_link *link, q921_h *h)
+static pri_event *q921_frmr_rx(struct q921_link *link, const q921_h *h)
 {
 	pri_event *res = NULL;
 	struct pri *ctrl;
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Got FRMR\n", link->tei);
 	}
 
@@ -2626,7 +2753,7 @@ static pri_event *q921_frmr_rx(struct q921_link *link, q921_h *h)
 		 * Ignore this frame.
 		 * We likely got reset and the other end has not realized it yet.
 		 */
-		if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 			pri_message(ctrl, "TEI=%d Ignoring FRMR.\n", link->tei);
 		}
 		break;
@@ -2639,7 +2766,7 @@ static pri_event *q921_frmr_rx(struct q921_link *link, q921_h *h)
 	return res;
 }
 
-static pri_event *q921_iframe_rx(struct q921_link *link, q921_h *h, int len)
+static pri_event *q921_iframe_rx(struct q921_link *link, const q921_h *h, int len)
 {
 	struct pri *ctrl;
 	pri_event *eres = NULL;
@@ -2664,8 +2791,8 @@ static pri_event *q921_iframe_rx(struct q921_link *link, q921_h *h, int len)
 			 * Dump Q.931 message where Q.921 says to queue it to Q.931 so if
 			 * Q.921 is dumping its frames they will be in the correct order.
 			 */
-			if (ctrl->debug & PRI_DEBUG_Q931_DUMP) {
-				q931_dump(ctrl, h->h.tei, (q931_h *) h->i.data, len - 4, 0);
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_DUMP)) {
+				q931_dump(ctrl, h->h.tei, (const q931_h *) h->i.data, len - 4, 0);
 			}
 			delay_q931_receive = 1;
 
@@ -2713,7 +2840,7 @@ static pri_event *q921_iframe_rx(struct q921_link *link, q921_h *h, int len)
 		}
 		if (delay_q931_receive) {
 			/* Q.921 has finished processing the frame so we can give it to Q.931 now. */
-			res = q931_receive(link, (q931_h *) h->i.data, len - 4);
+			res = q931_receive(link, (const q931_h *) h->i.data, len - 4);
 			if (res != -1 && (res & Q931_RES_HAVEEVENT)) {
 				eres = &ctrl->ev;
 			}
@@ -2736,14 +2863,14 @@ static pri_event *q921_iframe_rx(struct q921_link *link, q921_h *h, int len)
 	return eres;
 }
 
-static pri_event *q921_dm_rx(struct q921_link *link, q921_h *h)
+static pri_event *q921_dm_rx(struct q921_link *link, const q921_h *h)
 {
 	pri_event *res = NULL;
 	struct pri *ctrl;
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Got DM\n", link->tei);
 	}
 
@@ -2815,14 +2942,14 @@ static pri_event *q921_dm_rx(struct q921_link *link, q921_h *h)
 	return res;
 }
 
-static pri_event *q921_rnr_rx(struct q921_link *link, q921_h *h)
+static pri_event *q921_rnr_rx(struct q921_link *link, const q921_h *h)
 {
 	pri_event *res = NULL;
 	struct pri *ctrl;
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl, "TEI=%d Got RNR N(R)=%d\n", link->tei, h->s.n_r);
 	}
 
@@ -2928,7 +3055,7 @@ static void q921_statemachine_check(struct q921_link *link)
 	}
 }
 
-static pri_event *__q921_receive_qualified(struct q921_link *link, q921_h *h, int len)
+static pri_event *__q921_receive_qualified(struct q921_link *link, const q921_h *h, int len)
 {
 	int res;
 	pri_event *ev = NULL;
@@ -2970,10 +3097,10 @@ static pri_event *__q921_receive_qualified(struct q921_link *link, q921_h *h, in
 			break;
 		case 0x00:
 			/* UI-frame */
-			if (ctrl->debug & PRI_DEBUG_Q931_DUMP) {
-				q931_dump(ctrl, h->h.tei, (q931_h *) h->u.data, len - 3, 0);
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_DUMP)) {
+				q931_dump(ctrl, h->h.tei, (const q931_h *) h->u.data, len - 3, 0);
 			}
-			res = q931_receive(link, (q931_h *) h->u.data, len - 3);
+			res = q931_receive(link, (const q931_h *) h->u.data, len - 3);
 			if (res != -1 && (res & Q931_RES_HAVEEVENT)) {
 				ev = &ctrl->ev;
 			}
@@ -2983,10 +3110,8 @@ static pri_event *__q921_receive_qualified(struct q921_link *link, q921_h *h, in
 			break;
 		case 0x0F:
 			/* SABME */
-			if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
-				pri_message(ctrl, "TEI=%d Got SABME from %s peer.\n",
-					link->tei, h->h.c_r ? "network" : "cpe");
-			}
+			PRI_TRACE(ctrl, PRI_DEBUG_Q921_STATE, "TEI=%d Got SABME from %s peer.\n",
+				link->tei, h->h.c_r ? "network" : "cpe");
 			if (h->h.c_r) {
 				ctrl->remotetype = PRI_NETWORK;
 				if (ctrl->localtype == PRI_NETWORK) {
@@ -3026,28 +3151,28 @@ static pri_event *__q921_receive_qualified(struct q921_link *link, q921_h *h, in
 	return ev;
 }
 
-static pri_event *q921_handle_unmatched_frame(struct pri *ctrl, q921_h *h, int len)
+static pri_event *q921_handle_unmatched_frame(struct pri *ctrl, const q921_h *h, int len)
 {
 	if (!BRI_NT_PTMP(ctrl)) {
 		return NULL;
 	}
 
 	if (h->h.tei < Q921_TEI_AUTO_FIRST) {
-		if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 			pri_message(ctrl, "Manual TEI range is not supported in NT-PTMP mode. Discarding\n");
 		}
 		return NULL;
 	}
 
 	if (h->h.sapi != Q921_SAPI_CALL_CTRL) {
-		if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 			pri_message(ctrl, "Message with SAPI other than CALL CTRL is discarded\n");
 		}
 		return NULL;
 	}
 
 	/* This means an unrecognized TEI that we'll kill */
-	if (ctrl->debug & PRI_DEBUG_Q921_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_STATE)) {
 		pri_message(ctrl,
 			"Could not find a layer 2 link for received frame with SAPI/TEI of %d/%d.\n",
 			h->h.sapi, h->h.tei);
@@ -3059,15 +3184,21 @@ static pri_event *q921_handle_unmatched_frame(struct pri *ctrl, q921_h *h, int l
 }
 
 /* This code assumes that the pri structure is the master pri */
-static pri_event *__q921_receive(struct pri *ctrl, q921_h *h, int len)
+static pri_event *__q921_receive(struct pri *ctrl, const q921_h *h, int len)
 {
 	pri_event *ev = NULL;
 	struct q921_link *link;
 
 	/* Discard FCS */
 	len -= 2;
-	
-	if (ctrl->debug & (PRI_DEBUG_Q921_DUMP | PRI_DEBUG_Q921_RAW)) {
+
+	if (ctrl->trace_ring) {
+		pri_trace_frame(ctrl, h, len, 0);
+	}
+	if (ctrl->pcap) {
+		pri_pcap_frame(ctrl, h, len, 0);
+	}
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP | PRI_DEBUG_Q921_RAW)) {
 		q921_dump(ctrl, h, len, ctrl->debug, 0);
 	}
 
@@ -3110,14 +3241,12 @@ static pri_event *__q921_receive(struct pri *ctrl, q921_h *h, int len)
 		ev = NULL;
 	}
 
-	if (ctrl->debug & PRI_DEBUG_Q921_DUMP) {
-		pri_message(ctrl, "Done handling message for SAPI/TEI=%d/%d\n", h->h.sapi, h->h.tei);
-	}
+	PRI_TRACE(ctrl, PRI_DEBUG_Q921_DUMP, "Done handling message for SAPI/TEI=%d/%d\n", h->h.sapi, h->h.tei);
 
 	return ev;
 }
 
-pri_event *q921_receive(struct pri *ctrl, q921_h *h, int len)
+pri_event *q921_receive(struct pri *ctrl, const q921_h *h, int len)
 {
 	pri_event *e;
 	e = __q921_receive(ctrl, h, len);
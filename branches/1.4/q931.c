@@ -39,6 +39,7 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <limits.h>
+#include <pthread.h>
 
 enum mandatory_ie_status {
 	MAND_STATUS_OK,
@@ -113,8 +114,8 @@ static struct msgtype msgs[] = {
 	{ Q931_ANY_MESSAGE, "ANY MESSAGE" },
 };
 
-static int post_handle_q931_message(struct pri *ctrl, struct q931_mh *mh, struct q931_call *c, enum mandatory_ie_status mand_status);
-static void nt_ptmp_handle_q931_message(struct pri *ctrl, struct q931_mh *mh, struct q931_call *c, int *allow_event, int *allow_posthandle);
+static int post_handle_q931_message(struct pri *ctrl, const struct q931_mh *mh, struct q931_call *c, enum mandatory_ie_status mand_status);
+static void nt_ptmp_handle_q931_message(struct pri *ctrl, const struct q931_mh *mh, struct q931_call *c, int *allow_event, int *allow_posthandle);
 
 struct msgtype att_maintenance_msgs[] = {
 	{ ATT_SERVICE, "SERVICE", { Q931_CHANNEL_IDENT } },
@@ -125,7 +126,7 @@ struct msgtype national_maintenance_msgs[] = {
 	{ NATIONAL_SERVICE, "SERVICE", { Q931_CHANNEL_IDENT } },
 	{ NATIONAL_SERVICE_ACKNOWLEDGE, "SERVICE ACKNOWLEDGE", { Q931_CHANNEL_IDENT } },
 };
-static int post_handle_maintenance_message(struct pri *ctrl, int protodisc, struct q931_mh *mh, struct q931_call *c);
+static int post_handle_maintenance_message(struct pri *ctrl, int protodisc, const struct q931_mh *mh, struct q931_call *c);
 
 static struct msgtype causes[] = {
 	{ PRI_CAUSE_UNALLOCATED, "Unallocated (unassigned) number" },
@@ -249,23 +250,27 @@ static struct msgtype facilities[] = {
 #define LOC_NETWORK_BEYOND_INTERWORKING	0xa
 
 static char *ie2str(int ie);
+static int q931_call_index_has(struct pri *ctrl, const struct q931_call *call);
 
 
-#define FUNC_DUMP(name) void (name)(int full_ie, struct pri *pri, q931_ie *ie, int len, char prefix)
-#define FUNC_RECV(name) int (name)(int full_ie, struct pri *pri, q931_call *call, int msgtype, q931_ie *ie, int len)
+#define FUNC_DUMP(name) void (name)(int full_ie, struct pri *pri, const q931_ie *ie, int len, char prefix)
+#define FUNC_RECV(name) int (name)(int full_ie, struct pri *pri, q931_call *call, int msgtype, const q931_ie *ie, int len)
 #define FUNC_SEND(name) int (name)(int full_ie, struct pri *pri, q931_call *call, int msgtype, q931_ie *ie, int len, int order)
 
 #if 1
 /* Update call state with transition trace. */
 #define UPDATE_OURCALLSTATE(ctrl, call, newstate) \
 	do { \
-		if (((ctrl)->debug & PRI_DEBUG_Q931_STATE) && (call)->ourcallstate != (newstate)) { \
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE) && (call)->ourcallstate != (newstate)) { \
 			pri_message((ctrl), \
 				DBGHEAD "%s %d enters state %d (%s).  Hold state: %s\n", \
 				DBGINFO, ((call) == (call)->master_call) ? "Call" : "Subcall", \
 				(call)->cr, (newstate), q931_call_state_str(newstate), \
 				q931_hold_state_str((call)->master_call->hold_state)); \
 		} \
+		if ((ctrl)->trace_ring && (call)->ourcallstate != (newstate)) { \
+			pri_trace_call_state((ctrl), (call)->cr, (call)->ourcallstate, (newstate)); \
+		} \
 		(call)->ourcallstate = (newstate); \
 	} while (0)
 #else
@@ -277,7 +282,7 @@ static char *ie2str(int ie);
 /* Update hold state with transition trace. */
 #define UPDATE_HOLD_STATE(ctrl, master_call, newstate) \
 	do { \
-		if (((ctrl)->debug & PRI_DEBUG_Q931_STATE) \
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE) \
 			&& (master_call)->hold_state != (newstate)) { \
 			pri_message((ctrl), \
 				DBGHEAD "Call %d in state %d (%s) enters Hold state: %s\n", \
@@ -354,9 +359,7 @@ static int q931_encode_channel(const q931_call *call)
  */
 int q931_is_call_valid(struct pri *ctrl, struct q931_call *call)
 {
-	struct q931_call *cur;
 	struct q921_link *link;
-	int idx;
 
 	if (!call) {
 		return 0;
@@ -371,21 +374,10 @@ int q931_is_call_valid(struct pri *ctrl, struct q931_call *call)
 		ctrl = call->pri;
 	}
 
-	/* Check real call records. */
-	for (cur = *ctrl->callpool; cur; cur = cur->next) {
-		if (call == cur) {
-			/* Found it. */
-			return 1;
-		}
-		if (cur->outboundbroadcast) {
-			/* Check subcalls for call ptr. */
-			for (idx = 0; idx < ARRAY_LEN(cur->subcalls); ++idx) {
-				if (call == cur->subcalls[idx]) {
-					/* Found it. */
-					return 1;
-				}
-			}
-		}
+	/* Check real call records and their subcalls. */
+	if (q931_call_index_has(ctrl, call)) {
+		/* Found it. */
+		return 1;
 	}
 
 	/* Check dummy call records. */
@@ -1056,7 +1048,7 @@ static int q931_strget_gripe(struct pri *ctrl, const char *ie_name, unsigned cha
 	saw_nul = q931_strget(dst, dst_size, src, src_len);
 	if (saw_nul
 #if !defined(UNCONDITIONALLY_REPORT_REMOVED_NUL_OCTETS)
-		&& (ctrl->debug & PRI_DEBUG_Q931_STATE)
+		&& (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE))
 #endif
 		) {
 		pri_message(ctrl, "!! Removed nul octets from IE '%s' and returning '%s'.\n",
@@ -1211,7 +1203,7 @@ struct q931_call *q931_find_winning_call(struct q931_call *call)
  *
  * \return Nothing
  */
-static void q931_append_ie_contents(struct q931_saved_ie_contents *save_ie, struct q931_ie *ie)
+static void q931_append_ie_contents(struct q931_saved_ie_contents *save_ie, const struct q931_ie *ie)
 {
 	int size;
 
@@ -1261,10 +1253,9 @@ static char *pritype(int type)
 	}
 }
 
-static char *binary(int b, int len) {
-	static char res[33];
+static char *binary(char res[33], int b, int len) {
 	int x;
-	memset(res, 0, sizeof(res));
+	memset(res, 0, 33);
 	if (len > 32)
 		len = 32;
 	for (x=1;x<=len;x++)
@@ -1272,7 +1263,7 @@ static char *binary(int b, int len) {
 	return res;
 }
 
-static int receive_channel_id(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_channel_id(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {	
 	int x;
 	int pos = 0;
@@ -1560,11 +1551,12 @@ static int transmit_channel_id(int full_ie, struct pri *ctrl, q931_call *call, i
 	return pos + 2;
 }
 
-static void dump_channel_id(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_channel_id(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	int pos;
 	int x;
 	int res;
+	char map[33];
 
 	static const char *msg_chan_sel[] = {
 		"No channel selected", "B1 channel", "B2 channel", "Any channel selected",
@@ -1632,7 +1624,7 @@ static void dump_channel_id(int full_ie, struct pri *ctrl, q931_ie *ie, int len,
 				++x;
 			} while (pos < len);
 			pri_message(ctrl, "%c                       Map len: %d  Map: %s ]\n", prefix,
-				x, binary(res, x << 3));
+				x, binary(map, res, x << 3));
 		}
 	} else {
 		pri_message(ctrl, "%c                     ]\n", prefix);
@@ -1649,14 +1641,14 @@ static char *ri2str(int ri)
 	return code2str(ri, ris, sizeof(ris) / sizeof(ris[0]));
 }
 
-static void dump_restart_indicator(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_restart_indicator(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%2d) [ Ext: %d  Spare: %d  Resetting %s (%d) ]\n",
 		prefix, ie2str(full_ie), len, (ie->data[0] & 0x80) >> 7,
 		(ie->data[0] & 0x78) >> 3, ri2str(ie->data[0] & 0x7), ie->data[0] & 0x7);
 }
 
-static int receive_restart_indicator(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_restart_indicator(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	/* Pretty simple */
 	call->ri = ie->data[0] & 0x7;
@@ -1775,7 +1767,7 @@ static char *int_rate2str(int proto)
     return code2str(proto, protos, sizeof(protos) / sizeof(protos[0]));
 }
 
-static void dump_bearer_capability(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_bearer_capability(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	int pos=2;
 	pri_message(ctrl,
@@ -1909,7 +1901,7 @@ static void dump_bearer_capability(int full_ie, struct pri *ctrl, q931_ie *ie, i
 	}
 }
 
-static int receive_bearer_capability(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_bearer_capability(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	int pos = 2;
 
@@ -2144,7 +2136,7 @@ char *pri_pres2str(int pres)
 	return code2str(pres, press, sizeof(press) / sizeof(press[0]));
 }
 
-static void q931_get_subaddr_specific(unsigned char *num, int maxlen, unsigned char *src, int len, char oddflag)
+static void q931_get_subaddr_specific(unsigned char *num, int maxlen, const unsigned char *src, int len, char oddflag)
 {
 	/* User Specified */
 	int x;
@@ -2194,7 +2186,7 @@ static int transmit_subaddr_helper(int full_ie, struct pri *ctrl, struct q931_pa
 	return datalen + (offset + 2);
 }
 
-static int receive_subaddr_helper(int full_ie, struct pri *ctrl, struct q931_party_subaddress *q931_subaddress, int msgtype, q931_ie *ie, int offset, int len)
+static int receive_subaddr_helper(int full_ie, struct pri *ctrl, struct q931_party_subaddress *q931_subaddress, int msgtype, const q931_ie *ie, int offset, int len)
 {
 	if (len <= 0) {
 		return -1;
@@ -2211,7 +2203,7 @@ static int receive_subaddr_helper(int full_ie, struct pri *ctrl, struct q931_par
 	return 0;
 }
 
-static void dump_subaddr_helper(int full_ie, struct pri *ctrl, q931_ie *ie, int offset, int len, int datalen, char prefix)
+static void dump_subaddr_helper(int full_ie, struct pri *ctrl, const q931_ie *ie, int offset, int len, int datalen, char prefix)
 {
 	unsigned char cnum[256];
 
@@ -2231,7 +2223,7 @@ static void dump_subaddr_helper(int full_ie, struct pri *ctrl, q931_ie *ie, int
 		(ie->data[0] & 0x08) >> 3, cnum);
 }
 
-static void dump_called_party_number(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_called_party_number(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	unsigned char cnum[256];
 
@@ -2242,12 +2234,12 @@ static void dump_called_party_number(int full_ie, struct pri *ctrl, q931_ie *ie,
 		npi2str(ie->data[0] & 0x0f), ie->data[0] & 0x0f, cnum);
 }
 
-static void dump_called_party_subaddr(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_called_party_subaddr(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	dump_subaddr_helper(full_ie, ctrl, ie, 1, len, len - 3, prefix);
 }
 
-static void dump_calling_party_number(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_calling_party_number(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	unsigned char cnum[256];
 
@@ -2269,19 +2261,19 @@ static void dump_calling_party_number(int full_ie, struct pri *ctrl, q931_ie *ie
 	}
 }
 
-static void dump_calling_party_subaddr(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_calling_party_subaddr(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	dump_subaddr_helper(full_ie, ctrl, ie, 1, len, len - 3, prefix);
 }
 
-static void dump_calling_party_category(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_calling_party_category(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%2d) [ Ext: %d  Cat: %s (%d) ]\n",
 		prefix, ie2str(full_ie), len, ie->data[0] >> 7,
 		cpc2str(ie->data[0] & 0x0F), ie->data[0] & 0x0F);
 }
 
-static void dump_redirecting_number(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_redirecting_number(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	unsigned char cnum[256];
 	int i = 0;
@@ -2311,7 +2303,7 @@ static void dump_redirecting_number(int full_ie, struct pri *ctrl, q931_ie *ie,
 	pri_message(ctrl, "  '%s' ]\n", cnum);
 }
 
-static void dump_redirection_number(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_redirection_number(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	unsigned char cnum[256];
 	int i = 0;
@@ -2336,7 +2328,7 @@ static void dump_redirection_number(int full_ie, struct pri *ctrl, q931_ie *ie,
 	pri_message(ctrl, "  '%s' ]\n", cnum);
 }
 
-static int receive_connected_number(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_connected_number(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	int i = 0;
 
@@ -2379,7 +2371,7 @@ static int transmit_connected_number(int full_ie, struct pri *ctrl, q931_call *c
 	return datalen + (2 + 2);
 }
 
-static void dump_connected_number(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_connected_number(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	unsigned char cnum[256];
 	int i = 0;
@@ -2404,7 +2396,7 @@ static void dump_connected_number(int full_ie, struct pri *ctrl, q931_ie *ie, in
 	pri_message(ctrl, "  '%s' ]\n", cnum);
 }
 
-static int receive_connected_subaddr(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_connected_subaddr(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	if (len < 3) {
 		return -1;
@@ -2420,12 +2412,12 @@ static int transmit_connected_subaddr(int full_ie, struct pri *ctrl, q931_call *
 		1, len, order);
 }
 
-static void dump_connected_subaddr(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_connected_subaddr(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	dump_subaddr_helper(full_ie, ctrl, ie, 1, len, len - 3, prefix);
 }
 
-static int receive_redirecting_number(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_redirecting_number(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	int i = 0;
 
@@ -2498,12 +2490,12 @@ static int transmit_redirecting_number(int full_ie, struct pri *ctrl, q931_call
 	return datalen + (3 + 2);
 }
 
-static void dump_redirecting_subaddr(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_redirecting_subaddr(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	dump_subaddr_helper(full_ie, ctrl, ie, 2, len, len - 4, prefix);
 }
 
-static int receive_redirection_number(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_redirection_number(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	int i = 0;
 
@@ -2548,7 +2540,7 @@ static int transmit_redirection_number(int full_ie, struct pri *ctrl, q931_call
 	return datalen + (2 + 2);
 }
 
-static int receive_calling_party_subaddr(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_calling_party_subaddr(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	if (len < 3) {
 		return -1;
@@ -2564,7 +2556,7 @@ static int transmit_calling_party_subaddr(int full_ie, struct pri *ctrl, q931_ca
 		1, len, order);
 }
 
-static int receive_called_party_subaddr(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_called_party_subaddr(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	if (len < 3) {
 		return -1;
@@ -2579,7 +2571,7 @@ static int transmit_called_party_subaddr(int full_ie, struct pri *ctrl, q931_cal
 		1, len, order);
 }
 
-static int receive_called_party_number(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_called_party_number(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	size_t called_len;
 	size_t max_len;
@@ -2616,7 +2608,7 @@ static int receive_called_party_number(int full_ie, struct pri *ctrl, q931_call
 			} else {
 				called_len = len - 3;
 			}
-			strncat(called_end, (char *) ie->data + 1, called_len);
+			strncat(called_end, (const char *) ie->data + 1, called_len);
 		}
 		break;
 	default:
@@ -2645,7 +2637,7 @@ static int transmit_called_party_number(int full_ie, struct pri *ctrl, q931_call
 	return datalen + (1 + 2);
 }
 
-static int receive_calling_party_number(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_calling_party_number(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	int i = 0;
 	struct q931_party_number number;
@@ -2702,7 +2694,7 @@ static int transmit_calling_party_number(int full_ie, struct pri *ctrl, q931_cal
 	return datalen + (2 + 2);
 }
 
-static void dump_user_user(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_user_user(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	int x;
 
@@ -2714,7 +2706,7 @@ static void dump_user_user(int full_ie, struct pri *ctrl, q931_ie *ie, int len,
 }
 
 
-static int receive_user_user(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_user_user(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	call->useruserprotocoldisc = ie->data[0] & 0xff;
 	if (call->useruserprotocoldisc == 4) { /* IA5 */
@@ -2744,7 +2736,7 @@ static int transmit_user_user(int full_ie, struct pri *ctrl, q931_call *call, in
 	return 0;
 }
 
-static void dump_change_status(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_change_status(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	int x;
 
@@ -2768,7 +2760,7 @@ static void dump_change_status(int full_ie, struct pri *ctrl, q931_ie *ie, int l
 	}
 }
 
-static int receive_change_status(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_change_status(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	switch (ctrl->switchtype) {
 	case PRI_SWITCH_NI2:
@@ -2832,7 +2824,7 @@ static char *loc2str(int loc)
 	return code2str(loc, locs, sizeof(locs) / sizeof(locs[0]));
 }
 
-static void dump_progress_indicator(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_progress_indicator(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl,
 		"%c %s (len=%2d) [ Ext: %d  Coding: %s (%d)  0: %d  Location: %s (%d)\n",
@@ -2843,9 +2835,9 @@ static void dump_progress_indicator(int full_ie, struct pri *ctrl, q931_ie *ie,
 		prefix, ie->data[1] >> 7, prog2str(ie->data[1] & 0x7f), ie->data[1] & 0x7f);
 }
 
-static int receive_display(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_display(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
-	u_int8_t *data;
+	const u_int8_t *data;
 
 	if (ctrl->display_flags.receive & PRI_DISPLAY_OPTION_BLOCK) {
 		return 0;
@@ -2898,7 +2890,7 @@ static int transmit_display(int full_ie, struct pri *ctrl, q931_call *call, int
 	return 2 + i + datalen;
 }
 
-static int receive_progress_indicator(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_progress_indicator(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	call->progloc = ie->data[0] & 0xf;
 	call->progcode = (ie->data[0] & 0x60) >> 5;
@@ -2961,7 +2953,7 @@ static int transmit_facility(int full_ie, struct pri *ctrl, q931_call *call, int
 		return 0;
 	}
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "Adding facility ie contents to send in %s message:\n",
 			msg2str(msgtype));
 		facility_decode_dump(ctrl, cur->apdu, cur->apdu_len);
@@ -3018,7 +3010,7 @@ static int transmit_facility(int full_ie, struct pri *ctrl, q931_call *call, int
 	return apdu_len + 2;
 }
 
-static int receive_facility(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_facility(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	/* Delay processing facility ie's till after all other ie's are processed. */
 	if (MAX_FACILITY_IES <= ctrl->facility.count) {
@@ -3037,7 +3029,7 @@ static int receive_facility(int full_ie, struct pri *ctrl, q931_call *call, int
 	return 0;
 }
 
-static int process_facility(struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie)
+static int process_facility(struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie)
 {
 	struct fac_extension_header header;
 	struct rose_message rose;
@@ -3058,7 +3050,7 @@ static int process_facility(struct pri *ctrl, q931_call *call, int msgtype, q931
 	default:
 	case Q932_PROTOCOL_CMIP:
 	case Q932_PROTOCOL_ACSE:
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl,
 				"!! Don't know how to handle Q.932 Protocol Profile type 0x%X\n",
 				*pos & Q932_PROTOCOL_MASK);
@@ -3071,7 +3063,7 @@ static int process_facility(struct pri *ctrl, q931_call *call, int msgtype, q931
 	}
 	++pos;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		asn1_dump(ctrl, pos, end);
 	}
 
@@ -3080,7 +3072,7 @@ static int process_facility(struct pri *ctrl, q931_call *call, int msgtype, q931
 		return -1;
 	}
 	if (header.npp_present) {
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl,
 				"!! Don't know how to handle Network Protocol Profile type 0x%X\n",
 				header.npp);
@@ -3119,11 +3111,11 @@ static void q931_handle_facilities(struct pri *ctrl, q931_call *call, int msgtyp
 	unsigned idx;
 	unsigned codeset;
 	unsigned full_ie;
-	q931_ie *ie;
+	const q931_ie *ie;
 
 	for (idx = 0; idx < ctrl->facility.count; ++idx) {
 		ie = ctrl->facility.ie[idx];
-		if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 			codeset = ctrl->facility.codeset[idx];
 			full_ie = Q931_FULL_IE(codeset, ie->ie);
 			pri_message(ctrl, "-- Delayed processing IE %d (cs%d, %s)\n", ie->ie, codeset, ie2str(full_ie));
@@ -3251,7 +3243,7 @@ static int transmit_call_state(int full_ie, struct pri *ctrl, q931_call *call, i
 	return 3;
 }
 
-static int receive_call_state(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_call_state(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	call->sugcallstate = ie->data[0] & 0x3f;
 	return 0;
@@ -3317,7 +3309,7 @@ static const char *q931_hold_state_str(enum Q931_HOLD_STATE state)
 	return code2str(state, hold_states, ARRAY_LEN(hold_states));
 }
 
-static void dump_call_state(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_call_state(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%2d) [ Ext: %d  Coding: %s (%d)  Call state: %s (%d)\n",
 		prefix, ie2str(full_ie), len, ie->data[0] >> 7,
@@ -3325,7 +3317,7 @@ static void dump_call_state(int full_ie, struct pri *ctrl, q931_ie *ie, int len,
 		q931_call_state_str(ie->data[0] & 0x3f), ie->data[0] & 0x3f);
 }
 
-static void dump_call_identity(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_call_identity(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	int x;
 
@@ -3336,7 +3328,7 @@ static void dump_call_identity(int full_ie, struct pri *ctrl, q931_ie *ie, int l
 	pri_message(ctrl, " ]\n");
 }
 
-static void dump_time_date(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_time_date(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%2d) [ ", prefix, ie2str(full_ie), len);
 	if (ie->len > 0)
@@ -3354,7 +3346,7 @@ static void dump_time_date(int full_ie, struct pri *ctrl, q931_ie *ie, int len,
 	pri_message(ctrl, " ]\n");
 }
 
-static int receive_time_date(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_time_date(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	/* Ignore incoming Date/Time since we have no use for it at this time. */
 	return 0;
@@ -3404,7 +3396,7 @@ static int transmit_time_date(int full_ie, struct pri *ctrl, q931_call *call, in
 	return ie_len;
 }
 
-static void dump_keypad_facility(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_keypad_facility(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	unsigned char tmp[64];
 
@@ -3412,7 +3404,7 @@ static void dump_keypad_facility(int full_ie, struct pri *ctrl, q931_ie *ie, int
 	pri_message(ctrl, "%c %s (len=%2d) [ %s ]\n", prefix, ie2str(full_ie), ie->len, tmp);
 }
 
-static int receive_keypad_facility(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_keypad_facility(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	if (ie->len == 0)
 		return -1;
@@ -3435,7 +3427,7 @@ static int transmit_keypad_facility(int full_ie, struct pri *ctrl, q931_call *ca
 		return 0;
 }
 
-static void dump_display(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_display(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	int x;
 	unsigned char buf[2*80 + 1];
@@ -3459,7 +3451,7 @@ static void dump_display(int full_ie, struct pri *ctrl, q931_ie *ie, int len, ch
 		pri_message(ctrl, "%s", tmpptr = tmp); \
 	}
 
-static void dump_ie_data(struct pri *ctrl, unsigned char *c, int len)
+static void dump_ie_data(struct pri *ctrl, const unsigned char *c, int len)
 {
 	static char hexs[16] = "0123456789ABCDEF";
 	char tmp[1024], *tmpptr;
@@ -3498,7 +3490,7 @@ static void dump_ie_data(struct pri *ctrl, unsigned char *c, int len)
 	pri_message(ctrl, "%s", tmp);
 }
 
-static void dump_facility(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_facility(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%2d, codeset=%d) [ ",
 		prefix, ie2str(full_ie), len, Q931_IE_CODESET(full_ie));
@@ -3519,7 +3511,7 @@ static void dump_facility(int full_ie, struct pri *ctrl, q931_ie *ie, int len, c
 #endif	/* Lets not dump parse of facility contents here anymore. */
 }
 
-static void dump_network_spec_fac(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_network_spec_fac(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%2d) [ ", prefix, ie2str(full_ie), ie->len);
 	if (ie->data[0] == 0x00) {
@@ -3530,7 +3522,7 @@ static void dump_network_spec_fac(int full_ie, struct pri *ctrl, q931_ie *ie, in
 	pri_message(ctrl, " ]\n");
 }
 
-static int receive_network_spec_fac(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_network_spec_fac(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	return 0;
 }
@@ -3570,7 +3562,7 @@ static char *pri_causeclass2str(int cause)
 	return code2str(cause, causeclasses, sizeof(causeclasses) / sizeof(causeclasses[0]));
 }
 
-static void dump_cause(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_cause(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	int x;
 	int cause_ind = 1;
@@ -3644,7 +3636,7 @@ static void dump_cause(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char
 	}
 }
 
-static int receive_cause(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_cause(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	call->causeloc = ie->data[0] & 0xf;
 	call->causecode = (ie->data[0] & 0x60) >> 5;
@@ -3672,12 +3664,12 @@ static int transmit_cause(int full_ie, struct pri *ctrl, q931_call *call, int ms
 	}
 }
 
-static void dump_sending_complete(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_sending_complete(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%2d)\n", prefix, ie2str(full_ie), len);
 }
 
-static int receive_sending_complete(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_sending_complete(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	/* We've got a "Complete" message: Exect no further digits. */
 	call->complete = 1; 
@@ -3725,14 +3717,14 @@ static char *notify2str(int info)
 	return code2str(info, notifies, sizeof(notifies) / sizeof(notifies[0]));
 }
 
-static void dump_notify(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_notify(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%2d): Ext: %d  %s (%d)\n",
 		prefix, ie2str(full_ie), len, ie->data[0] >> 7,
 		notify2str(ie->data[0] & 0x7f), ie->data[0] & 0x7f);
 }
 
-static int receive_notify(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_notify(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	call->notify = ie->data[0] & 0x7F;
 	return 0;
@@ -3747,7 +3739,7 @@ static int transmit_notify(int full_ie, struct pri *ctrl, q931_call *call, int m
 	return 0;
 }
 
-static void dump_shift(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_shift(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %sLocking Shift (len=%02d): Requested codeset %d\n",
 		prefix, (full_ie & 8) ? "Non-" : "", len, full_ie & 7);
@@ -3785,13 +3777,13 @@ static char *lineinfo2str(int info)
 	return code2str(info, lineinfo, sizeof(lineinfo) / sizeof(lineinfo[0]));
 }
 
-static void dump_line_information(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_line_information(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%02d): %s (%d)\n",
 		prefix, ie2str(full_ie), len, lineinfo2str(ie->data[0]), ie->data[0]);
 }
 
-static int receive_line_information(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_line_information(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	call->ani2 = ie->data[0];
 	return 0;
@@ -3836,7 +3828,7 @@ static char *gdtype2str(int type)
 	return code2str(type, gdtype, sizeof(gdtype) / sizeof(gdtype[0]));
 }
 
-static void dump_generic_digits(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_generic_digits(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	int encoding;
 	int type;
@@ -3885,7 +3877,7 @@ static void dump_generic_digits(int full_ie, struct pri *ctrl, q931_ie *ie, int
 	pri_message(ctrl, "\n");
 }
 
-static int receive_generic_digits(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_generic_digits(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	int encoding;
 	int type;
@@ -4008,7 +4000,7 @@ static char *signal2str(int signal)
 }
 
 
-static void dump_signal(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_signal(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%02d): ", prefix, ie2str(full_ie), len);
 	if (len < 3) {
@@ -4018,7 +4010,7 @@ static void dump_signal(int full_ie, struct pri *ctrl, q931_ie *ie, int len, cha
 	pri_message(ctrl, "Signal %s (%d)\n", signal2str(ie->data[0]), ie->data[0]);
 }
 
-static void dump_transit_count(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_transit_count(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	/* Defined in ECMA-225 */
 	pri_message(ctrl, "%c %s (len=%02d): ", prefix, ie2str(full_ie), len);
@@ -4029,12 +4021,12 @@ static void dump_transit_count(int full_ie, struct pri *ctrl, q931_ie *ie, int l
 	pri_message(ctrl, "Count=%d (0x%02x)\n", ie->data[0] & 0x1f, ie->data[0] & 0x1f);
 }
 
-static void dump_reverse_charging_indication(int full_ie, struct pri *ctrl, q931_ie *ie, int len, char prefix)
+static void dump_reverse_charging_indication(int full_ie, struct pri *ctrl, const q931_ie *ie, int len, char prefix)
 {
 	pri_message(ctrl, "%c %s (len=%02d): %d\n", prefix, ie2str(full_ie), len, ie->data[0] & 0x7);
 }
 
-static int receive_reverse_charging_indication(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, q931_ie *ie, int len)
+static int receive_reverse_charging_indication(int full_ie, struct pri *ctrl, q931_call *call, int msgtype, const q931_ie *ie, int len)
 {
 	call->reversecharge = ie->data[0] & 0x7;
 	return 0;
@@ -4116,10 +4108,96 @@ static struct ie ies[] = {
 	/* Codeset 7 */
 };
 
-static char *ie2str(int ie)
+/*!
+ * \brief Direct index into ies[] by codeset and ie id.
+ *
+ * \details
+ * Holds the ies[] position plus one of the entry for each full ie
+ * code or zero if ies[] has no entry.  Built from ies[] on the first
+ * lookup so ies[] remains the only table to maintain.
+ */
+static unsigned char ie_index[8][256];
+
+/*! \brief Direct index into msgs[] by message type.  (Position plus one or zero if none) */
+static unsigned char msg_index[256];
+
+/*! \brief Builds ie_index[] and msg_index[] exactly once. */
+static pthread_once_t q931_index_once = PTHREAD_ONCE_INIT;
+
+/* Fail the build if ies[] or msgs[] outgrow what the indexes can hold. */
+typedef char q931_ie_index_fits[ARRAY_LEN(ies) < 256 ? 1 : -1];
+typedef char q931_msg_index_fits[ARRAY_LEN(msgs) < 256 ? 1 : -1];
+
+/*!
+ * \internal
+ * \brief Build the direct ie and message type indexes.
+ *
+ * \note Only run through pthread_once() on q931_index_once.
+ *
+ * \return Nothing
+ */
+static void q931_index_build(void)
 {
 	unsigned int x;
 
+	for (x = 0; x < ARRAY_LEN(ies); ++x) {
+		if (!ie_index[Q931_IE_CODESET(ies[x].ie)][Q931_IE_IE(ies[x].ie)]) {
+			ie_index[Q931_IE_CODESET(ies[x].ie)][Q931_IE_IE(ies[x].ie)] = x + 1;
+		}
+	}
+	for (x = 0; x < ARRAY_LEN(msgs); ++x) {
+		if (!msg_index[msgs[x].msgnum & 0xff]) {
+			msg_index[msgs[x].msgnum & 0xff] = x + 1;
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Find the ies[] entry of the given full ie code.
+ *
+ * \param full_ie Codeset and ie id to find.
+ *
+ * \retval ies[] entry on success.
+ * \retval NULL if not found.
+ */
+static struct ie *q931_ie_find(int full_ie)
+{
+	unsigned int pos;
+
+	if (full_ie & ~0x7ff) {
+		return NULL;
+	}
+	pthread_once(&q931_index_once, q931_index_build);
+	pos = ie_index[Q931_IE_CODESET(full_ie)][Q931_IE_IE(full_ie)];
+	return pos ? &ies[pos - 1] : NULL;
+}
+
+/*!
+ * \internal
+ * \brief Find the msgs[] entry of the given message type.
+ *
+ * \param msg Q.931 message type to find.
+ *
+ * \retval msgs[] entry on success.
+ * \retval NULL if not found.
+ */
+static struct msgtype *q931_msg_find(int msg)
+{
+	unsigned int pos;
+
+	if (msg & ~0xff) {
+		return NULL;
+	}
+	pthread_once(&q931_index_once, q931_index_build);
+	pos = msg_index[msg];
+	return pos ? &msgs[pos - 1] : NULL;
+}
+
+static char *ie2str(int ie)
+{
+	struct ie *ie_def;
+
 	/* Special handling for Locking/Non-Locking Shifts */
 	switch (ie & 0xf8) {
 	case Q931_LOCKING_SHIFT:
@@ -4169,15 +4247,14 @@ static char *ie2str(int ie)
 	default:
 		break;
 	}
-	for (x = 0; x < ARRAY_LEN(ies); ++x) {
-		if (ie == ies[x].ie) {
-			return ies[x].name;
-		}
+	ie_def = q931_ie_find(ie);
+	if (ie_def) {
+		return ie_def->name;
 	}
 	return "Unknown Information Element";
 }
 
-static inline unsigned int ielen(q931_ie *ie)
+static inline unsigned int ielen(const q931_ie *ie)
 {
 	if ((ie->ie & 0x80) != 0)
 		return 1;
@@ -4185,7 +4262,7 @@ static inline unsigned int ielen(q931_ie *ie)
 		return 2 + ie->len;
 }
 
-static inline int ielen_checked(q931_ie *ie, int len_remaining)
+static inline int ielen_checked(const q931_ie *ie, int len_remaining)
 {
 	int len;
 
@@ -4206,10 +4283,11 @@ static inline int ielen_checked(q931_ie *ie, int len_remaining)
 
 const char *msg2str(int msg)
 {
-	unsigned int x;
-	for (x=0;x<sizeof(msgs) / sizeof(msgs[0]); x++) 
-		if (msgs[x].msgnum == msg)
-			return msgs[x].name;
+	struct msgtype *m;
+
+	m = q931_msg_find(msg);
+	if (m)
+		return m->name;
 	return "Unknown Message Type";
 }
 
@@ -4235,7 +4313,7 @@ static char *maintenance_msg2str(int msg, int pd)
 }
 
 /* Decode the call reference */
-static inline int q931_cr(q931_h *h)
+static inline int q931_cr(const q931_h *h)
 {
 	int cr;
 	int x;
@@ -4270,11 +4348,12 @@ static inline int q931_cr(q931_h *h)
 	return cr;
 }
 
-static inline void q931_dumpie(struct pri *ctrl, int codeset, q931_ie *ie, char prefix)
+static inline void q931_dumpie(struct pri *ctrl, int codeset, const q931_ie *ie, char prefix)
 {
 	unsigned int x;
 	int full_ie = Q931_FULL_IE(codeset, ie->ie);
 	int base_ie;
+	struct ie *ie_def;
 	char *buf = malloc(ielen(ie) * 3 + 1);
 	int buflen = 0;
 
@@ -4293,14 +4372,14 @@ static inline void q931_dumpie(struct pri *ctrl, int codeset, q931_ie *ie, char
 
 	base_ie = (((full_ie & ~0x7f) == Q931_FULL_IE(0, 0x80)) && ((full_ie & 0x70) != 0x20)) ? full_ie & ~0x0f : full_ie;
 
-	for (x = 0; x < ARRAY_LEN(ies); ++x)
-		if (ies[x].ie == base_ie) {
-			if (ies[x].dump)
-				ies[x].dump(full_ie, ctrl, ie, ielen(ie), prefix);
-			else
-				pri_message(ctrl, "%c IE: %s (len = %d)\n", prefix, ies[x].name, ielen(ie));
-			return;
-		}
+	ie_def = q931_ie_find(base_ie);
+	if (ie_def) {
+		if (ie_def->dump)
+			ie_def->dump(full_ie, ctrl, ie, ielen(ie), prefix);
+		else
+			pri_message(ctrl, "%c IE: %s (len = %d)\n", prefix, ie_def->name, ielen(ie));
+		return;
+	}
 	
 	pri_error(ctrl, "!! %c Unknown IE %d (cs%d, len = %d)\n", prefix, Q931_IE_IE(base_ie), Q931_IE_CODESET(base_ie), ielen(ie));
 }
@@ -4368,6 +4447,401 @@ void q931_init_call_record(struct q921_link *link, struct q931_call *call, int c
 	}
 }
 
+/*!
+ * \brief Add call records to the call record slab.
+ *
+ * \param ctrl D channel controller.
+ * \param size Number of call records the slab should have.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int q931_call_slab_reserve(struct pri *ctrl, unsigned size)
+{
+	struct q931_call_slab *slab;
+	struct q931_call_chunk *chunk;
+	unsigned count;
+	unsigned idx;
+
+	slab = ctrl->callslab;
+	if (size <= slab->size) {
+		/* Already have enough. */
+		return 0;
+	}
+	count = size - slab->size;
+
+	chunk = malloc(sizeof(*chunk));
+	if (!chunk) {
+		return -1;
+	}
+	chunk->calls = malloc(count * sizeof(*chunk->calls));
+	if (!chunk->calls) {
+		free(chunk);
+		return -1;
+	}
+	chunk->next = slab->chunks;
+	slab->chunks = chunk;
+
+	/* The records are zeroed when taken from the slab. */
+	for (idx = count; idx--;) {
+		chunk->calls[idx].slab_owned = 1;
+		chunk->calls[idx].next = slab->free;
+		slab->free = &chunk->calls[idx];
+	}
+	slab->size = size;
+	slab->num_free += count;
+	return 0;
+}
+
+/*!
+ * \brief Release the call record slab memory.
+ *
+ * \param slab Call record slab to release.
+ *
+ * \return Nothing
+ */
+void q931_call_slab_destroy(struct q931_call_slab *slab)
+{
+	struct q931_call_chunk *chunk;
+
+	while ((chunk = slab->chunks)) {
+		slab->chunks = chunk->next;
+		free(chunk->calls);
+		free(chunk);
+	}
+	slab->free = NULL;
+	slab->size = 0;
+	slab->num_free = 0;
+}
+
+/*!
+ * \internal
+ * \brief Get a call record.
+ *
+ * \param ctrl D channel controller.
+ * \param zero TRUE if the call record needs to be zeroed.
+ *
+ * \note
+ * Pass FALSE for zero when the caller overwrites the whole record.
+ *
+ * \retval call on success.
+ * \retval NULL on error.
+ */
+static struct q931_call *q931_call_alloc(struct pri *ctrl, int zero)
+{
+	struct q931_call_slab *slab;
+	struct q931_call *call;
+
+	slab = ctrl->callslab;
+	call = slab->free;
+	if (call) {
+		++slab->hits;
+		slab->free = call->next;
+		--slab->num_free;
+		if (zero) {
+			memset(call, 0, sizeof(*call));
+		}
+		call->slab_owned = 1;
+		return call;
+	}
+	++slab->misses;
+	if (zero) {
+		call = calloc(1, sizeof(*call));
+	} else {
+		call = malloc(sizeof(*call));
+		if (call) {
+			call->slab_owned = 0;
+		}
+	}
+	return call;
+}
+
+/*!
+ * \internal
+ * \brief Release a call record.
+ *
+ * \param ctrl D channel controller.
+ * \param call Call record to release.
+ *
+ * \return Nothing
+ */
+static void q931_call_release(struct pri *ctrl, struct q931_call *call)
+{
+	struct q931_call_slab *slab;
+
+	if (call->slab_owned) {
+		slab = ctrl->callslab;
+		call->next = slab->free;
+		slab->free = call;
+		++slab->num_free;
+	} else {
+		free(call);
+	}
+}
+
+/*! Initial number of slots in a call pool hash index. (Power of 2) */
+#define Q931_CALL_HASH_INITIAL	64
+
+/*! Call record key of the call reference hash index. */
+static int q931_call_key_cr(const struct q931_call *call)
+{
+	return call->cr;
+}
+
+/*! Call record key of the ECT link id hash index. */
+static int q931_call_key_link_id(const struct q931_call *call)
+{
+	return call->link_id;
+}
+
+/*! Call record key of the record address hash index. */
+static int q931_call_key_ptr(const struct q931_call *call)
+{
+	/* The low bits are the same for every record because of alignment. */
+	return (int) ((unsigned long) call >> 4);
+}
+
+/*!
+ * \internal
+ * \brief Get the home hash slot of the given key.
+ *
+ * \param hash Call pool hash index.
+ * \param key Key to hash.
+ *
+ * \return Home hash slot index.
+ */
+static unsigned q931_call_hash_home(const struct q931_call_hash *hash, int key)
+{
+	/* Fibonacci hashing spreads the sequential call reference values. */
+	return ((unsigned) key * 0x9E3779B1U) >> (32 - hash->bits);
+}
+
+/*!
+ * \internal
+ * \brief Put the call record in the hash index without checking for room.
+ *
+ * \param hash Call pool hash index.
+ * \param call Q.931 call leg.
+ * \param key Function to get the call record key.
+ *
+ * \return Nothing
+ */
+static void q931_call_hash_put(struct q931_call_hash *hash, struct q931_call *call, int (*key)(const struct q931_call *call))
+{
+	unsigned pos;
+
+	for (pos = q931_call_hash_home(hash, key(call)); hash->slot[pos];
+		pos = (pos + 1) & (hash->size - 1)) {
+	}
+	hash->slot[pos] = call;
+	++hash->used;
+}
+
+/*!
+ * \internal
+ * \brief Add the call record to the hash index.
+ *
+ * \param hash Call pool hash index.
+ * \param call Q.931 call leg.
+ * \param key Function to get the call record key.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int q931_call_hash_add(struct q931_call_hash *hash, struct q931_call *call, int (*key)(const struct q931_call *call))
+{
+	struct q931_call **old_slot;
+	unsigned old_size;
+	unsigned idx;
+
+	if (hash->size < 2 * (hash->used + 1)) {
+		/* Keep the load factor at or below one half by doubling. */
+		old_slot = hash->slot;
+		old_size = hash->size;
+		if (old_size) {
+			hash->slot = calloc(2 * old_size, sizeof(*hash->slot));
+		} else {
+			hash->slot = calloc(Q931_CALL_HASH_INITIAL, sizeof(*hash->slot));
+		}
+		if (!hash->slot) {
+			hash->slot = old_slot;
+			return -1;
+		}
+		if (old_size) {
+			hash->size = 2 * old_size;
+			++hash->bits;
+		} else {
+			hash->size = Q931_CALL_HASH_INITIAL;
+			for (hash->bits = 0; (1U << hash->bits) < hash->size; ++hash->bits) {
+			}
+		}
+		hash->used = 0;
+		for (idx = 0; idx < old_size; ++idx) {
+			if (old_slot[idx]) {
+				q931_call_hash_put(hash, old_slot[idx], key);
+			}
+		}
+		free(old_slot);
+	}
+	q931_call_hash_put(hash, call, key);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Remove the call record from the hash index.
+ *
+ * \param hash Call pool hash index.
+ * \param call Q.931 call leg.
+ * \param key Function to get the call record key.
+ *
+ * \return TRUE if the call record was in the index.
+ */
+static int q931_call_hash_del(struct q931_call_hash *hash, struct q931_call *call, int (*key)(const struct q931_call *call))
+{
+	unsigned mask;
+	unsigned pos;
+	unsigned next;
+	unsigned home;
+
+	if (!hash->used) {
+		return 0;
+	}
+	mask = hash->size - 1;
+	for (pos = q931_call_hash_home(hash, key(call)); hash->slot[pos] != call;
+		pos = (pos + 1) & mask) {
+		if (!hash->slot[pos]) {
+			/* Not in the index. */
+			return 0;
+		}
+	}
+
+	/* Shift back any following entries that would no longer be reachable. */
+	for (next = (pos + 1) & mask; hash->slot[next]; next = (next + 1) & mask) {
+		home = q931_call_hash_home(hash, key(hash->slot[next]));
+		if (((next - home) & mask) >= ((next - pos) & mask)) {
+			hash->slot[pos] = hash->slot[next];
+			pos = next;
+		}
+	}
+	hash->slot[pos] = NULL;
+	--hash->used;
+	return 1;
+}
+
+/*!
+ * \internal
+ * \brief Find the first call record in the call pool with the given call reference.
+ *
+ * \param ctrl D channel controller.
+ * \param cr Call Reference identifier.
+ * \param link Q.921 link the call must be on.  NULL if any link.
+ *
+ * \note When several records match, the oldest is returned like a
+ * walk of the call pool list would.  Records are appended to the list
+ * as they are created, so the oldest has the lowest serial number.
+ *
+ * \retval call if found.
+ * \retval NULL if not found.
+ */
+static struct q931_call *q931_call_index_find_cr(struct pri *ctrl, int cr, struct q921_link *link)
+{
+	struct q931_call_hash *hash;
+	struct q931_call *found;
+	struct q931_call *cur;
+	unsigned pos;
+
+	hash = &ctrl->callindex->cr;
+	if (!hash->used) {
+		return NULL;
+	}
+	found = NULL;
+	for (pos = q931_call_hash_home(hash, cr); (cur = hash->slot[pos]);
+		pos = (pos + 1) & (hash->size - 1)) {
+		if (cur->cr == cr && (!link || cur->link == link)
+			&& (!found || (int) (cur->serial - found->serial) < 0)) {
+			found = cur;
+		}
+	}
+	return found;
+}
+
+/*!
+ * \internal
+ * \brief Determine if the call record is in the call pool or is one of its subcalls.
+ *
+ * \param ctrl D channel controller.
+ * \param call Q.931 call leg.
+ *
+ * \note The call pointer is not dereferenced so it can be stale.
+ *
+ * \return TRUE if the call record is indexed.
+ */
+static int q931_call_index_has(struct pri *ctrl, const struct q931_call *call)
+{
+	struct q931_call_hash *hash;
+	struct q931_call *cur;
+	unsigned pos;
+
+	hash = &ctrl->callindex->ptr;
+	if (!hash->used) {
+		return 0;
+	}
+	for (pos = q931_call_hash_home(hash, q931_call_key_ptr(call)); (cur = hash->slot[pos]);
+		pos = (pos + 1) & (hash->size - 1)) {
+		if (cur == call) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*!
+ * \brief Set the ECT link id of the given call pool record.
+ *
+ * \param ctrl D channel controller.
+ * \param call Q.931 master call leg in the call pool.
+ * \param link_id Link id to set.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int q931_set_link_id(struct pri *ctrl, struct q931_call *call, int link_id)
+{
+	struct q931_call_hash *hash;
+
+	if (q931_is_dummy_call(call)) {
+		/* Dummy calls are not in the call pool so are never found by link id. */
+		call->link_id = link_id;
+		call->is_link_id_valid = 1;
+		return 0;
+	}
+	hash = &ctrl->callindex->link_id;
+	if (call->is_link_id_valid) {
+		q931_call_hash_del(hash, call, q931_call_key_link_id);
+	}
+	call->link_id = link_id;
+	call->is_link_id_valid = !q931_call_hash_add(hash, call, q931_call_key_link_id);
+	return call->is_link_id_valid ? 0 : -1;
+}
+
+/*!
+ * \internal
+ * \brief Get a serial number for a new call record.
+ *
+ * \param ctrl D channel controller.
+ *
+ * \return Serial number.  (Never 0)
+ */
+static unsigned q931_call_serial_next(struct pri *ctrl)
+{
+	if (!++ctrl->callindex->serial) {
+		/* Wrapped.  0 is kept for dummy calls. */
+		++ctrl->callindex->serial;
+	}
+	return ctrl->callindex->serial;
+}
+
 /*!
  * \internal
  * \brief Create a new call record.
@@ -4381,33 +4855,42 @@ void q931_init_call_record(struct q921_link *link, struct q931_call *call, int c
 static struct q931_call *q931_create_call_record(struct q921_link *link, int cr)
 {
 	struct q931_call *call;
-	struct q931_call *prev;
 	struct pri *ctrl;
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "-- Making new call for cref %d\n", cr);
 	}
 
-	call = calloc(1, sizeof(*call));
+	call = q931_call_alloc(ctrl, 1);
 	if (!call) {
 		return NULL;
 	}
 
 	/* Initialize call structure. */
 	q931_init_call_record(link, call, cr);
+	call->serial = q931_call_serial_next(ctrl);
+
+	if (q931_call_hash_add(&ctrl->callindex->cr, call, q931_call_key_cr)) {
+		q931_call_release(ctrl, call);
+		return NULL;
+	}
+	if (q931_call_hash_add(&ctrl->callindex->ptr, call, q931_call_key_ptr)) {
+		q931_call_hash_del(&ctrl->callindex->cr, call, q931_call_key_cr);
+		q931_call_release(ctrl, call);
+		return NULL;
+	}
 
 	/* Append to the list end */
+	call->prev = ctrl->callindex->tail;
 	if (*ctrl->callpool) {
-		/* Find the list end. */
-		for (prev = *ctrl->callpool; prev->next; prev = prev->next) {
-		}
-		prev->next = call;
+		ctrl->callindex->tail->next = call;
 	} else {
 		/* List was empty. */
 		*ctrl->callpool = call;
 	}
+	ctrl->callindex->tail = call;
 
 	return call;
 }
@@ -4441,27 +4924,20 @@ static struct q931_call *q931_find_call(struct q921_link *link, int cr)
 		}
 
 		/* We are looking for a call reference value that the other side allocated. */
-		for (cur = *ctrl->callpool; cur; cur = cur->next) {
-			if (cur->cr == cr && cur->link == link) {
-				/* Found existing call.  The call reference and link matched. */
-				break;
-			}
-		}
+		cur = q931_call_index_find_cr(ctrl, cr, link);
 	} else {
-		for (cur = *ctrl->callpool; cur; cur = cur->next) {
-			if (cur->cr == cr) {
-				/* Found existing call. */
-				switch (ctrl->switchtype) {
-				case PRI_SWITCH_GR303_EOC:
-				case PRI_SWITCH_GR303_TMC:
-					break;
-				default:
-					if (!ctrl->bri) {
-						/* The call is now attached to whoever called us */
-						cur->pri = ctrl;
-						cur->link = link;
-					}
-					break;
+		cur = q931_call_index_find_cr(ctrl, cr, NULL);
+		if (cur) {
+			/* Found existing call. */
+			switch (ctrl->switchtype) {
+			case PRI_SWITCH_GR303_EOC:
+			case PRI_SWITCH_GR303_TMC:
+				break;
+			default:
+				if (!ctrl->bri) {
+					/* The call is now attached to whoever called us */
+					cur->pri = ctrl;
+					cur->link = link;
 				}
 				break;
 			}
@@ -4529,15 +5005,10 @@ struct q931_call *q931_new_call(struct pri *ctrl)
 		}
 
 		/* Is the call reference value in use? */
-		for (cur = *ctrl->callpool; cur; cur = cur->next) {
-			if (cur->cr == cref) {
-				/* Yes it is in use. */
-				if (first_cref == ctrl->cref) {
-					/* All call reference values are in use! */
-					return NULL;
-				}
-				break;
-			}
+		cur = q931_call_index_find_cr(ctrl, cref, NULL);
+		if (cur && first_cref == ctrl->cref) {
+			/* All call reference values are in use! */
+			return NULL;
 		}
 	} while (cur);
 
@@ -4559,7 +5030,7 @@ static void cleanup_and_free_call(struct q931_call *cur)
 	struct pri *ctrl;
 
 	ctrl = cur->pri;
-	pri_schedule_del(ctrl, cur->restart.timer);
+	q931_call_hash_del(&ctrl->callindex->ptr, cur, q931_call_key_ptr);
 	pri_schedule_del(ctrl, cur->restart_tx.t316_timer);
 	pri_schedule_del(ctrl, cur->retranstimer);
 	pri_schedule_del(ctrl, cur->hold_timer);
@@ -4576,7 +5047,7 @@ static void cleanup_and_free_call(struct q931_call *cur)
 			cur->cc.record->signaling = NULL;
 		}
 	}
-	free(cur);
+	q931_call_release(ctrl, cur);
 }
 
 int q931_get_subcall_count(struct q931_call *master)
@@ -4605,7 +5076,7 @@ static void pri_fake_clearing(struct q931_call *call)
 	struct pri *ctrl;
 
 	ctrl = call->pri;
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "Fake clearing.  cref:%d\n", call->cr);
 	}
 
@@ -4635,7 +5106,7 @@ static void pri_fake_clearing_expiry(void *data)
 
 static void pri_create_fake_clearing(struct pri *ctrl, struct q931_call *master)
 {
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "Fake clearing requested.  cref:%d\n", master->cr);
 	}
 	pri_schedule_del(ctrl, master->fake_clearing_timer);
@@ -4649,7 +5120,7 @@ static void t312_expiry(void *data)
 	struct pri *ctrl;
 
 	ctrl = master->pri;
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "T312 timed out.  cref:%d\n", master->cr);
 	}
 
@@ -4694,7 +5165,7 @@ static void q931_destroy_subcall(struct q931_call *master, int idx)
 {
 	struct pri *ctrl = master->pri;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "Destroying subcall %p of call %p at %d\n",
 			master->subcalls[idx], master, idx);
 	}
@@ -4709,7 +5180,6 @@ static void q931_destroy_subcall(struct q931_call *master, int idx)
 void q931_destroycall(struct pri *ctrl, q931_call *c)
 {
 	struct q931_call *cur;
-	struct q931_call *prev;
 	struct q931_call *slave;
 	int i;
 	int slavesleft;
@@ -4725,172 +5195,207 @@ void q931_destroycall(struct pri *ctrl, q931_call *c)
 		slave = NULL;
 	}
 
-	prev = NULL;
-	cur = *ctrl->callpool;
-	while (cur) {
-		if (cur == c) {
-			if (slave) {
-				/* Destroying a slave. */
-				for (i = 0; i < ARRAY_LEN(cur->subcalls); ++i) {
-					if (cur->subcalls[i] == slave) {
-						q931_destroy_subcall(cur, i);
-						break;
-					}
-				}
+	if (!q931_call_index_has(ctrl, c)) {
+		pri_error(ctrl, "Can't destroy call %p cref:%d!\n", c, c->cr);
+		return;
+	}
+	cur = c;
+	if (slave) {
+		/* Destroying a slave. */
+		for (i = 0; i < ARRAY_LEN(cur->subcalls); ++i) {
+			if (cur->subcalls[i] == slave) {
+				q931_destroy_subcall(cur, i);
+				break;
+			}
+		}
 
-				/* How many slaves are left? */
-				slavesleft = 0;
-				for (i = 0; i < ARRAY_LEN(cur->subcalls); ++i) {
-					if (cur->subcalls[i]) {
-						if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
-							pri_message(ctrl, "Subcall still present at %d\n", i);
-						}
-						++slavesleft;
-					}
+		/* How many slaves are left? */
+		slavesleft = 0;
+		for (i = 0; i < ARRAY_LEN(cur->subcalls); ++i) {
+			if (cur->subcalls[i]) {
+				if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
+					pri_message(ctrl, "Subcall still present at %d\n", i);
 				}
+				++slavesleft;
+			}
+		}
 
-				if (slavesleft || cur->t312_timer || cur->master_hanging_up) {
-					return;
-				}
+		if (slavesleft || cur->t312_timer || cur->master_hanging_up) {
+			return;
+		}
 
-				/* No slaves left. */
-				switch (cur->ourcallstate) {
-				case Q931_CALL_STATE_CALL_ABORT:
-					break;
-				default:
-					/* Let the upper layer know about the call clearing. */
-					UPDATE_OURCALLSTATE(ctrl, cur, Q931_CALL_STATE_CALL_ABORT);
-					pri_create_fake_clearing(ctrl, cur);
-					return;
-				}
+		/* No slaves left. */
+		switch (cur->ourcallstate) {
+		case Q931_CALL_STATE_CALL_ABORT:
+			break;
+		default:
+			/* Let the upper layer know about the call clearing. */
+			UPDATE_OURCALLSTATE(ctrl, cur, Q931_CALL_STATE_CALL_ABORT);
+			pri_create_fake_clearing(ctrl, cur);
+			return;
+		}
 
-				/* We can try to destroy the master now. */
-			} else {
-				/* Destroy any slaves that may be present as well. */
-				slavesleft = 0;
-				for (i = 0; i < ARRAY_LEN(cur->subcalls); ++i) {
-					if (cur->subcalls[i]) {
-						++slavesleft;
-						q931_destroy_subcall(cur, i);
-					}
-				}
+		/* We can try to destroy the master now. */
+	} else {
+		/* Destroy any slaves that may be present as well. */
+		slavesleft = 0;
+		for (i = 0; i < ARRAY_LEN(cur->subcalls); ++i) {
+			if (cur->subcalls[i]) {
+				++slavesleft;
+				q931_destroy_subcall(cur, i);
 			}
+		}
+	}
 
-			if (cur->fake_clearing_timer) {
-				/*
-				 * Must wait for the fake clearing to complete before destroying
-				 * the master call record.
-				 */
-				return;
-			}
-			if (slavesleft) {
-				/* This is likely not good. */
-				pri_error(ctrl,
-					"Destroyed %d subcalls unconditionally with the master.  cref:%d\n",
-					slavesleft, cur->cr);
-			}
+	if (cur->fake_clearing_timer) {
+		/*
+		 * Must wait for the fake clearing to complete before destroying
+		 * the master call record.
+		 */
+		return;
+	}
+	if (slavesleft) {
+		/* This is likely not good. */
+		pri_error(ctrl,
+			"Destroyed %d subcalls unconditionally with the master.  cref:%d\n",
+			slavesleft, cur->cr);
+	}
 
-			/* Master call or normal call destruction. */
-			if (prev)
-				prev->next = cur->next;
-			else
-				*ctrl->callpool = cur->next;
-			if (ctrl->debug & PRI_DEBUG_Q931_STATE)
-				pri_message(ctrl,
-					"Destroying call %p, ourstate %s, peerstate %s, hold-state %s\n",
-					cur,
-					q931_call_state_str(cur->ourcallstate),
-					q931_call_state_str(cur->peercallstate),
-					q931_hold_state_str(cur->hold_state));
-			cleanup_and_free_call(cur);
-			return;
-		}
-		prev = cur;
-		cur = cur->next;
+	/* Master call or normal call destruction. */
+	if (cur->prev) {
+		cur->prev->next = cur->next;
+	} else {
+		*ctrl->callpool = cur->next;
+	}
+	if (cur->next) {
+		cur->next->prev = cur->prev;
+	} else {
+		ctrl->callindex->tail = cur->prev;
+	}
+	q931_call_hash_del(&ctrl->callindex->cr, cur, q931_call_key_cr);
+	if (cur->is_link_id_valid) {
+		q931_call_hash_del(&ctrl->callindex->link_id, cur, q931_call_key_link_id);
 	}
-	pri_error(ctrl, "Can't destroy call %p cref:%d!\n", c, c->cr);
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE))
+		pri_message(ctrl,
+			"Destroying call %p, ourstate %s, peerstate %s, hold-state %s\n",
+			cur,
+			q931_call_state_str(cur->ourcallstate),
+			q931_call_state_str(cur->peercallstate),
+			q931_hold_state_str(cur->hold_state));
+	cleanup_and_free_call(cur);
 }
 
-static int add_ie(struct pri *ctrl, q931_call *call, int msgtype, int ie, q931_ie *iet, int maxlen, int *codeset)
+/*! Longest possible ie: id, length, and 255 octets of contents. */
+#define Q931_IE_MAX_LEN		(2 + 255)
+
+/*!
+ * \internal
+ * \brief Make sure the buffer an ie encoder writes into is zeroed.
+ *
+ * \param iet Where the encoder writes the ie.
+ * \param maxlen Message buffer space left at iet.
+ * \param zeroed End of the zeroed part of the message buffer.  (Updated)
+ *
+ * \details
+ * An ie cannot be longer than Q931_IE_MAX_LEN so only that much ahead
+ * of the encoder needs to be zeroed instead of the whole message buffer.
+ *
+ * \return Nothing
+ */
+static void q931_ie_zero_ahead(q931_ie *iet, int maxlen, u_int8_t **zeroed)
 {
-	unsigned int x;
+	u_int8_t *end;
+
+	end = (u_int8_t *) iet + (maxlen < Q931_IE_MAX_LEN ? maxlen : Q931_IE_MAX_LEN);
+	if (*zeroed < end) {
+		memset(*zeroed, 0, end - *zeroed);
+		*zeroed = end;
+	}
+}
+
+static int add_ie(struct pri *ctrl, q931_call *call, int msgtype, int ie, q931_ie *iet, int maxlen, int *codeset, u_int8_t **zeroed)
+{
+	struct ie *ie_def;
 	int res, total_res;
 	int have_shift;
 	int ies_count, order;
 
-	for (x = 0; x < ARRAY_LEN(ies); ++x) {
-		if (ies[x].ie == ie) {
-			/* This is our baby */
-			if (ies[x].transmit) {
-				/* Prepend with CODE SHIFT IE if required */
-				if (*codeset != Q931_IE_CODESET(ies[x].ie)) {
-					/* Locking shift to codeset 0 isn't possible */
-					iet->ie = Q931_IE_CODESET(ies[x].ie) | (Q931_IE_CODESET(ies[x].ie) ? Q931_LOCKING_SHIFT : Q931_NON_LOCKING_SHIFT);
-					have_shift = 1;
-					iet = (q931_ie *)((char *)iet + 1);
-					maxlen--;
-				}
-				else
-					have_shift = 0;
-				ies_count = ies[x].max_count;
-				if (ies_count == 0)
-					ies_count = INT_MAX;
-				order = 0;
-				total_res = 0;
-				do {
-					iet->ie = ie;
-					res = ies[x].transmit(ie, ctrl, call, msgtype, iet, maxlen, ++order);
-					/* Error if res < 0 or ignored if res == 0 */
-					if (res < 0)
-						return res;
-					if (res > 0) {
-						if ((iet->ie & 0x80) == 0) /* Multibyte IE */
-							iet->len = res - 2;
-						if (msgtype == Q931_SETUP && *codeset == 0) {
-							switch (iet->ie) {
-							case Q931_BEARER_CAPABILITY:
-								if (!(call->cc.saved_ie_flags & CC_SAVED_IE_BC)) {
-									/* Save first BC ie contents for possible CC. */
-									call->cc.saved_ie_flags |= CC_SAVED_IE_BC;
-									q931_append_ie_contents(&call->cc.saved_ie_contents,
-										iet);
-								}
-								break;
-							case Q931_LOW_LAYER_COMPAT:
-								if (!(call->cc.saved_ie_flags & CC_SAVED_IE_LLC)) {
-									/* Save first LLC ie contents for possible CC. */
-									call->cc.saved_ie_flags |= CC_SAVED_IE_LLC;
-									q931_append_ie_contents(&call->cc.saved_ie_contents,
-										iet);
-								}
-								break;
-							case Q931_HIGH_LAYER_COMPAT:
-								if (!(call->cc.saved_ie_flags & CC_SAVED_IE_HLC)) {
-									/* Save first HLC ie contents for possible CC. */
-									call->cc.saved_ie_flags |= CC_SAVED_IE_HLC;
-									q931_append_ie_contents(&call->cc.saved_ie_contents,
-										iet);
-								}
-								break;
-							default:
-								break;
+	ie_def = q931_ie_find(ie);
+	if (ie_def) {
+		/* This is our baby */
+		if (ie_def->transmit) {
+			/* Prepend with CODE SHIFT IE if required */
+			if (*codeset != Q931_IE_CODESET(ie_def->ie)) {
+				/* Zero ahead first so the shift octet is not zeroed after it is written. */
+				q931_ie_zero_ahead(iet, maxlen, zeroed);
+				/* Locking shift to codeset 0 isn't possible */
+				iet->ie = Q931_IE_CODESET(ie_def->ie) | (Q931_IE_CODESET(ie_def->ie) ? Q931_LOCKING_SHIFT : Q931_NON_LOCKING_SHIFT);
+				have_shift = 1;
+				iet = (q931_ie *)((char *)iet + 1);
+				maxlen--;
+			}
+			else
+				have_shift = 0;
+			ies_count = ie_def->max_count;
+			if (ies_count == 0)
+				ies_count = INT_MAX;
+			order = 0;
+			total_res = 0;
+			do {
+				q931_ie_zero_ahead(iet, maxlen, zeroed);
+				iet->ie = ie;
+				res = ie_def->transmit(ie, ctrl, call, msgtype, iet, maxlen, ++order);
+				/* Error if res < 0 or ignored if res == 0 */
+				if (res < 0)
+					return res;
+				if (res > 0) {
+					if ((iet->ie & 0x80) == 0) /* Multibyte IE */
+						iet->len = res - 2;
+					if (msgtype == Q931_SETUP && *codeset == 0) {
+						switch (iet->ie) {
+						case Q931_BEARER_CAPABILITY:
+							if (!(call->cc.saved_ie_flags & CC_SAVED_IE_BC)) {
+								/* Save first BC ie contents for possible CC. */
+								call->cc.saved_ie_flags |= CC_SAVED_IE_BC;
+								q931_append_ie_contents(&call->cc.saved_ie_contents,
+									iet);
+							}
+							break;
+						case Q931_LOW_LAYER_COMPAT:
+							if (!(call->cc.saved_ie_flags & CC_SAVED_IE_LLC)) {
+								/* Save first LLC ie contents for possible CC. */
+								call->cc.saved_ie_flags |= CC_SAVED_IE_LLC;
+								q931_append_ie_contents(&call->cc.saved_ie_contents,
+									iet);
+							}
+							break;
+						case Q931_HIGH_LAYER_COMPAT:
+							if (!(call->cc.saved_ie_flags & CC_SAVED_IE_HLC)) {
+								/* Save first HLC ie contents for possible CC. */
+								call->cc.saved_ie_flags |= CC_SAVED_IE_HLC;
+								q931_append_ie_contents(&call->cc.saved_ie_contents,
+									iet);
 							}
+							break;
+						default:
+							break;
 						}
-						total_res += res;
-						maxlen -= res;
-						iet = (q931_ie *)((char *)iet + res);
 					}
-				} while (res > 0 && order < ies_count);
-				if (have_shift && total_res) {
-					if (Q931_IE_CODESET(ies[x].ie))
-						*codeset = Q931_IE_CODESET(ies[x].ie);
-					return total_res + 1; /* Shift is single-byte IE */
+					total_res += res;
+					maxlen -= res;
+					iet = (q931_ie *)((char *)iet + res);
 				}
-				return total_res;
-			} else {
-				pri_error(ctrl, "!! Don't know how to add IE %d (%s)\n", ie, ie2str(ie));
-				return -1;
+			} while (res > 0 && order < ies_count);
+			if (have_shift && total_res) {
+				if (Q931_IE_CODESET(ie_def->ie))
+					*codeset = Q931_IE_CODESET(ie_def->ie);
+				return total_res + 1; /* Shift is single-byte IE */
 			}
+			return total_res;
+		} else {
+			pri_error(ctrl, "!! Don't know how to add IE %d (%s)\n", ie, ie2str(ie));
+			return -1;
 		}
 	}
 	pri_error(ctrl, "!! Unknown IE %d (%s)\n", ie, ie2str(ie));
@@ -4921,9 +5426,9 @@ static char *disc2str(int disc)
  * \retval 0 on success.
  * \retval -1 on error.
  */
-static int q931_dump_header(struct pri *ctrl, int tei, q931_h *h, int len, char c)
+static int q931_dump_header(struct pri *ctrl, int tei, const q931_h *h, int len, char c)
 {
-	q931_mh *mh;
+	const q931_mh *mh;
 	int cref;
 
 	pri_message(ctrl, "%c Protocol Discriminator: %s (%d)  len=%d\n", c, disc2str(h->pd), h->pd, len);
@@ -4948,7 +5453,7 @@ static int q931_dump_header(struct pri *ctrl, int tei, q931_h *h, int len, char
 	}
 
 	/* Message header begins at the end of the call reference number */
-	mh = (q931_mh *)(h->contents + h->crlen);
+	mh = (const q931_mh *)(h->contents + h->crlen);
 	switch (h->pd) {
 	case MAINTENANCE_PROTOCOL_DISCRIMINATOR_1:
 	case MAINTENANCE_PROTOCOL_DISCRIMINATOR_2:
@@ -4998,9 +5503,9 @@ static void q931_to_q921_passing_dump(struct pri *ctrl, int tei, q931_h *h, int
  *
  * \return Nothing
  */
-void q931_dump(struct pri *ctrl, int tei, q931_h *h, int len, int txrx)
+void q931_dump(struct pri *ctrl, int tei, const q931_h *h, int len, int txrx)
 {
-	q931_mh *mh;
+	const q931_mh *mh;
 	char c;
 	int x;
 	int r;
@@ -5009,7 +5514,7 @@ void q931_dump(struct pri *ctrl, int tei, q931_h *h, int len, int txrx)
 
 	c = txrx ? '>' : '<';
 
-	if (!(ctrl->debug & (PRI_DEBUG_Q921_DUMP | PRI_DEBUG_Q921_RAW))) {
+	if (!(PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q921_DUMP | PRI_DEBUG_Q921_RAW))) {
 		/* Put out a blank line if Q.921 is not dumping. */
 		pri_message(ctrl, "\n");
 	}
@@ -5018,18 +5523,18 @@ void q931_dump(struct pri *ctrl, int tei, q931_h *h, int len, int txrx)
 	}
 
 	/* Drop length of header, including call reference */
-	mh = (q931_mh *)(h->contents + h->crlen);
+	mh = (const q931_mh *)(h->contents + h->crlen);
 	len -= (h->crlen + 3);
 	codeset = cur_codeset = 0;
 	for (x = 0; x < len; x += r) {
-		r = ielen_checked((q931_ie *) (mh->data + x), len - x);
+		r = ielen_checked((const q931_ie *) (mh->data + x), len - x);
 		if (r < 0) {
 			/* We have garbage on the end of the packet. */
 			pri_message(ctrl, "Not enough room for codeset:%d ie:%d(%02x)\n", cur_codeset,
 				mh->data[x], mh->data[x]);
 			break;
 		}
-		q931_dumpie(ctrl, cur_codeset, (q931_ie *)(mh->data + x), c);
+		q931_dumpie(ctrl, cur_codeset, (const q931_ie *)(mh->data + x), c);
 		switch (mh->data[x] & 0xf8) {
 		case Q931_LOCKING_SHIFT:
 			if ((mh->data[x] & 7) > 0)
@@ -5046,13 +5551,12 @@ void q931_dump(struct pri *ctrl, int tei, q931_h *h, int len, int txrx)
 	}
 }
 
-static int q931_handle_ie(int codeset, struct pri *ctrl, q931_call *c, int msg, q931_ie *ie)
+static int q931_handle_ie(int codeset, struct pri *ctrl, q931_call *c, int msg, const q931_ie *ie)
 {
-	unsigned int x;
+	struct ie *ie_def;
 	int full_ie = Q931_FULL_IE(codeset, ie->ie);
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE)
-		pri_message(ctrl, "-- Processing IE %d (cs%d, %s)\n", ie->ie, codeset, ie2str(full_ie));
+	PRI_TRACE(ctrl, PRI_DEBUG_Q931_STATE, "-- Processing IE %d (cs%d, %s)\n", ie->ie, codeset, ie2str(full_ie));
 	if (msg == Q931_SETUP && codeset == 0) {
 		switch (ie->ie) {
 		case Q931_BEARER_CAPABILITY:
@@ -5080,15 +5584,13 @@ static int q931_handle_ie(int codeset, struct pri *ctrl, q931_call *c, int msg,
 			break;
 		}
 	}
-	for (x = 0; x < ARRAY_LEN(ies); ++x) {
-		if (full_ie == ies[x].ie) {
-			if (ies[x].receive)
-				return ies[x].receive(full_ie, ctrl, c, msg, ie, ielen(ie));
-			else {
-				if (ctrl->debug & PRI_DEBUG_Q931_ANOMALY)
-					pri_message(ctrl, "!! No handler for IE %d (cs%d, %s)\n", ie->ie, codeset, ie2str(full_ie));
-				return -1;
-			}
+	ie_def = q931_ie_find(full_ie);
+	if (ie_def) {
+		if (ie_def->receive)
+			return ie_def->receive(full_ie, ctrl, c, msg, ie, ielen(ie));
+		else {
+			PRI_TRACE(ctrl, PRI_DEBUG_Q931_ANOMALY, "!! No handler for IE %d (cs%d, %s)\n", ie->ie, codeset, ie2str(full_ie));
+			return -1;
 		}
 	}
 	pri_message(ctrl, "!! Unknown IE %d (cs%d)\n", ie->ie, codeset);
@@ -5138,19 +5640,20 @@ static void init_header(struct pri *ctrl, q931_call *call, unsigned char *buf, q
 	*mhb = mh;
 }
 
-static void q931_xmit(struct q921_link *link, q931_h *h, int len, int cr, int uiframe)
+static void q931_xmit(struct q921_link *link, q931_h *h, int len, int cr, int uiframe, int msgtype)
 {
 	struct pri *ctrl;
 
 	ctrl = link->ctrl;
 	ctrl->q931_txcount++;
+	++ctrl->stats.q931_tx_msg[msgtype & 0xff];
 	if (uiframe) {
 		if (link->tei != Q921_TEI_GROUP) {
 			pri_error(ctrl, "Huh?! Attempting to send UI-frame on TEI %d\n", link->tei);
 			return;
 		}
 		q921_transmit_uiframe(link, h, len);
-		if (ctrl->debug & PRI_DEBUG_Q931_DUMP) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_DUMP)) {
 			/*
 			 * The transmit operation might dump the Q.921 header, so logging
 			 * the Q.931 message body after the transmit puts the sections of
@@ -5166,7 +5669,7 @@ static void q931_xmit(struct q921_link *link, q931_h *h, int len, int cr, int ui
 		 * actually get sent a few seconds later.  Q.921 will dump the
 		 * Q.931 message as appropriate at that time.
 		 */
-		if (ctrl->debug & PRI_DEBUG_Q931_DUMP) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_DUMP)) {
 			q931_to_q921_passing_dump(ctrl, link->tei, h, len);
 		}
 		q921_transmit_iframe(link, h, len, cr);
@@ -5199,6 +5702,7 @@ static int send_message(struct pri *ctrl, q931_call *call, int msgtype, int ies[
 	int x;
 	int codeset;
 	int uiframe;
+	u_int8_t *zeroed;
 
 	if (call->outboundbroadcast && call->master_call == call && msgtype != Q931_SETUP) {
 		pri_error(ctrl,
@@ -5214,14 +5718,15 @@ static int send_message(struct pri *ctrl, q931_call *call, int msgtype, int ies[
 		return -1;
 	}
 
-	memset(buf, 0, sizeof(buf));
 	len = sizeof(buf);
 	init_header(ctrl, call, buf, &h, &mh, &len, (msgtype >> 8));
 	mh->msg = msgtype & 0x00ff;
+	/* The header is completely written so the buffer is zeroed only as the ies are added. */
+	zeroed = mh->data;
 	x=0;
 	codeset = 0;
 	while(ies[x] > -1) {
-		res = add_ie(ctrl, call, mh->msg, ies[x], (q931_ie *)(mh->data + offset), len, &codeset);
+		res = add_ie(ctrl, call, mh->msg, ies[x], (q931_ie *)(mh->data + offset), len, &codeset, &zeroed);
 		if (res < 0) {
 			pri_error(ctrl, "!! Unable to add IE '%s'\n", ie2str(ies[x]));
 			return -1;
@@ -5269,14 +5774,14 @@ static int send_message(struct pri *ctrl, q931_call *call, int msgtype, int ies[
 		default:
 			break;
 		}
-		if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 			/* This message is only interesting for NT PTMP mode. */
 			pri_message(ctrl,
 				"Sending message for call %p on call->link: %p with TEI/SAPI %d/%d\n",
 				call, call->link, call->link->tei, call->link->sapi);
 		}
 	}
-	q931_xmit(call->link, h, len, 1, uiframe);
+	q931_xmit(call->link, h, len, 1, uiframe, msgtype);
 	call->acked = 1;
 	return 0;
 }
@@ -5909,7 +6414,7 @@ static void pri_connect_timeout(void *data)
 	struct q931_call *c = data;
 	struct pri *ctrl = c->pri;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE)
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE))
 		pri_message(ctrl, "Timed out looking for connect acknowledge\n");
 	c->retranstimer = 0;
 	q931_disconnect(ctrl, c, PRI_CAUSE_NORMAL_CLEARING);
@@ -5921,7 +6426,7 @@ static void pri_release_timeout(void *data)
 	struct q931_call *c = data;
 	struct pri *ctrl = c->pri;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE)
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE))
 		pri_message(ctrl, "Timed out looking for release complete\n");
 	c->t308_timedout++;
 	c->retranstimer = 0;
@@ -5939,7 +6444,7 @@ static void pri_release_finaltimeout(void *data)
 
 	c->retranstimer = 0;
 	c->alive = 1;
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE)
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE))
 		pri_message(ctrl, "Final time-out looking for release complete\n");
 	c->t308_timedout++;
 	c->ourcallstate = Q931_CALL_STATE_NULL;
@@ -5965,7 +6470,7 @@ static void pri_disconnect_timeout(void *data)
 	struct q931_call *c = data;
 	struct pri *ctrl = c->pri;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE)
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE))
 		pri_message(ctrl, "Timed out looking for release\n");
 	c->retranstimer = 0;
 	c->alive = 1;
@@ -6286,7 +6791,7 @@ static void t303_expiry(void *data)
 	struct pri *ctrl = c->pri;
 	int res;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "T303 timed out.  cref:%d\n", c->cr);
 	}
 
@@ -6580,7 +7085,7 @@ static void q931_hold_timeout(void *data)
 	struct q931_call *master = call->master_call;
 	struct pri *ctrl = call->pri;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "Time-out waiting for HOLD response\n");
 	}
 
@@ -6780,7 +7285,7 @@ static void q931_retrieve_timeout(void *data)
 	struct q931_call *master = call->master_call;
 	struct pri *ctrl = call->pri;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "Time-out waiting for RETRIEVE response\n");
 	}
 
@@ -7011,7 +7516,7 @@ static int __q931_hangup(struct pri *ctrl, q931_call *c, int cause)
 	if (!ctrl || !c) {
 		return -1;
 	}
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl,
 			DBGHEAD "ourstate %s, peerstate %s, hold-state %s\n", DBGINFO,
 			q931_call_state_str(c->ourcallstate),
@@ -7193,7 +7698,7 @@ int q931_hangup(struct pri *ctrl, q931_call *call, int cause)
 		if (call->master_call == call) {
 			int slaves;
 
-			if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 				pri_message(ctrl, DBGHEAD "Hangup master cref:%d\n", DBGINFO, call->cr);
 			}
 
@@ -7209,7 +7714,7 @@ int q931_hangup(struct pri *ctrl, q931_call *call, int cause)
 				 * No need for fake clearing to be running anymore.
 				 * Will this actually happen?
 				 */
-				if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+				if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 					pri_message(ctrl, "Fake clearing request cancelled.  cref:%d\n",
 						call->cr);
 				}
@@ -7221,7 +7726,7 @@ int q931_hangup(struct pri *ctrl, q931_call *call, int cause)
 			call->master_hanging_up = 1;
 			for (i = 0; i < ARRAY_LEN(call->subcalls); ++i) {
 				if (call->subcalls[i]) {
-					if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+					if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 						pri_message(ctrl, DBGHEAD "Hanging up %d, winner:%d subcall:%p\n",
 							DBGINFO, i, call->pri_winner, call->subcalls[i]);
 					}
@@ -7235,7 +7740,7 @@ int q931_hangup(struct pri *ctrl, q931_call *call, int cause)
 			call->master_hanging_up = 0;
 
 			slaves = q931_get_subcall_count(call);
-			if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 				pri_message(ctrl, DBGHEAD "Remaining slaves %d\n", DBGINFO, slaves);
 			}
 
@@ -7249,13 +7754,13 @@ int q931_hangup(struct pri *ctrl, q931_call *call, int cause)
 			}
 			return 0;
 		} else {
-			if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 				pri_message(ctrl, DBGHEAD "Hangup slave cref:%d\n", DBGINFO, call->cr);
 			}
 			return __q931_hangup(ctrl, call, cause);
 		}
 	} else {
-		if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 			pri_message(ctrl, DBGHEAD "Hangup other cref:%d\n", DBGINFO, call->cr);
 		}
 		return __q931_hangup(ctrl, call, cause);
@@ -7263,7 +7768,7 @@ int q931_hangup(struct pri *ctrl, q931_call *call, int cause)
 	return 0;
 }
 
-static int prepare_to_handle_maintenance_message(struct pri *ctrl, q931_mh *mh, q931_call *c)
+static int prepare_to_handle_maintenance_message(struct pri *ctrl, const q931_mh *mh, q931_call *c)
 {
 	if ((!ctrl) || (!mh) || (!c)) {
 		return -1;
@@ -7294,7 +7799,7 @@ static int prepare_to_handle_maintenance_message(struct pri *ctrl, q931_mh *mh,
 	return 0;
 }
 
-static int prepare_to_handle_q931_message(struct pri *ctrl, q931_mh *mh, q931_call *c)
+static int prepare_to_handle_q931_message(struct pri *ctrl, const q931_mh *mh, q931_call *c)
 {
 	if ((!ctrl) || (!mh) || (!c)) {
 		return -1;
@@ -7302,7 +7807,7 @@ static int prepare_to_handle_q931_message(struct pri *ctrl, q931_mh *mh, q931_ca
 	
 	switch(mh->msg) {
 	case Q931_RESTART:
-		if (ctrl->debug & PRI_DEBUG_Q931_STATE)
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE))
 			pri_message(ctrl, "-- Processing Q.931 Restart\n");
 		/* Reset information */
 		c->channelno = -1;
@@ -7321,7 +7826,7 @@ static int prepare_to_handle_q931_message(struct pri *ctrl, q931_mh *mh, q931_ca
 		}
 		break;
 	case Q931_SETUP:
-		if (ctrl->debug & PRI_DEBUG_Q931_STATE)
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE))
 			pri_message(ctrl, "-- Processing Q.931 Call Setup\n");
 		c->cc.saved_ie_contents.length = 0;
 		c->cc.saved_ie_flags = 0;
@@ -7513,6 +8018,7 @@ static struct q931_call *q931_get_subcall(struct q921_link *link, struct q931_ca
 	struct q931_call *cur;
 	struct pri *ctrl;
 	int firstfree = -1;
+	int slab_owned;
 
 	ctrl = link->ctrl;
 
@@ -7533,15 +8039,19 @@ static struct q931_call *q931_get_subcall(struct q921_link *link, struct q931_ca
 	}
 
 	/* Create new subcall. */
-	cur = malloc(sizeof(*cur));
+	cur = q931_call_alloc(ctrl, 0);
 	if (!cur) {
 		pri_error(ctrl, "Unable to allocate call\n");
 		return NULL;
 	}
+	slab_owned = cur->slab_owned;
 	*cur = *master_call;
+	cur->slab_owned = slab_owned;
 	//cur->pri = ctrl;/* We get this assignment for free. */
 	cur->link = link;
 	cur->next = NULL;
+	cur->prev = NULL;
+	cur->serial = q931_call_serial_next(ctrl);
 	cur->apdus = NULL;
 	cur->bridged_call = NULL;
 	//cur->master_call = master_call; /* We get this assignment for free. */
@@ -7564,9 +8074,14 @@ static struct q931_call *q931_get_subcall(struct q921_link *link, struct q931_ca
 	cur->ourcallstate = Q931_CALL_STATE_CALL_INITIATED;
 	cur->peercallstate = Q931_CALL_STATE_CALL_PRESENT;
 
+	if (q931_call_hash_add(&ctrl->callindex->ptr, cur, q931_call_key_ptr)) {
+		pri_error(ctrl, "Unable to allocate call\n");
+		q931_call_release(ctrl, cur);
+		return NULL;
+	}
 	master_call->subcalls[firstfree] = cur;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "Adding subcall %p for TEI %d to call %p at position %d\n",
 			cur, link->tei, master_call, firstfree);
 	}
@@ -7574,12 +8089,13 @@ static struct q931_call *q931_get_subcall(struct q921_link *link, struct q931_ca
 	return cur;
 }
 
-int q931_receive(struct q921_link *link, q931_h *h, int len)
+int q931_receive(struct q921_link *link, const q931_h *h, int len)
 {
-	q931_mh *mh;
+	const q931_mh *mh;
 	struct q931_call *c;
 	struct pri *ctrl;
-	q931_ie *ie;
+	const q931_ie *ie;
+	struct msgtype *msg_def;
 	unsigned int x;
 	int y;
 	int res;
@@ -7592,6 +8108,7 @@ int q931_receive(struct q921_link *link, q931_h *h, int len)
 	int allow_event;
 	int allow_posthandle;
 	enum mandatory_ie_status mand_status;
+	unsigned char ack[1024];
 
 	ctrl = link->ctrl;
 	memset(last_ie, 0, sizeof(last_ie));
@@ -7600,6 +8117,7 @@ int q931_receive(struct q921_link *link, q931_h *h, int len)
 		/* Message too short for supported protocols. */
 		return -1;
 	}
+	++ctrl->stats.q931_rx_msg[h->contents[h->crlen]];
 	switch (h->pd) {
 	case MAINTENANCE_PROTOCOL_DISCRIMINATOR_1:
 	case MAINTENANCE_PROTOCOL_DISCRIMINATOR_2:
@@ -7610,8 +8128,13 @@ int q931_receive(struct q921_link *link, q931_h *h, int len)
 			/* This is the weird maintenance stuff.  We majorly
 			   KLUDGE this by changing byte 4 from a 0xf (SERVICE)
 			   to a 0x7 (SERVICE ACKNOWLEDGE) */
-			h->raw[h->crlen + 2] -= 0x8;
-			q931_xmit(link, h, len, 1, 0);
+			/* The received message belongs to the caller so modify a copy. */
+			if (sizeof(ack) < len) {
+				return -1;
+			}
+			memcpy(ack, h, len);
+			((q931_h *) ack)->raw[h->crlen + 2] -= 0x8;
+			q931_xmit(link, (q931_h *) ack, len, 1, 0, h->contents[h->crlen] - 0x8);
 			return 0;
 		}
 		break;
@@ -7639,17 +8162,15 @@ int q931_receive(struct q921_link *link, q931_h *h, int len)
 		}
 	}
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
-		pri_message(ctrl,
-			"Received message for call %p on link %p TEI/SAPI %d/%d\n",
-			c, link, link->tei, link->sapi);
-	}
+	PRI_TRACE(ctrl, PRI_DEBUG_Q931_STATE,
+		"Received message for call %p on link %p TEI/SAPI %d/%d\n",
+		c, link, link->tei, link->sapi);
 
 	/* Preliminary handling */
 	ctrl->facility.count = 0;
 	c->connected_number_in_message = 0;
 	c->redirecting_number_in_message = 0;
-	mh = (q931_mh *)(h->contents + h->crlen);
+	mh = (const q931_mh *)(h->contents + h->crlen);
 	switch (h->pd) {
 	case MAINTENANCE_PROTOCOL_DISCRIMINATOR_1:
 	case MAINTENANCE_PROTOCOL_DISCRIMINATOR_2:
@@ -7673,11 +8194,9 @@ int q931_receive(struct q921_link *link, q931_h *h, int len)
 
 	/* Determine which ies are mandatory for this message. */
 	memset(mandies, 0, sizeof(mandies));
-	for (x = 0; x < ARRAY_LEN(msgs); ++x)  {
-		if (msgs[x].msgnum == mh->msg) {
-			memcpy(mandies, msgs[x].mandies, sizeof(mandies));
-			break;
-		}
+	msg_def = q931_msg_find(mh->msg);
+	if (msg_def) {
+		memcpy(mandies, msg_def->mandies, sizeof(mandies));
 	}
 	for (x = 0; x < ARRAY_LEN(mandies); ++x) {
 		if (mandies[x]) {
@@ -7702,7 +8221,7 @@ int q931_receive(struct q921_link *link, q931_h *h, int len)
 	len -= (h->crlen + 3);
 	codeset = cur_codeset = 0;
 	for (x = 0; x < len; x += r) {
-		ie = (q931_ie *)(mh->data + x);
+		ie = (const q931_ie *)(mh->data + x);
 		r = ielen_checked(ie, len - x);
 		if (r < 0) {
 			/* We have garbage on the end of the packet. */
@@ -7729,10 +8248,10 @@ int q931_receive(struct q921_link *link, q931_h *h, int len)
 		case Q931_LOCKING_SHIFT:
 			y = ie->ie & 7;	/* Requested codeset */
 			/* Locking shifts couldn't go to lower codeset, and couldn't follows non-locking shifts - verify this */
-			if ((cur_codeset != codeset) && (ctrl->debug & PRI_DEBUG_Q931_ANOMALY))
+			if ((cur_codeset != codeset) && (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_ANOMALY)))
 				pri_message(ctrl, "XXX Locking shift immediately follows non-locking shift (from %d through %d to %d) XXX\n", codeset, cur_codeset, y);
 			if (y > 0) {
-				if ((y < codeset) && (ctrl->debug & PRI_DEBUG_Q931_ANOMALY))
+				if ((y < codeset) && (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_ANOMALY)))
 					pri_error(ctrl, "!! Trying to locked downshift codeset from %d to %d !!\n", codeset, y);
 				codeset = cur_codeset = y;
 			}
@@ -7748,8 +8267,7 @@ int q931_receive(struct q921_link *link, q931_h *h, int len)
 			/* Sanity check for IE code order */
 			if (!(ie->ie & 0x80)) {
 				if (last_ie[cur_codeset] > ie->ie) {
-					if ((ctrl->debug & PRI_DEBUG_Q931_ANOMALY))
-						pri_message(ctrl, "XXX Out-of-order IE %d at codeset %d (last was %d)\n", ie->ie, cur_codeset, last_ie[cur_codeset]);
+					PRI_TRACE(ctrl, PRI_DEBUG_Q931_ANOMALY, "XXX Out-of-order IE %d at codeset %d (last was %d)\n", ie->ie, cur_codeset, last_ie[cur_codeset]);
 				}
 				else
 					last_ie[cur_codeset] = ie->ie;
@@ -7759,8 +8277,7 @@ int q931_receive(struct q921_link *link, q931_h *h, int len)
 			case PRI_SWITCH_LUCENT5E:
 			case PRI_SWITCH_ATT4ESS:
 				if (cur_codeset != codeset) {
-					if ((ctrl->debug & PRI_DEBUG_Q931_DUMP))
-						pri_message(ctrl, "XXX Ignoring IE %d for temporary codeset %d XXX\n", ie->ie, cur_codeset);
+					PRI_TRACE(ctrl, PRI_DEBUG_Q931_DUMP, "XXX Ignoring IE %d for temporary codeset %d XXX\n", ie->ie, cur_codeset);
 					break;
 				}
 				/* Fall through */
@@ -7854,7 +8371,7 @@ int q931_receive(struct q921_link *link, q931_h *h, int len)
 	return res;
 }
 
-static int post_handle_maintenance_message(struct pri *ctrl, int protodisc, struct q931_mh *mh, struct q931_call *c)
+static int post_handle_maintenance_message(struct pri *ctrl, int protodisc, const struct q931_mh *mh, struct q931_call *c)
 {
 	/* Do some maintenance stuff */
 	if (((protodisc == MAINTENANCE_PROTOCOL_DISCRIMINATOR_1) && (mh->msg == ATT_SERVICE))
@@ -8070,7 +8587,7 @@ int q931_master_pass_event(struct pri *ctrl, struct q931_call *subcall, int msg_
  *
  * \return Nothing
  */
-static void nt_ptmp_handle_q931_message(struct pri *ctrl, struct q931_mh *mh, struct q931_call *subcall, int *allow_event, int *allow_posthandle)
+static void nt_ptmp_handle_q931_message(struct pri *ctrl, const struct q931_mh *mh, struct q931_call *subcall, int *allow_event, int *allow_posthandle)
 {
 	struct q931_call *master = subcall->master_call;
 	struct q931_call *winner = q931_get_subcall_winner(master);
@@ -8477,13 +8994,20 @@ void q931_cc_indirect(struct pri *ctrl, struct pri_cc_record *cc_record, void (*
  */
 struct q931_call *q931_find_link_id_call(struct pri *ctrl, int link_id)
 {
+	struct q931_call_hash *hash;
 	struct q931_call *cur;
 	struct q931_call *winner;
 	struct q931_call *match;
+	unsigned pos;
 
 	match = NULL;
-	for (cur = *ctrl->callpool; cur; cur = cur->next) {
-		if (cur->is_link_id_valid && cur->link_id == link_id) {
+	hash = &ctrl->callindex->link_id;
+	if (!hash->used) {
+		return NULL;
+	}
+	for (pos = q931_call_hash_home(hash, link_id); (cur = hash->slot[pos]);
+		pos = (pos + 1) & (hash->size - 1)) {
+		if (cur->link_id == link_id) {
 			/* Found the link_id call. */
 			winner = q931_find_winning_call(cur);
 			if (!winner) {
@@ -8652,56 +9176,43 @@ static int newcall_rel_comp_cause(struct q931_call *call)
 
 /*!
  * \internal
- * \brief Restart channel notify event for upper layer notify chain timeout.
+ * \brief Setup restart channel notify events for upper layer.
  *
- * \param data Callback data pointer.
+ * \param call Q.931 call leg.
+ *
+ * \note
+ * The event for the first channel is left in ctrl->ev and the
+ * events for the other channels are queued behind it.
  *
  * \return Nothing
  */
-static void q931_restart_notify_timeout(void *data)
+static void q931_restart_notify(struct q931_call *call)
 {
-	struct q931_call *call = data;
 	struct pri *ctrl = call->pri;
+	int channel;
+	int idx;
 
-	/* Create channel restart event to upper layer. */
-	call->channelno = call->restart.chan_no[call->restart.idx++];
-	ctrl->ev.e = PRI_EVENT_RESTART;
-	ctrl->ev.restart.channel = q931_encode_channel(call);
-	ctrl->schedev = 1;
-
-	/* Reschedule for next channel restart event needed. */
-	if (call->restart.idx < call->restart.count) {
-		call->restart.timer = pri_schedule_event(ctrl, 0, q931_restart_notify_timeout,
-			call);
-	} else {
-		/* No more restart events needed. */
-		call->restart.timer = 0;
+	call->channelno = call->restart.chan_no[0];
+	channel = q931_encode_channel(call);
 
-		/* Send back the Restart Acknowledge.  All channels are now restarted. */
-		if (call->slotmap != -1) {
-			/* Send slotmap format. */
-			call->channelno = -1;
-		}
-		restart_ack(ctrl, call);
+	/* Queue channel restart events to upper layer for the other channels. */
+	for (idx = 1; idx < call->restart.count; ++idx) {
+		call->channelno = call->restart.chan_no[idx];
+		ctrl->ev.e = PRI_EVENT_RESTART;
+		ctrl->ev.restart.channel = q931_encode_channel(call);
+		pri_event_enqueue(ctrl, &ctrl->ev);
 	}
-}
 
-/*!
- * \internal
- * \brief Setup restart channel notify events for upper layer.
- *
- * \param call Q.931 call leg.
- *
- * \return Nothing
- */
-static void q931_restart_notify(struct q931_call *call)
-{
-	struct pri *ctrl = call->pri;
+	/* Send back the Restart Acknowledge.  All channels are now restarted. */
+	if (call->slotmap != -1) {
+		/* Send slotmap format. */
+		call->channelno = -1;
+	}
+	restart_ack(ctrl, call);
 
-	/* Start notify chain. */
-	pri_schedule_del(ctrl, call->restart.timer);
-	call->restart.idx = 0;
-	q931_restart_notify_timeout(call);
+	/* Create channel restart event to upper layer for the first channel. */
+	ctrl->ev.e = PRI_EVENT_RESTART;
+	ctrl->ev.restart.channel = channel;
 }
 
 /*!
@@ -8721,7 +9232,7 @@ static void q931_restart_notify(struct q931_call *call)
  * \retval Q931_RES_HAVEEVENT if have an event.
  * \retval -1 on error.
  */
-static int post_handle_q931_message(struct pri *ctrl, struct q931_mh *mh, struct q931_call *c, enum mandatory_ie_status mand_status)
+static int post_handle_q931_message(struct pri *ctrl, const struct q931_mh *mh, struct q931_call *c, enum mandatory_ie_status mand_status)
 {
 	int res;
 	int changed;
@@ -8767,7 +9278,7 @@ static int post_handle_q931_message(struct pri *ctrl, struct q931_mh *mh, struct
 			ctrl->ev.e = PRI_EVENT_RESTART;
 			ctrl->ev.restart.channel = q931_encode_channel(c);
 		} else {
-			/* Start notify chain. */
+			/* Notify each channel restarted. */
 			q931_restart_notify(c);
 		}
 		return Q931_RES_HAVEEVENT;
@@ -9068,7 +9579,7 @@ static int post_handle_q931_message(struct pri *ctrl, struct q931_mh *mh, struct
 		}
 		/* Do nothing */
 		/* Also when the STATUS asks for the call of an unexisting reference send RELEASE_COMPLETE */
-		if ((ctrl->debug & PRI_DEBUG_Q931_ANOMALY) &&
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_ANOMALY) &&
 		    (c->cause != PRI_CAUSE_INTERWORKING)) 
 			pri_error(ctrl, "Received unsolicited status: %s\n", pri_cause2str(c->cause));
 		if (
@@ -9251,7 +9762,7 @@ static int post_handle_q931_message(struct pri *ctrl, struct q931_mh *mh, struct
 		default:
 			break;
 		}
-		if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 			if (ctrl->ev.hangup.call_held) {
 				pri_message(ctrl, "-- Found held call: %p cref:%d\n",
 					ctrl->ev.hangup.call_held, ctrl->ev.hangup.call_held->cr);
@@ -9535,7 +10046,7 @@ static int post_handle_q931_message(struct pri *ctrl, struct q931_mh *mh, struct
 			master_call = c->master_call;
 			switch (master_call->hold_state) {
 			case Q931_HOLD_STATE_HOLD_REQ:
-				if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+				if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 					pri_message(ctrl, "HOLD collision\n");
 				}
 				if (ctrl->localtype == PRI_NETWORK) {
@@ -9650,7 +10161,7 @@ static int post_handle_q931_message(struct pri *ctrl, struct q931_mh *mh, struct
 			master_call = c->master_call;
 			switch (master_call->hold_state) {
 			case Q931_HOLD_STATE_RETRIEVE_REQ:
-				if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+				if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 					pri_message(ctrl, "RETRIEVE collision\n");
 				}
 				if (ctrl->localtype == PRI_NETWORK) {
@@ -9798,7 +10309,7 @@ static int pri_internal_clear(struct q931_call *c)
 	ctrl->ev.hangup.call_active = NULL;
 	libpri_copy_string(ctrl->ev.hangup.useruserinfo, c->useruserinfo, sizeof(ctrl->ev.hangup.useruserinfo));
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, DBGHEAD "alive %d, hangupack %d\n", DBGINFO, c->alive,
 			c->sendhangupack);
 	}
@@ -9839,7 +10350,7 @@ static void pri_dl_down_timeout(void *data)
 	struct q931_call *c = data;
 	struct pri *ctrl = c->pri;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "T309 timed out waiting for data link re-establishment\n");
 	}
 
@@ -9858,7 +10369,7 @@ static void pri_dl_down_cancelcall(void *data)
 	struct q931_call *c = data;
 	struct pri *ctrl = c->pri;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "Cancel call after data link failure\n");
 	}
 
@@ -9929,7 +10440,7 @@ void q931_dl_event(struct q921_link *link, enum Q931_DL_EVENT event)
 
 	ctrl = link->ctrl;
 
-	if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 		pri_message(ctrl, "TEI=%d DL event: %s(%d)\n", link->tei,
 			q931_dl_event2str(event), event);
 	}
@@ -9970,7 +10481,7 @@ void q931_dl_event(struct q921_link *link, enum Q931_DL_EVENT event)
 
 			if (!(cur->cr & ~Q931_CALL_REFERENCE_FLAG)) {
 				/* Simply destroy the global call reference call record. */
-				if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+				if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 					pri_message(ctrl, "TEI=%d Destroying global call record\n",
 						link->tei);
 				}
@@ -9984,7 +10495,7 @@ void q931_dl_event(struct q921_link *link, enum Q931_DL_EVENT event)
 			 * immediately after the Q931_DL_EVENT_DL_RELEASE_xxx or after a
 			 * timeout of 0.
 			 */
-			if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 				pri_message(ctrl, "Cancel call cref=%d on channel %d in state %d (%s)\n",
 					call->cr, call->channelno, call->ourcallstate,
 					q931_call_state_str(call->ourcallstate));
@@ -10043,7 +10554,7 @@ void q931_dl_event(struct q921_link *link, enum Q931_DL_EVENT event)
 				 * NOTE: cur != call when we have a winning subcall.
 				 */
 				if (!cur->retranstimer || !call->retranstimer) {
-					if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+					if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 						pri_message(ctrl, "Start T309 for call cref=%d on channel %d\n",
 							call->cr, call->channelno);
 					}
@@ -10062,7 +10573,7 @@ void q931_dl_event(struct q921_link *link, enum Q931_DL_EVENT event)
 				 * because there are likely messages in flight when this link
 				 * went down that could leave the call in an unknown/stuck state.
 				 */
-				if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+				if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 					pri_message(ctrl,
 						"Cancel call cref=%d on channel %d in state %d (%s)\n",
 						call->cr, call->channelno, call->ourcallstate,
@@ -10111,7 +10622,7 @@ void q931_dl_event(struct q921_link *link, enum Q931_DL_EVENT event)
 			case Q931_CALL_STATE_ACTIVE:
 				/* NOTE: Only a winning subcall can get to the active state. */
 				if (pri_schedule_check(ctrl, call->retranstimer, pri_dl_down_timeout, call)) {
-					if (ctrl->debug & PRI_DEBUG_Q931_STATE) {
+					if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_Q931_STATE)) {
 						pri_message(ctrl, "Stop T309 for call cref=%d on channel %d\n",
 							call->cr, call->channelno);
 					}
@@ -10161,8 +10672,18 @@ int q931_call_setcrv(struct pri *ctrl, q931_call *call, int crv, int callmode)
 {
 	/* Do not allow changing the dummy call reference */
 	if (!q931_is_dummy_call(call)) {
+		struct q931_call_hash *hash;
+		int indexed;
+
+		/* Rehash any call pool record with its new call reference. */
+		hash = &call->pri->callindex->cr;
+		indexed = q931_call_hash_del(hash, call, q931_call_key_cr);
 		call->cr = (crv << 3) & 0x7fff;
 		call->cr |= (callmode & 0x7);
+		if (indexed) {
+			/* Cannot fail since the index just had room for it. */
+			q931_call_hash_add(hash, call, q931_call_key_cr);
+		}
 	}
 	return 0;
 }
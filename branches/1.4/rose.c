@@ -2395,7 +2395,7 @@ static const unsigned char *rose_decode_invoke(struct pri *ctrl, unsigned tag,
 	struct asn1_oid oid;
 	unsigned local;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "INVOKE Component %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -2438,7 +2438,7 @@ static const unsigned char *rose_decode_invoke(struct pri *ctrl, unsigned tag,
 	} else {
 		msg->operation = ROSE_Unknown;
 	}
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  operationValue = %s\n", rose_operation2str(msg->operation));
 	}
 
@@ -2479,7 +2479,7 @@ static const unsigned char *rose_decode_result(struct pri *ctrl, unsigned tag,
 	struct asn1_oid oid;
 	unsigned local;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "RESULT Component %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -2494,7 +2494,7 @@ static const unsigned char *rose_decode_result(struct pri *ctrl, unsigned tag,
 	if (pos < seq_end && *pos != ASN1_INDEF_TERM) {
 		ASN1_CALL(pos, asn1_dec_tag(pos, seq_end, &tag));
 		ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  operation %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -2525,7 +2525,7 @@ static const unsigned char *rose_decode_result(struct pri *ctrl, unsigned tag,
 		} else {
 			msg->operation = ROSE_Unknown;
 		}
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  operationValue = %s\n",
 				rose_operation2str(msg->operation));
 		}
@@ -2571,7 +2571,7 @@ static const unsigned char *rose_decode_error(struct pri *ctrl, unsigned tag,
 	struct asn1_oid oid;
 	unsigned local;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "ERROR Component %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -2605,7 +2605,7 @@ static const unsigned char *rose_decode_error(struct pri *ctrl, unsigned tag,
 	} else {
 		msg->code = ROSE_ERROR_Unknown;
 	}
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  errorValue = %s\n", rose_error2str(msg->code));
 	}
 
@@ -2641,7 +2641,7 @@ static const unsigned char *rose_decode_reject(struct pri *ctrl, unsigned tag,
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "REJECT Component %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -2687,7 +2687,7 @@ static const unsigned char *rose_decode_reject(struct pri *ctrl, unsigned tag,
 		ASN1_DID_NOT_EXPECT_TAG(ctrl, tag);
 		return NULL;
 	}
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  problem = %s\n", rose_reject2str(msg->code));
 	}
 
@@ -2771,7 +2771,7 @@ static const unsigned char *fac_dec_nfe(struct pri *ctrl, const char *name, unsi
 	const unsigned char *save_pos;
 	int32_t value;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s NetworkFacilityExtension %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -2785,7 +2785,7 @@ static const unsigned char *fac_dec_nfe(struct pri *ctrl, const char *name, unsi
 	ASN1_CALL(pos, asn1_dec_tag(pos, seq_end, &tag));
 	if (tag == (ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1)) {
 		/* Remove EXPLICIT tag */
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -2812,7 +2812,7 @@ static const unsigned char *fac_dec_nfe(struct pri *ctrl, const char *name, unsi
 		ASN1_CALL(pos, asn1_dec_tag(pos, seq_end, &tag));
 		if (tag == (ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 3)) {
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -2918,7 +2918,7 @@ const unsigned char *facility_decode_header(struct pri *ctrl, const unsigned cha
 	}
 	++pos;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		asn1_dump(ctrl, pos, end);
 	}
 
@@ -460,7 +460,7 @@ static const unsigned char *rose_dec_NetworkPartyNumber(struct pri *ctrl,
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -498,7 +498,7 @@ const unsigned char *rose_dec_PartyNumber(struct pri *ctrl, const char *name,
 	unsigned tag, const unsigned char *pos, const unsigned char *end,
 	struct rosePartyNumber *party_number)
 {
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s PartyNumber\n", name);
 	}
 	party_number->ton = 0;	/* unknown */
@@ -574,7 +574,7 @@ static const unsigned char *rose_dec_UserSubaddress(struct pri *ctrl, const char
 
 	party_subaddress->type = 0;	/* UserSpecified */
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s UserSpecified %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -655,7 +655,7 @@ const unsigned char *rose_dec_PartySubaddress(struct pri *ctrl, const char *name
 	unsigned tag, const unsigned char *pos, const unsigned char *end,
 	struct rosePartySubaddress *party_subaddress)
 {
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s PartySubaddress\n", name);
 	}
 	switch (tag) {
@@ -696,7 +696,7 @@ const unsigned char *rose_dec_Address(struct pri *ctrl, const char *name, unsign
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s Address %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -741,12 +741,12 @@ const unsigned char *rose_dec_PresentedNumberUnscreened(struct pri *ctrl,
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s PresentedNumberUnscreened\n", name);
 	}
 	switch (tag) {
 	case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 0:
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -769,7 +769,7 @@ const unsigned char *rose_dec_PresentedNumberUnscreened(struct pri *ctrl,
 			pos, end));
 		break;
 	case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 3:
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -812,7 +812,7 @@ const unsigned char *rose_dec_NumberScreened(struct pri *ctrl, const char *name,
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s NumberScreened %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -849,7 +849,7 @@ const unsigned char *rose_dec_PresentedNumberScreened(struct pri *ctrl, const ch
 	unsigned tag, const unsigned char *pos, const unsigned char *end,
 	struct rosePresentedNumberScreened *party)
 {
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s PresentedNumberScreened\n", name);
 	}
 	switch (tag) {
@@ -902,7 +902,7 @@ const unsigned char *rose_dec_AddressScreened(struct pri *ctrl, const char *name
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s AddressScreened %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -948,7 +948,7 @@ const unsigned char *rose_dec_PresentedAddressScreened(struct pri *ctrl,
 	const char *name, unsigned tag, const unsigned char *pos, const unsigned char *end,
 	struct rosePresentedAddressScreened *party)
 {
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s PresentedAddressScreened\n", name);
 	}
 	switch (tag) {
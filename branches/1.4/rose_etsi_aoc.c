@@ -846,7 +846,7 @@ static const unsigned char *rose_dec_etsi_AOC_Time(struct pri *ctrl, const char
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s Time %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -890,7 +890,7 @@ static const unsigned char *rose_dec_etsi_AOC_Amount(struct pri *ctrl, const cha
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s Amount %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -934,7 +934,7 @@ static const unsigned char *rose_dec_etsi_AOC_RecordedCurrency(struct pri *ctrl,
 	const unsigned char *seq_end;
 	size_t str_len;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s RecordedCurrency %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -980,7 +980,7 @@ static const unsigned char *rose_dec_etsi_AOC_DurationCurrency(struct pri *ctrl,
 	const unsigned char *seq_end;
 	size_t str_len;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s DurationCurrency %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1047,7 +1047,7 @@ static const unsigned char *rose_dec_etsi_AOC_FlatRateCurrency(struct pri *ctrl,
 	const unsigned char *seq_end;
 	size_t str_len;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s FlatRateCurrency %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1093,7 +1093,7 @@ static const unsigned char *rose_dec_etsi_AOC_VolumeRateCurrency(struct pri *ctr
 	const unsigned char *seq_end;
 	size_t str_len;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s VolumeRateCurrency %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1143,7 +1143,7 @@ static const unsigned char *rose_dec_etsi_AOCSCurrencyInfo(struct pri *ctrl,
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s AOCSCurrencyInfo %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1218,7 +1218,7 @@ static const unsigned char *rose_dec_etsi_AOCSCurrencyInfoList(struct pri *ctrl,
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s AOCSCurrencyInfoList %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1266,7 +1266,7 @@ static const unsigned char *rose_dec_etsi_AOC_RecordedUnits(struct pri *ctrl,
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s RecordedUnits %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1328,7 +1328,7 @@ static const unsigned char *rose_dec_etsi_AOC_RecordedUnitsList(struct pri *ctrl
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s RecordedUnitsList %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1376,7 +1376,7 @@ static const unsigned char *rose_dec_etsi_AOC_ChargingAssociation(struct pri *ct
 	int explicit_offset;
 	const unsigned char *explicit_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s ChargingAssociation\n", name);
 	}
 	switch (tag) {
@@ -1389,7 +1389,7 @@ static const unsigned char *rose_dec_etsi_AOC_ChargingAssociation(struct pri *ct
 		charging->type = 1;	/* charged_number */
 
 		/* Remove EXPLICIT tag */
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1434,7 +1434,7 @@ static const unsigned char *rose_dec_etsi_AOCECurrencyInfo(struct pri *ctrl,
 	const unsigned char *seq_end;
 	const unsigned char *specific_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s AOCECurrencyInfo %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1448,7 +1448,7 @@ static const unsigned char *rose_dec_etsi_AOCECurrencyInfo(struct pri *ctrl,
 		break;
 	case ASN1_TAG_SEQUENCE:
 		currency_info->free_of_charge = 0;
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  specificCurrency %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1517,7 +1517,7 @@ static const unsigned char *rose_dec_etsi_AOCEChargingUnitInfo(struct pri *ctrl,
 	const unsigned char *seq_end;
 	const unsigned char *specific_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s AOCEChargingUnitInfo %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1531,7 +1531,7 @@ static const unsigned char *rose_dec_etsi_AOCEChargingUnitInfo(struct pri *ctrl,
 		break;
 	case ASN1_TAG_SEQUENCE:
 		charging_unit->free_of_charge = 0;
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  specificChargingUnits %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1748,7 +1748,7 @@ const unsigned char *rose_dec_etsi_AOCDCurrency_ARG(struct pri *ctrl, unsigned t
 	case ASN1_TAG_SEQUENCE:
 		aoc_d->type = 2;	/* specific_currency */
 
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  specificCurrency %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1820,7 +1820,7 @@ const unsigned char *rose_dec_etsi_AOCDChargingUnit_ARG(struct pri *ctrl, unsign
 	case ASN1_TAG_SEQUENCE:
 		aoc_d->type = 2;	/* specific_charging_units */
 
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  specificChargingUnits %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -820,7 +820,7 @@ static const unsigned char *rose_dec_etsi_CallInformation(struct pri *ctrl,
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s CallInformation %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -878,7 +878,7 @@ static const unsigned char *rose_dec_etsi_CallDetails(struct pri *ctrl, const ch
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s CallDetails %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -924,7 +924,7 @@ const unsigned char *rose_dec_etsi_StatusRequest_ARG(struct pri *ctrl, unsigned
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  StatusRequest %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1065,7 +1065,7 @@ const unsigned char *rose_dec_etsi_CCBSErase_ARG(struct pri *ctrl, unsigned tag,
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CCBSErase %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1125,7 +1125,7 @@ const unsigned char *rose_dec_etsi_CCBSRemoteUserFree_ARG(struct pri *ctrl, unsi
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CCBSRemoteUserFree %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1204,7 +1204,7 @@ const unsigned char *rose_dec_etsi_CCBSBFree_ARG(struct pri *ctrl, unsigned tag,
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CCBSBFree %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1283,7 +1283,7 @@ const unsigned char *rose_dec_etsi_CCBSStatusRequest_ARG(struct pri *ctrl, unsig
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CCBSStatusRequest %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1423,7 +1423,7 @@ static const unsigned char *rose_dec_etsi_CC_Request_RES_Backend(struct pri *ctr
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CC%sRequest %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1506,7 +1506,7 @@ static const unsigned char *rose_dec_etsi_CC_Interrogate_ARG_Backend(struct pri
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CC%sInterrogate %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1603,7 +1603,7 @@ static const unsigned char *rose_dec_etsi_CC_Interrogate_RES_Backend(struct pri
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CC%sInterrogate %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1690,7 +1690,7 @@ static const unsigned char *rose_dec_etsi_CC_T_Request_ARG_Backend(struct pri *c
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CC%s-T-Request %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
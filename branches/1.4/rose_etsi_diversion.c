@@ -653,7 +653,7 @@ static const unsigned char *rose_dec_etsi_ServedUserNumber(struct pri *ctrl,
 	const char *name, unsigned tag, const unsigned char *pos, const unsigned char *end,
 	struct rosePartyNumber *served_user_number)
 {
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s ServedUserNumber\n", name);
 	}
 	if (tag == ASN1_TYPE_NULL) {
@@ -691,7 +691,7 @@ static const unsigned char *rose_dec_etsi_IntResult(struct pri *ctrl, const char
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s IntResult %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -743,7 +743,7 @@ static const unsigned char *rose_dec_etsi_IntResultList(struct pri *ctrl,
 	int set_offset;
 	const unsigned char *set_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s IntResultList %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -790,7 +790,7 @@ static const unsigned char *rose_dec_etsi_ServedUserNumberList(struct pri *ctrl,
 	int set_offset;
 	const unsigned char *set_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s ServedUserNumberList %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -838,7 +838,7 @@ const unsigned char *rose_dec_etsi_ActivationDiversion_ARG(struct pri *ctrl,
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  ActivationDiversion %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -893,7 +893,7 @@ const unsigned char *rose_dec_etsi_DeactivationDiversion_ARG(struct pri *ctrl,
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  DeactivationDiversion %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -944,7 +944,7 @@ const unsigned char *rose_dec_etsi_ActivationStatusNotificationDiv_ARG(struct pr
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  ActivationStatusNotificationDiv %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1000,7 +1000,7 @@ const unsigned char *rose_dec_etsi_DeactivationStatusNotificationDiv_ARG(struct
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  DeactivationStatusNotificationDiv %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1050,7 +1050,7 @@ const unsigned char *rose_dec_etsi_InterrogationDiversion_ARG(struct pri *ctrl,
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  InterrogationDiversion %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1128,7 +1128,7 @@ const unsigned char *rose_dec_etsi_DiversionInformation_ARG(struct pri *ctrl,
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  DiversionInformation %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1169,7 +1169,7 @@ const unsigned char *rose_dec_etsi_DiversionInformation_ARG(struct pri *ctrl,
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 0:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1184,7 +1184,7 @@ const unsigned char *rose_dec_etsi_DiversionInformation_ARG(struct pri *ctrl,
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1199,7 +1199,7 @@ const unsigned char *rose_dec_etsi_DiversionInformation_ARG(struct pri *ctrl,
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 2:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1214,7 +1214,7 @@ const unsigned char *rose_dec_etsi_DiversionInformation_ARG(struct pri *ctrl,
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 3:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1269,7 +1269,7 @@ const unsigned char *rose_dec_etsi_CallDeflection_ARG(struct pri *ctrl, unsigned
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CallDeflection %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1323,7 +1323,7 @@ const unsigned char *rose_dec_etsi_CallRerouting_ARG(struct pri *ctrl, unsigned
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CallRerouting %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1355,7 +1355,7 @@ const unsigned char *rose_dec_etsi_CallRerouting_ARG(struct pri *ctrl, unsigned
 	ASN1_CALL(pos, asn1_dec_tag(pos, seq_end, &tag));
 	ASN1_CHECK_TAG(ctrl, tag, tag,
 		ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1380,7 +1380,7 @@ const unsigned char *rose_dec_etsi_CallRerouting_ARG(struct pri *ctrl, unsigned
 		switch (tag) {
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 2:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1396,7 +1396,7 @@ const unsigned char *rose_dec_etsi_CallRerouting_ARG(struct pri *ctrl, unsigned
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 3:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1464,7 +1464,7 @@ const unsigned char *rose_dec_etsi_DivertingLegInformation1_ARG(struct pri *ctrl
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  DivertingLegInformation1 %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1522,7 +1522,7 @@ const unsigned char *rose_dec_etsi_DivertingLegInformation2_ARG(struct pri *ctrl
 	int32_t value;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  DivertingLegInformation2 %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1553,7 +1553,7 @@ const unsigned char *rose_dec_etsi_DivertingLegInformation2_ARG(struct pri *ctrl
 		switch (tag) {
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1568,7 +1568,7 @@ const unsigned char *rose_dec_etsi_DivertingLegInformation2_ARG(struct pri *ctrl
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 2:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
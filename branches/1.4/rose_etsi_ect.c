@@ -253,7 +253,7 @@ const unsigned char *rose_dec_etsi_EctInform_ARG(struct pri *ctrl, unsigned tag,
 	const unsigned char *seq_end;
 	int32_t value;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  EctInform %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -275,7 +275,7 @@ static const unsigned char *rose_dec_etsi_message_id(struct pri *ctrl, const cha
 	const unsigned char *seq_end;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s MessageID %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -325,7 +325,7 @@ const unsigned char *rose_dec_etsi_MWIActivate_ARG(struct pri *ctrl, unsigned ta
 	mwi_activate = &args->etsi.MWIActivate;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  MWIActivate %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -357,7 +357,7 @@ const unsigned char *rose_dec_etsi_MWIActivate_ARG(struct pri *ctrl, unsigned ta
 		switch (tag) {
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -371,7 +371,7 @@ const unsigned char *rose_dec_etsi_MWIActivate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 2:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -388,7 +388,7 @@ const unsigned char *rose_dec_etsi_MWIActivate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 3:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -402,7 +402,7 @@ const unsigned char *rose_dec_etsi_MWIActivate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 4:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -418,7 +418,7 @@ const unsigned char *rose_dec_etsi_MWIActivate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 5:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -433,7 +433,7 @@ const unsigned char *rose_dec_etsi_MWIActivate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 6:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -484,7 +484,7 @@ const unsigned char *rose_dec_etsi_MWIDeactivate_ARG(struct pri *ctrl, unsigned
 	mwi_deactivate = &args->etsi.MWIDeactivate;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  MWIDeactivate %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -555,7 +555,7 @@ const unsigned char *rose_dec_etsi_MWIIndicate_ARG(struct pri *ctrl, unsigned ta
 	mwi_indicate = &args->etsi.MWIIndicate;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  MWIIndicate %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -578,7 +578,7 @@ const unsigned char *rose_dec_etsi_MWIIndicate_ARG(struct pri *ctrl, unsigned ta
 		switch (tag) {
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -592,7 +592,7 @@ const unsigned char *rose_dec_etsi_MWIIndicate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 2:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -609,7 +609,7 @@ const unsigned char *rose_dec_etsi_MWIIndicate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 3:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -626,7 +626,7 @@ const unsigned char *rose_dec_etsi_MWIIndicate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 4:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -640,7 +640,7 @@ const unsigned char *rose_dec_etsi_MWIIndicate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 5:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -656,7 +656,7 @@ const unsigned char *rose_dec_etsi_MWIIndicate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 6:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
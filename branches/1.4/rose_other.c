@@ -138,7 +138,7 @@ const unsigned char *rose_dec_dms100_RLT_ThirdParty_ARG(struct pri *ctrl, unsign
 	rlt_third_party = &args->dms100.RLT_ThirdParty;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  RLT_ThirdParty %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -256,7 +256,7 @@ const unsigned char *rose_dec_ni2_InitiateTransfer_ARG(struct pri *ctrl, unsigne
 	initiate_transfer = &args->ni2.InitiateTransfer;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  InitiateTransfer %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
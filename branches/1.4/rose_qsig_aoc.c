@@ -733,7 +733,7 @@ static const unsigned char *rose_dec_qsig_AOC_Time(struct pri *ctrl, const char
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s Time %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -777,7 +777,7 @@ static const unsigned char *rose_dec_qsig_AOC_Amount(struct pri *ctrl, const cha
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s Amount %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -821,7 +821,7 @@ static const unsigned char *rose_dec_qsig_AOC_RecordedCurrency(struct pri *ctrl,
 	const unsigned char *seq_end;
 	size_t str_len;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s RecordedCurrency %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -867,7 +867,7 @@ static const unsigned char *rose_dec_qsig_AOC_DurationCurrency(struct pri *ctrl,
 	const unsigned char *seq_end;
 	size_t str_len;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s DurationCurrency %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -934,7 +934,7 @@ static const unsigned char *rose_dec_qsig_AOC_FlatRateCurrency(struct pri *ctrl,
 	const unsigned char *seq_end;
 	size_t str_len;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s FlatRateCurrency %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -980,7 +980,7 @@ static const unsigned char *rose_dec_qsig_AOC_VolumeRateCurrency(struct pri *ctr
 	const unsigned char *seq_end;
 	size_t str_len;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s VolumeRateCurrency %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1030,7 +1030,7 @@ static const unsigned char *rose_dec_qsig_AOCSCurrencyInfo(struct pri *ctrl,
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s AOCSCurrencyInfo %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1110,7 +1110,7 @@ static const unsigned char *rose_dec_qsig_AOCSCurrencyInfoList(struct pri *ctrl,
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s AOCSCurrencyInfoList %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1158,7 +1158,7 @@ static const unsigned char *rose_dec_qsig_AOC_ChargingAssociation(struct pri *ct
 	int explicit_offset;
 	const unsigned char *explicit_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s ChargingAssociation\n", name);
 	}
 	switch (tag) {
@@ -1171,7 +1171,7 @@ static const unsigned char *rose_dec_qsig_AOC_ChargingAssociation(struct pri *ct
 		charging->type = 1;	/* charged_number */
 
 		/* Remove EXPLICIT tag */
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1217,7 +1217,7 @@ const unsigned char *rose_dec_qsig_ChargeRequest_ARG(struct pri *ctrl, unsigned
 	charge_request = &args->qsig.ChargeRequest;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  ChargeRequest %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1226,7 +1226,7 @@ const unsigned char *rose_dec_qsig_ChargeRequest_ARG(struct pri *ctrl, unsigned
 	/* SEQUENCE SIZE(0..7) OF AdviceModeCombination */
 	ASN1_CALL(pos, asn1_dec_tag(pos, seq_end, &tag));
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  adviceModeCombinations %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1282,7 +1282,7 @@ const unsigned char *rose_dec_qsig_ChargeRequest_RES(struct pri *ctrl, unsigned
 	charge_request = &args->qsig.ChargeRequest;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  ChargeRequest %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1327,7 +1327,7 @@ const unsigned char *rose_dec_qsig_AocFinal_ARG(struct pri *ctrl, unsigned tag,
 	aoc_final = &args->qsig.AocFinal;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  AocFinal %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1345,7 +1345,7 @@ const unsigned char *rose_dec_qsig_AocFinal_ARG(struct pri *ctrl, unsigned tag,
 		break;
 	case ASN1_TAG_SEQUENCE:
 		aoc_final->type = 2;	/* specific_currency */
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  specificCurrency %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1394,7 +1394,7 @@ const unsigned char *rose_dec_qsig_AocFinal_ARG(struct pri *ctrl, unsigned tag,
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 2:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  finalArgExtension %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -1436,7 +1436,7 @@ const unsigned char *rose_dec_qsig_AocInterim_ARG(struct pri *ctrl, unsigned tag
 	aoc_interim = &args->qsig.AocInterim;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  AocInterim %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1454,7 +1454,7 @@ const unsigned char *rose_dec_qsig_AocInterim_ARG(struct pri *ctrl, unsigned tag
 		break;
 	case ASN1_TAG_SEQUENCE:
 		aoc_interim->type = 2;	/* specific_currency */
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  specificCurrency %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1513,7 +1513,7 @@ const unsigned char *rose_dec_qsig_AocRate_ARG(struct pri *ctrl, unsigned tag,
 	aoc_rate = &args->qsig.AocRate;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  AocRate %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1565,7 +1565,7 @@ const unsigned char *rose_dec_qsig_AocComplete_ARG(struct pri *ctrl, unsigned ta
 	aoc_complete = &args->qsig.AocComplete;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  AocComplete %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1594,7 +1594,7 @@ const unsigned char *rose_dec_qsig_AocComplete_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 2:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  completeArgExtension %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -1634,7 +1634,7 @@ const unsigned char *rose_dec_qsig_AocComplete_RES(struct pri *ctrl, unsigned ta
 	aoc_complete = &args->qsig.AocComplete;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  AocComplete %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1675,7 +1675,7 @@ const unsigned char *rose_dec_qsig_AocDivChargeReq_ARG(struct pri *ctrl, unsigne
 	aoc_div_charge_req = &args->qsig.AocDivChargeReq;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  AocDivChargeReq %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
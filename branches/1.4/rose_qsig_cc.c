@@ -442,7 +442,7 @@ static const unsigned char *rose_dec_qsig_CcExtension(struct pri *ctrl, const ch
 	int ext_offset;
 	const unsigned char *ext_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s CcExtension\n", name);
 	}
 	switch (tag & ~ASN1_PC_MASK) {
@@ -460,7 +460,7 @@ static const unsigned char *rose_dec_qsig_CcExtension(struct pri *ctrl, const ch
 		return NULL;
 	}
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -498,7 +498,7 @@ static const unsigned char *rose_dec_qsig_CcRequestArg(struct pri *ctrl,
 	const unsigned char *seq_end;
 	const unsigned char *save_pos;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s CcRequestArg %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -532,7 +532,7 @@ static const unsigned char *rose_dec_qsig_CcRequestArg(struct pri *ctrl,
 		switch (tag) {
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 10:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -546,7 +546,7 @@ static const unsigned char *rose_dec_qsig_CcRequestArg(struct pri *ctrl,
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 11:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -653,7 +653,7 @@ static const unsigned char *rose_dec_qsig_CcRequestRes(struct pri *ctrl,
 	const unsigned char *seq_end;
 	const unsigned char *save_pos;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s CcRequestRes %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -765,7 +765,7 @@ static const unsigned char *rose_dec_qsig_CcOptionalArg(struct pri *ctrl,
 	const unsigned char *seq_end;
 	const unsigned char *save_pos;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s CcOptionalArg\n", name);
 	}
 	if (tag != (ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 0)) {
@@ -774,7 +774,7 @@ static const unsigned char *rose_dec_qsig_CcOptionalArg(struct pri *ctrl,
 	}
 	cc_optional_arg->full_arg_present = 1;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  fullArg %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -806,7 +806,7 @@ static const unsigned char *rose_dec_qsig_CcOptionalArg(struct pri *ctrl,
 		switch (tag) {
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 10:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -820,7 +820,7 @@ static const unsigned char *rose_dec_qsig_CcOptionalArg(struct pri *ctrl,
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 11:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -377,7 +377,7 @@ const unsigned char *rose_dec_qsig_CallTransferIdentify_RES(struct pri *ctrl,
 	call_transfer_identify = &args->qsig.CallTransferIdentify;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CallTransferIdentify %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -424,7 +424,7 @@ const unsigned char *rose_dec_qsig_CallTransferInitiate_ARG(struct pri *ctrl,
 	call_transfer_initiate = &args->qsig.CallTransferInitiate;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CallTransferInitiate %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -470,7 +470,7 @@ const unsigned char *rose_dec_qsig_CallTransferSetup_ARG(struct pri *ctrl, unsig
 	call_transfer_setup = &args->qsig.CallTransferSetup;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CallTransferSetup %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -511,7 +511,7 @@ const unsigned char *rose_dec_qsig_CallTransferActive_ARG(struct pri *ctrl, unsi
 	call_transfer_active = &args->qsig.CallTransferActive;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CallTransferActive %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -549,7 +549,7 @@ const unsigned char *rose_dec_qsig_CallTransferActive_ARG(struct pri *ctrl, unsi
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 9:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 10:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  argumentExtension %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -591,7 +591,7 @@ const unsigned char *rose_dec_qsig_CallTransferComplete_ARG(struct pri *ctrl,
 	call_transfer_complete = &args->qsig.CallTransferComplete;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CallTransferComplete %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -640,7 +640,7 @@ const unsigned char *rose_dec_qsig_CallTransferComplete_ARG(struct pri *ctrl,
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 9:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 10:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  argumentExtension %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -680,7 +680,7 @@ const unsigned char *rose_dec_qsig_CallTransferUpdate_ARG(struct pri *ctrl, unsi
 	call_transfer_update = &args->qsig.CallTransferUpdate;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CallTransferUpdate %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -718,7 +718,7 @@ const unsigned char *rose_dec_qsig_CallTransferUpdate_ARG(struct pri *ctrl, unsi
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 9:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 10:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  argumentExtension %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -757,7 +757,7 @@ const unsigned char *rose_dec_qsig_SubaddressTransfer_ARG(struct pri *ctrl, unsi
 	subaddress_transfer = &args->qsig.SubaddressTransfer;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  SubaddressTransfer %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -814,7 +814,7 @@ const unsigned char *rose_dec_qsig_DummyArg_ARG(struct pri *ctrl, unsigned tag,
 		return NULL;
 	}
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -867,7 +867,7 @@ const unsigned char *rose_dec_qsig_DummyRes_RES(struct pri *ctrl, unsigned tag,
 		return NULL;
 	}
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -547,7 +547,7 @@ static const unsigned char *rose_dec_qsig_IntResult(struct pri *ctrl, const char
 	const unsigned char *seq_end;
 	const unsigned char *save_pos;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s IntResult %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -590,7 +590,7 @@ static const unsigned char *rose_dec_qsig_IntResult(struct pri *ctrl, const char
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 1:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 2:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  extension %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -628,7 +628,7 @@ static const unsigned char *rose_dec_qsig_IntResultList(struct pri *ctrl,
 	int set_offset;
 	const unsigned char *set_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s IntResultList %s\n", name, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -677,7 +677,7 @@ const unsigned char *rose_dec_qsig_ActivateDiversionQ_ARG(struct pri *ctrl, unsi
 	activate_diversion_q = &args->qsig.ActivateDiversionQ;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  ActivateDiversionQ %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -737,7 +737,7 @@ const unsigned char *rose_dec_qsig_DeactivateDiversionQ_ARG(struct pri *ctrl,
 	deactivate_diversion_q = &args->qsig.DeactivateDiversionQ;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  DeactivateDiversionQ %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -792,7 +792,7 @@ const unsigned char *rose_dec_qsig_InterrogateDiversionQ_ARG(struct pri *ctrl,
 	interrogate_diversion_q = &args->qsig.InterrogateDiversionQ;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  InterrogateDiversionQ %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -871,7 +871,7 @@ const unsigned char *rose_dec_qsig_CheckRestriction_ARG(struct pri *ctrl, unsign
 	check_restriction = &args->qsig.CheckRestriction;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CheckRestriction %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -923,7 +923,7 @@ const unsigned char *rose_dec_qsig_CallRerouting_ARG(struct pri *ctrl, unsigned
 	call_rerouting = &args->qsig.CallRerouting;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  CallRerouting %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -964,7 +964,7 @@ const unsigned char *rose_dec_qsig_CallRerouting_ARG(struct pri *ctrl, unsigned
 	ASN1_CALL(pos, asn1_dec_tag(pos, seq_end, &tag));
 	ASN1_CHECK_TAG(ctrl, tag, tag,
 		ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -984,7 +984,7 @@ const unsigned char *rose_dec_qsig_CallRerouting_ARG(struct pri *ctrl, unsigned
 	ASN1_CALL(pos, asn1_dec_tag(pos, seq_end, &tag));
 	if (tag == (ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 3)) {
 		/* Remove EXPLICIT tag */
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1004,7 +1004,7 @@ const unsigned char *rose_dec_qsig_CallRerouting_ARG(struct pri *ctrl, unsigned
 	/* Remove EXPLICIT tag */
 	ASN1_CHECK_TAG(ctrl, tag, tag,
 		ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 4);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1031,7 +1031,7 @@ const unsigned char *rose_dec_qsig_CallRerouting_ARG(struct pri *ctrl, unsigned
 		switch (tag) {
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 5:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1046,7 +1046,7 @@ const unsigned char *rose_dec_qsig_CallRerouting_ARG(struct pri *ctrl, unsigned
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 6:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1061,7 +1061,7 @@ const unsigned char *rose_dec_qsig_CallRerouting_ARG(struct pri *ctrl, unsigned
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 7:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1076,7 +1076,7 @@ const unsigned char *rose_dec_qsig_CallRerouting_ARG(struct pri *ctrl, unsigned
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 8:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1092,7 +1092,7 @@ const unsigned char *rose_dec_qsig_CallRerouting_ARG(struct pri *ctrl, unsigned
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 9:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 9:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 10:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  extension %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -1133,7 +1133,7 @@ const unsigned char *rose_dec_qsig_DivertingLegInformation1_ARG(struct pri *ctrl
 	diverting_leg_information_1 = &args->qsig.DivertingLegInformation1;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  DivertingLegInformation1 %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1187,7 +1187,7 @@ const unsigned char *rose_dec_qsig_DivertingLegInformation2_ARG(struct pri *ctrl
 	diverting_leg_information_2 = &args->qsig.DivertingLegInformation2;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  DivertingLegInformation2 %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1225,7 +1225,7 @@ const unsigned char *rose_dec_qsig_DivertingLegInformation2_ARG(struct pri *ctrl
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1240,7 +1240,7 @@ const unsigned char *rose_dec_qsig_DivertingLegInformation2_ARG(struct pri *ctrl
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 2:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1255,7 +1255,7 @@ const unsigned char *rose_dec_qsig_DivertingLegInformation2_ARG(struct pri *ctrl
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 3:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1270,7 +1270,7 @@ const unsigned char *rose_dec_qsig_DivertingLegInformation2_ARG(struct pri *ctrl
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 4:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1286,7 +1286,7 @@ const unsigned char *rose_dec_qsig_DivertingLegInformation2_ARG(struct pri *ctrl
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 5:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 5:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 6:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  extension %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -1330,7 +1330,7 @@ const unsigned char *rose_dec_qsig_DivertingLegInformation3_ARG(struct pri *ctrl
 	diverting_leg_information_3 = &args->qsig.DivertingLegInformation3;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  DivertingLegInformation3 %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -1354,7 +1354,7 @@ const unsigned char *rose_dec_qsig_DivertingLegInformation3_ARG(struct pri *ctrl
 		switch (tag) {
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 0:
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -1370,7 +1370,7 @@ const unsigned char *rose_dec_qsig_DivertingLegInformation3_ARG(struct pri *ctrl
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 1:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 1:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | ASN1_PC_CONSTRUCTED | 2:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  extension %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
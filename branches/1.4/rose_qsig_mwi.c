@@ -323,7 +323,7 @@ static const unsigned char *rose_dec_qsig_MsgCentreId(struct pri *ctrl, const ch
 	int explicit_offset;
 	const unsigned char *explicit_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s MsgCentreId\n", name);
 	}
 	switch (tag) {
@@ -336,7 +336,7 @@ static const unsigned char *rose_dec_qsig_MsgCentreId(struct pri *ctrl, const ch
 		msg_centre_id->type = 1;	/* partyNumber */
 
 		/* Remove EXPLICIT tag */
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -390,7 +390,7 @@ const unsigned char *rose_dec_qsig_MWIActivate_ARG(struct pri *ctrl, unsigned ta
 	mwi_activate = &args->qsig.MWIActivate;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  MWIActivateArg %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -436,7 +436,7 @@ const unsigned char *rose_dec_qsig_MWIActivate_ARG(struct pri *ctrl, unsigned ta
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 4:
 			/* Must be constructed but we will not check for it for simplicity. */
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -462,7 +462,7 @@ const unsigned char *rose_dec_qsig_MWIActivate_ARG(struct pri *ctrl, unsigned ta
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 6:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 7:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  argumentExt %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -503,7 +503,7 @@ const unsigned char *rose_dec_qsig_MWIDeactivate_ARG(struct pri *ctrl, unsigned
 	mwi_deactivate = &args->qsig.MWIDeactivate;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  MWIDeactivateArg %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -537,7 +537,7 @@ const unsigned char *rose_dec_qsig_MWIDeactivate_ARG(struct pri *ctrl, unsigned
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 3:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 4:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  argumentExt %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -578,7 +578,7 @@ const unsigned char *rose_dec_qsig_MWIInterrogate_ARG(struct pri *ctrl, unsigned
 	mwi_interrogate = &args->qsig.MWIInterrogate;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  MWIInterrogateArg %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -612,7 +612,7 @@ const unsigned char *rose_dec_qsig_MWIInterrogate_ARG(struct pri *ctrl, unsigned
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 3:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 4:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  argumentExt %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -655,7 +655,7 @@ static const unsigned char *rose_dec_qsig_MWIInterrogateResElt(struct pri *ctrl,
 	const unsigned char *seq_end;
 	const unsigned char *save_pos;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  MWIInterrogateResElt %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -697,7 +697,7 @@ static const unsigned char *rose_dec_qsig_MWIInterrogateResElt(struct pri *ctrl,
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 4:
 			/* Must be constructed but we will not check for it for simplicity. */
 			/* Remove EXPLICIT tag */
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  Explicit %s\n", asn1_tag2str(tag));
 			}
 			ASN1_CALL(pos, asn1_dec_length(pos, seq_end, &length));
@@ -722,7 +722,7 @@ static const unsigned char *rose_dec_qsig_MWIInterrogateResElt(struct pri *ctrl,
 			break;
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 6:
 		case ASN1_CLASS_CONTEXT_SPECIFIC | 7:
-			if (ctrl->debug & PRI_DEBUG_APDU) {
+			if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 				pri_message(ctrl, "  argumentExt %s\n", asn1_tag2str(tag));
 			}
 			/* Fixup will skip over the manufacturer extension information */
@@ -759,7 +759,7 @@ const unsigned char *rose_dec_qsig_MWIInterrogate_RES(struct pri *ctrl, unsigned
 	struct roseQsigMWIInterrogateRes *mwi_interrogate;
 
 	ASN1_CHECK_TAG(ctrl, tag, tag, ASN1_TAG_SEQUENCE);
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  MWIInterrogateRes %s\n", asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -262,7 +262,7 @@ static const unsigned char *rose_dec_qsig_NameSet(struct pri *ctrl, const char *
 	int seq_offset;
 	const unsigned char *seq_end;
 
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s NameSet %s\n", fname, asn1_tag2str(tag));
 	}
 	ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -303,7 +303,7 @@ const unsigned char *rose_dec_qsig_Name(struct pri *ctrl, const char *fname,
 	unsigned tag, const unsigned char *pos, const unsigned char *end,
 	struct roseQsigName *name)
 {
-	if (ctrl->debug & PRI_DEBUG_APDU) {
+	if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 		pri_message(ctrl, "  %s Name\n", fname);
 	}
 	name->char_set = 1;	/* default to iso8859-1 */
@@ -376,7 +376,7 @@ static const unsigned char *rose_dec_qsig_PartyName_ARG_Backend(struct pri *ctrl
 	const unsigned char *seq_end;
 
 	if (tag == ASN1_TAG_SEQUENCE) {
-		if (ctrl->debug & PRI_DEBUG_APDU) {
+		if (PRI_DEBUG_ON(ctrl, PRI_DEBUG_APDU)) {
 			pri_message(ctrl, "  %s %s\n", name, asn1_tag2str(tag));
 		}
 		ASN1_CALL(pos, asn1_dec_length(pos, end, &length));
@@ -36,9 +36,12 @@
 #include "libpri.h"
 #include "pri_internal.h"
 #include "rose.h"
+#include "asn1.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 
 /* ------------------------------------------------------------------- */
@@ -3046,6 +3049,383 @@ static void rose_test_exception(struct pri *ctrl, const char *name,
 		"************************************************************\n");
 }
 
+/* ------------------------------------------------------------------- */
+
+/*! Benchmark iterations of each operation if not given. */
+#define ROSE_BENCH_ITERATIONS	10000
+
+/*! \brief Benchmark totals of one switch type and operation. */
+struct rose_bench_stat {
+	/*! Switch type the messages were encoded for. */
+	int switchtype;
+	/*! ROSE component type. */
+	enum rose_component_type type;
+	/*! Operation, error, or reject code of the component. */
+	int code;
+	/*! Number of corpus messages of this kind. */
+	unsigned msgs;
+	/*! Total encoded length of the corpus messages. */
+	unsigned octets;
+	/*! Total ns/op of facility_encode_header() over the messages. */
+	double hdr_enc_ns;
+	/*! Total ns/op of rose_encode() over the messages. */
+	double enc_ns;
+	/*! Total ns/op of facility_decode_header() over the messages. */
+	double hdr_dec_ns;
+	/*! Total ns/op of rose_decode() over the messages. */
+	double dec_ns;
+	/*! Total octets allocated per op over the messages. */
+	double alloc_octets;
+};
+
+static struct rose_bench_stat rose_bench_stats[512];
+static unsigned rose_bench_num_stats;
+
+/*!
+ * Octets allocated so far.
+ * (Counted only in the rosebench build, which links with --wrap.  Stays zero otherwise.)
+ */
+static unsigned long rose_bench_allocated;
+
+#if defined(ROSE_BENCH_ALLOC)
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+	rose_bench_allocated += size;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	rose_bench_allocated += nmemb * size;
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	rose_bench_allocated += size;
+	return __real_realloc(ptr, size);
+}
+#endif	/* defined(ROSE_BENCH_ALLOC) */
+
+/*!
+ * \internal
+ * \brief Get the current time in nanoseconds.
+ *
+ * \return Monotonic time in ns.
+ */
+static double rose_bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*!
+ * \internal
+ * \brief Find the benchmark totals of the given message kind.
+ *
+ * \param ctrl D channel controller for diagnostic messages or global options.
+ * \param msg Message to find the totals for.
+ *
+ * \return Benchmark totals.
+ */
+static struct rose_bench_stat *rose_bench_stat_get(struct pri *ctrl,
+	const struct rose_message *msg)
+{
+	struct rose_bench_stat *stat;
+	unsigned index;
+	int code;
+
+	switch (msg->type) {
+	case ROSE_COMP_TYPE_INVOKE:
+		code = msg->component.invoke.operation;
+		break;
+	case ROSE_COMP_TYPE_RESULT:
+		code = msg->component.result.operation;
+		break;
+	case ROSE_COMP_TYPE_ERROR:
+		code = msg->component.error.code;
+		break;
+	case ROSE_COMP_TYPE_REJECT:
+		code = msg->component.reject.code;
+		break;
+	default:
+		code = 0;
+		break;
+	}
+
+	for (index = 0; index < rose_bench_num_stats; ++index) {
+		stat = &rose_bench_stats[index];
+		if (stat->switchtype == ctrl->switchtype && stat->type == msg->type
+			&& stat->code == code) {
+			return stat;
+		}
+	}
+	if (rose_bench_num_stats == ARRAY_LEN(rose_bench_stats)) {
+		/* Lump any more into the last entry. */
+		return &rose_bench_stats[rose_bench_num_stats - 1];
+	}
+	stat = &rose_bench_stats[rose_bench_num_stats++];
+	stat->switchtype = ctrl->switchtype;
+	stat->type = msg->type;
+	stat->code = code;
+	return stat;
+}
+
+/*!
+ * \internal
+ * \brief Time encoding and decoding the given message.
+ *
+ * \param ctrl D channel controller for diagnostic messages or global options.
+ * \param iterations Number of times to run each operation.
+ * \param header Facility message header data to encode.
+ * \param encode_msg Message data to encode.
+ *
+ * \return Nothing
+ */
+static void rose_bench_msg(struct pri *ctrl, unsigned iterations,
+	const struct fac_extension_header *header, const struct rose_message *encode_msg)
+{
+	struct rose_bench_stat *stat;
+	struct fac_extension_header decoded_header;
+	struct rose_message decoded_msg;
+	unsigned char *hdr_end = NULL;
+	unsigned char *enc_pos = NULL;
+	unsigned char *enc_end;
+	const unsigned char *dec_pos = NULL;
+	const unsigned char *dec_body = NULL;
+	unsigned long allocated;
+	unsigned count;
+	double start;
+	double hdr_enc;
+	double enc;
+	double hdr_dec;
+	double dec;
+
+	static unsigned char buf[1024];
+
+	allocated = rose_bench_allocated;
+	enc_end = buf + sizeof(buf);
+
+	start = rose_bench_now();
+	for (count = iterations; count--;) {
+		hdr_end = facility_encode_header(ctrl, buf, enc_end, header);
+	}
+	hdr_enc = rose_bench_now();
+	if (!hdr_end) {
+		pri_error(ctrl, "Error: Benchmark message failed to encode header\n");
+		return;
+	}
+	for (count = iterations; count--;) {
+		enc_pos = rose_encode(ctrl, hdr_end, enc_end, encode_msg);
+	}
+	enc = rose_bench_now();
+	if (!enc_pos) {
+		pri_error(ctrl, "Error: Benchmark message failed to encode ROSE\n");
+		return;
+	}
+	for (count = iterations; count--;) {
+		dec_body = facility_decode_header(ctrl, buf, enc_pos, &decoded_header);
+	}
+	hdr_dec = rose_bench_now();
+	if (!dec_body) {
+		pri_error(ctrl, "Error: Benchmark message failed to decode header\n");
+		return;
+	}
+	for (count = iterations; count--;) {
+		for (dec_pos = dec_body; dec_pos && dec_pos < enc_pos;) {
+			dec_pos = rose_decode(ctrl, dec_pos, enc_pos, &decoded_msg);
+		}
+	}
+	dec = rose_bench_now();
+	if (!dec_pos) {
+		pri_error(ctrl, "Error: Benchmark message failed to decode ROSE\n");
+		return;
+	}
+
+	stat = rose_bench_stat_get(ctrl, encode_msg);
+	++stat->msgs;
+	stat->octets += enc_pos - buf;
+	stat->hdr_enc_ns += (hdr_enc - start) / iterations;
+	stat->enc_ns += (enc - hdr_enc) / iterations;
+	stat->hdr_dec_ns += (hdr_dec - enc) / iterations;
+	stat->dec_ns += (dec - hdr_dec) / iterations;
+	stat->alloc_octets += (double) (rose_bench_allocated - allocated) / (4 * iterations);
+}
+
+/*!
+ * \internal
+ * \brief Time decoding an ASN.1 primitive.
+ *
+ * \param ctrl D channel controller for diagnostic messages or global options.
+ * \param iterations Number of times to decode the primitive.
+ * \param name Primitive name to report.
+ * \param pos Encoded primitive.
+ * \param end End of encoded primitive.
+ *
+ * \return Nothing
+ */
+static void rose_bench_asn1(struct pri *ctrl, unsigned iterations, const char *name,
+	const unsigned char *pos, const unsigned char *end)
+{
+	const unsigned char *dec_pos = NULL;
+	unsigned char str[32];
+	struct asn1_oid oid;
+	unsigned long allocated;
+	unsigned count;
+	unsigned tag;
+	size_t str_len;
+	int32_t value;
+	double start;
+	double stop;
+
+	allocated = rose_bench_allocated;
+	start = rose_bench_now();
+	for (count = iterations; count--;) {
+		dec_pos = asn1_dec_tag(pos, end, &tag);
+		if (!dec_pos) {
+			break;
+		}
+		switch (tag) {
+		case ASN1_TYPE_BOOLEAN:
+			dec_pos = asn1_dec_boolean(ctrl, name, tag, dec_pos, end, &value);
+			break;
+		case ASN1_TYPE_INTEGER:
+			dec_pos = asn1_dec_int(ctrl, name, tag, dec_pos, end, &value);
+			break;
+		case ASN1_TYPE_NULL:
+			dec_pos = asn1_dec_null(ctrl, name, tag, dec_pos, end);
+			break;
+		case ASN1_TYPE_OBJECT_IDENTIFIER:
+			dec_pos = asn1_dec_oid(ctrl, name, tag, dec_pos, end, &oid);
+			break;
+		case ASN1_TYPE_OCTET_STRING:
+			dec_pos = asn1_dec_string_bin(ctrl, name, tag, dec_pos, end, sizeof(str),
+				str, &str_len);
+			break;
+		default:
+			dec_pos = asn1_dec_string_max(ctrl, name, tag, dec_pos, end, sizeof(str),
+				str, &str_len);
+			break;
+		}
+		if (!dec_pos) {
+			break;
+		}
+	}
+	stop = rose_bench_now();
+	if (!dec_pos) {
+		pri_error(ctrl, "Error: Benchmark %s failed to decode\n", name);
+		return;
+	}
+	pri_message(ctrl, "%-24s %8u %10.1f %10.1f\n", name, (unsigned) (end - pos),
+		(stop - start) / iterations,
+		(double) (rose_bench_allocated - allocated) / iterations);
+}
+
+/*!
+ * \internal
+ * \brief Benchmark the ROSE message corpus and the ASN.1 primitives.
+ *
+ * \param ctrl D channel controller for diagnostic messages or global options.
+ * \param iterations Number of times to run each operation.
+ *
+ * \return Nothing
+ */
+static void rose_bench(struct pri *ctrl, unsigned iterations)
+{
+	static const struct asn1_oid oid = {
+		.num_values = 5,
+		.value = { 40 * 1 + 3, 12, 9, 0, 7 },
+	};
+	static const unsigned char octets[] = "\x01\x02\x03\x04\x05\x06\x07\x08";
+	struct rose_bench_stat *stat;
+	unsigned char buf[64];
+	unsigned char *end;
+	const char *name;
+	unsigned index;
+
+	/* Decoding must not produce any diagnostic output. */
+	ctrl->debug = 0;
+	if (!iterations) {
+		iterations = ROSE_BENCH_ITERATIONS;
+	}
+
+	ctrl->switchtype = PRI_SWITCH_EUROISDN_E1;
+	for (index = 0; index < ARRAY_LEN(rose_etsi_msgs); ++index) {
+		rose_bench_msg(ctrl, iterations, &fac_headers[0], &rose_etsi_msgs[index]);
+	}
+	ctrl->switchtype = PRI_SWITCH_QSIG;
+	for (index = 0; index < ARRAY_LEN(rose_qsig_msgs); ++index) {
+		rose_bench_msg(ctrl, iterations, &fac_headers[index % ARRAY_LEN(fac_headers)],
+			&rose_qsig_msgs[index]);
+	}
+	ctrl->switchtype = PRI_SWITCH_DMS100;
+	for (index = 0; index < ARRAY_LEN(rose_dms100_msgs); ++index) {
+		rose_bench_msg(ctrl, iterations, &fac_headers[0], &rose_dms100_msgs[index]);
+	}
+	ctrl->switchtype = PRI_SWITCH_NI2;
+	for (index = 0; index < ARRAY_LEN(rose_ni2_msgs); ++index) {
+		rose_bench_msg(ctrl, iterations, &fac_headers[0], &rose_ni2_msgs[index]);
+	}
+
+	pri_message(ctrl, "ROSE encode/decode, %u iterations, average ns/op per message\n",
+		iterations);
+	pri_message(ctrl, "%-8s %-6s %-40s %4s %6s %8s %8s %8s %8s %8s\n", "Switch", "Type",
+		"Operation", "Msgs", "Octets", "HdrEnc", "Encode", "HdrDec", "Decode", "Alloc");
+	for (index = 0; index < rose_bench_num_stats; ++index) {
+		stat = &rose_bench_stats[index];
+		switch (stat->type) {
+		case ROSE_COMP_TYPE_INVOKE:
+		case ROSE_COMP_TYPE_RESULT:
+			name = rose_operation2str(stat->code);
+			break;
+		case ROSE_COMP_TYPE_ERROR:
+			name = rose_error2str(stat->code);
+			break;
+		case ROSE_COMP_TYPE_REJECT:
+			name = rose_reject2str(stat->code);
+			break;
+		default:
+			name = "Unknown";
+			break;
+		}
+		pri_message(ctrl, "%-8.8s %-6s %-40.40s %4u %6.1f %8.1f %8.1f %8.1f %8.1f %8.1f\n",
+			pri_switch2str(stat->switchtype),
+			stat->type == ROSE_COMP_TYPE_INVOKE ? "invoke"
+				: stat->type == ROSE_COMP_TYPE_RESULT ? "result"
+				: stat->type == ROSE_COMP_TYPE_ERROR ? "error" : "reject",
+			name, stat->msgs, (double) stat->octets / stat->msgs,
+			stat->hdr_enc_ns / stat->msgs, stat->enc_ns / stat->msgs,
+			stat->hdr_dec_ns / stat->msgs, stat->dec_ns / stat->msgs,
+			stat->alloc_octets / stat->msgs);
+	}
+
+	pri_message(ctrl, "\nASN.1 primitive decode, %u iterations\n", iterations);
+	pri_message(ctrl, "%-24s %8s %10s %10s\n", "Primitive", "Octets", "ns/op", "Alloc");
+	end = asn1_enc_boolean(buf, buf + sizeof(buf), ASN1_TYPE_BOOLEAN, 1);
+	rose_bench_asn1(ctrl, iterations, "boolean", buf, end);
+	end = asn1_enc_int(buf, buf + sizeof(buf), ASN1_TYPE_INTEGER, 1234567);
+	rose_bench_asn1(ctrl, iterations, "integer", buf, end);
+	end = asn1_enc_null(buf, buf + sizeof(buf), ASN1_TYPE_NULL);
+	rose_bench_asn1(ctrl, iterations, "null", buf, end);
+	end = asn1_enc_oid(buf, buf + sizeof(buf), ASN1_TYPE_OBJECT_IDENTIFIER, &oid);
+	rose_bench_asn1(ctrl, iterations, "object identifier", buf, end);
+	end = asn1_enc_string_bin(buf, buf + sizeof(buf), ASN1_TYPE_OCTET_STRING, octets,
+		sizeof(octets) - 1);
+	rose_bench_asn1(ctrl, iterations, "octet string", buf, end);
+	end = asn1_enc_string_max(buf, buf + sizeof(buf), ASN1_TYPE_IA5_STRING,
+		(const unsigned char *) "5551234567", 20);
+	rose_bench_asn1(ctrl, iterations, "IA5 string", buf, end);
+}
+
 /*!
  * \brief ROSE encode/decode test program.
  *
@@ -3071,6 +3451,11 @@ int main(int argc, char *argv[])
 	/* For sanity specify what version of libpri we are testing. */
 	pri_error(&dummy_ctrl, "libpri version tested: %s\n", pri_get_version());
 
+	if (1 < argc && !strcmp(argv[1], "-b")) {
+		rose_bench(&dummy_ctrl, 2 < argc ? atoi(argv[2]) : ROSE_BENCH_ITERATIONS);
+		return 0;
+	}
+
 	offset = 0;
 	pri_message(&dummy_ctrl, "Encode/decode message(s)\n");
 	if (argc <= 1) {